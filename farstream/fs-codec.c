@@ -624,6 +624,30 @@ compare_lists (GList *list1, GList *list2,
   return TRUE;
 }
 
+/*
+ * Copied codecs keep their parameters in the same order, so try matching
+ * the lists element by element first, which is linear, before falling back
+ * to the unordered comparison.
+ */
+static gboolean
+compare_lists_ordered (GList *list1, GList *list2,
+    gboolean (*compare_params) (const gpointer p1, const gpointer p2))
+{
+  for (;
+       list1 && list2;
+       list1 = g_list_next (list1), list2 = g_list_next (list2))
+  {
+    if (list1->data != list2->data &&
+        !compare_params (list1->data, list2->data))
+      return FALSE;
+  }
+
+  if (list1 == NULL && list2 == NULL)
+    return TRUE;
+  else
+    return FALSE;
+}
+
 
 /**
  * fs_codec_are_equal:
@@ -661,16 +685,20 @@ fs_codec_are_equal (const FsCodec *codec1, const FsCodec *codec2)
   /* Is there a smarter way to compare to un-ordered linked lists
    * to make sure they contain exactly the same elements??
    */
-  if (!compare_lists (codec1->optional_params, codec2->optional_params,
+  if (!compare_lists_ordered (codec1->optional_params,
+          codec2->optional_params, compare_optional_params) &&
+      (!compare_lists (codec1->optional_params, codec2->optional_params,
           compare_optional_params) ||
-      !compare_lists (codec2->optional_params, codec1->optional_params,
-          compare_optional_params))
+       !compare_lists (codec2->optional_params, codec1->optional_params,
+          compare_optional_params)))
     return FALSE;
 
-  if (!compare_lists (codec1->feedback_params,
+  if (!compare_lists_ordered (codec1->feedback_params,
+          codec2->feedback_params, compare_feedback_params) &&
+      (!compare_lists (codec1->feedback_params,
           codec2->feedback_params, compare_feedback_params) ||
-      !compare_lists (codec2->feedback_params,
-          codec1->feedback_params, compare_feedback_params))
+       !compare_lists (codec2->feedback_params,
+          codec1->feedback_params, compare_feedback_params)))
     return FALSE;
 
   return TRUE;
@@ -55,10 +55,21 @@ enum
 
 struct _FsElementAddedNotifierPrivate {
   GPtrArray *bins;
+
+  GMutex mutex;
+  /* GstBin * -> TrackedBin, protected by mutex */
+  GHashTable *tracked;
 };
 
+typedef struct {
+  gulong added_id;
+  gulong removed_id;
+} TrackedBin;
+
 static void _element_added_callback (GstBin *parent, GstElement *element,
     gpointer user_data);
+static void _element_removed_callback (GstBin *bin, GstElement *element,
+    FsElementAddedNotifier *notifier);
 
 static void fs_element_added_notifier_finalize (GObject *object);
 
@@ -87,6 +98,13 @@ fs_element_added_notifier_class_init (FsElementAddedNotifierClass *klass)
    * Be careful, there is no guarantee that this will be emitted on your
    * main thread, it will be emitted in the thread that added the element.
    * The bin may be %NULL if this is the top-level bin.
+   *
+   * When a bin that already has children is added, the bin is announced
+   * first and its sub-bins are then walked breadth-first: every element is
+   * announced after its parent bin, and all the children of a bin are
+   * announced before any of their own children. Until UNRELEASED, the
+   * sub-bins were walked depth-first and the children of a bin were
+   * announced before the bin itself.
    */
   signals[ELEMENT_ADDED] = g_signal_new ("element-added",
       G_TYPE_FROM_CLASS (klass),
@@ -104,6 +122,119 @@ fs_element_added_notifier_init (FsElementAddedNotifier *notifier)
   notifier->priv = FS_ELEMENT_ADDED_NOTIFIER_GET_PRIVATE(notifier);
 
   notifier->priv->bins = g_ptr_array_new_with_free_func (gst_object_unref);
+
+  g_mutex_init (&notifier->priv->mutex);
+  notifier->priv->tracked = g_hash_table_new (g_direct_hash, g_direct_equal);
+}
+
+static void
+_tracked_bin_weak_notify (gpointer data, GObject *where_the_object_was)
+{
+  FsElementAddedNotifier *notifier = data;
+  TrackedBin *tracked;
+
+  g_mutex_lock (&notifier->priv->mutex);
+  tracked = g_hash_table_lookup (notifier->priv->tracked,
+      where_the_object_was);
+  if (tracked)
+  {
+    g_hash_table_remove (notifier->priv->tracked, where_the_object_was);
+    g_slice_free (TrackedBin, tracked);
+  }
+  g_mutex_unlock (&notifier->priv->mutex);
+}
+
+/*
+ * Returns %TRUE if the bin was not tracked yet, in which case the caller must
+ * go through its children.
+ */
+static gboolean
+_track_bin (FsElementAddedNotifier *notifier, GstBin *bin)
+{
+  TrackedBin *tracked;
+
+  g_mutex_lock (&notifier->priv->mutex);
+  if (g_hash_table_lookup (notifier->priv->tracked, bin))
+  {
+    g_mutex_unlock (&notifier->priv->mutex);
+    return FALSE;
+  }
+
+  tracked = g_slice_new (TrackedBin);
+  tracked->added_id = g_signal_connect (bin, "element-added",
+      G_CALLBACK (_element_added_callback), notifier);
+  tracked->removed_id = g_signal_connect (bin, "element-removed",
+      G_CALLBACK (_element_removed_callback), notifier);
+  g_object_weak_ref (G_OBJECT (bin), _tracked_bin_weak_notify, notifier);
+  g_hash_table_insert (notifier->priv->tracked, bin, tracked);
+  g_mutex_unlock (&notifier->priv->mutex);
+
+  return TRUE;
+}
+
+static void
+_untrack_bin_locked (FsElementAddedNotifier *notifier, GstBin *bin,
+    TrackedBin *tracked)
+{
+  g_signal_handler_disconnect (bin, tracked->added_id);
+  g_signal_handler_disconnect (bin, tracked->removed_id);
+  g_object_weak_unref (G_OBJECT (bin), _tracked_bin_weak_notify, notifier);
+  g_slice_free (TrackedBin, tracked);
+}
+
+/*
+ * Returns %TRUE if the bin was tracked, in which case the caller must
+ * go through its children.
+ */
+static gboolean
+_untrack_bin (FsElementAddedNotifier *notifier, GstBin *bin)
+{
+  TrackedBin *tracked;
+
+  g_mutex_lock (&notifier->priv->mutex);
+  tracked = g_hash_table_lookup (notifier->priv->tracked, bin);
+  if (tracked)
+  {
+    g_hash_table_remove (notifier->priv->tracked, bin);
+    _untrack_bin_locked (notifier, bin, tracked);
+  }
+  g_mutex_unlock (&notifier->priv->mutex);
+
+  return tracked != NULL;
+}
+
+/* Queues a (bin, child) pair, with a reference on each, for every child */
+static void
+_push_children (GstBin *bin, GQueue *queue)
+{
+  GstIterator *iter = gst_bin_iterate_elements (bin);
+  gboolean done = FALSE;
+
+  while (!done)
+  {
+    GValue item = {0,};
+
+    switch (gst_iterator_next (iter, &item)) {
+      case GST_ITERATOR_OK:
+        g_queue_push_tail (queue, gst_object_ref (bin));
+        g_queue_push_tail (queue, g_value_dup_object (&item));
+        g_value_reset (&item);
+        break;
+      case GST_ITERATOR_RESYNC:
+        // We don't rollback anything, we just ignore already processed ones
+        gst_iterator_resync (iter);
+        break;
+      case GST_ITERATOR_ERROR:
+        g_error ("Wrong parameters were given?");
+        done = TRUE;
+        break;
+      case GST_ITERATOR_DONE:
+        done = TRUE;
+        break;
+    }
+  }
+
+  gst_iterator_free (iter);
 }
 
 
@@ -112,6 +243,15 @@ static void
 fs_element_added_notifier_finalize (GObject *object)
 {
   FsElementAddedNotifier *self = FS_ELEMENT_ADDED_NOTIFIER (object);
+  GHashTableIter iter;
+  gpointer key, value;
+
+  /* Every tracked bin is kept alive by one of the top-level bins */
+  g_hash_table_iter_init (&iter, self->priv->tracked);
+  while (g_hash_table_iter_next (&iter, &key, &value))
+    _untrack_bin_locked (self, key, value);
+  g_hash_table_unref (self->priv->tracked);
+  g_mutex_clear (&self->priv->mutex);
 
   g_ptr_array_unref (self->priv->bins);
 
@@ -160,47 +300,24 @@ static void
 _element_removed_callback (GstBin *bin, GstElement *element,
     FsElementAddedNotifier *notifier)
 {
+  GQueue queue = G_QUEUE_INIT;
 
-  /* Return if there was no handler connected */
-  if (g_signal_handlers_disconnect_by_func (element, _element_added_callback,
-          notifier) == 0 ||
-      g_signal_handlers_disconnect_by_func (element, _element_removed_callback,
-          notifier) == 0)
+  /* Return if the bin was not tracked */
+  if (!GST_IS_BIN (element) || !_untrack_bin (notifier, GST_BIN (element)))
     return;
 
-  if (GST_IS_BIN (element))
+  _push_children (GST_BIN (element), &queue);
+
+  while (!g_queue_is_empty (&queue))
   {
-    GstIterator *iter = NULL;
-    gboolean done;
-    iter = gst_bin_iterate_elements (GST_BIN (element));
+    GstBin *parent = g_queue_pop_head (&queue);
+    GstElement *child = g_queue_pop_head (&queue);
 
-    done = FALSE;
-    while (!done)
-    {
-      GValue item = {0,};
-
-      switch (gst_iterator_next (iter, &item)) {
-        case GST_ITERATOR_OK:
-          _element_removed_callback (GST_BIN (element),
-              GST_ELEMENT (g_value_get_object (&item)),
-              notifier);
-          g_value_reset (&item);
-          break;
-        case GST_ITERATOR_RESYNC:
-          // We don't rollback anything, we just ignore already processed ones
-          gst_iterator_resync (iter);
-          break;
-        case GST_ITERATOR_ERROR:
-          g_error ("Wrong parameters were given?");
-          done = TRUE;
-          break;
-        case GST_ITERATOR_DONE:
-          done = TRUE;
-          break;
-      }
-    }
+    if (GST_IS_BIN (child) && _untrack_bin (notifier, GST_BIN (child)))
+      _push_children (GST_BIN (child), &queue);
 
-    gst_iterator_free (iter);
+    gst_object_unref (child);
+    gst_object_unref (parent);
   }
 }
 
@@ -219,23 +336,21 @@ gboolean
 fs_element_added_notifier_remove (FsElementAddedNotifier *notifier,
     GstBin *bin)
 {
+  gboolean tracked;
+
   g_return_val_if_fail (FS_IS_ELEMENT_ADDED_NOTIFIER (notifier), FALSE);
   g_return_val_if_fail (GST_IS_BIN (bin), FALSE);
 
-  g_ptr_array_remove (notifier->priv->bins, bin);
+  g_mutex_lock (&notifier->priv->mutex);
+  tracked = g_hash_table_lookup (notifier->priv->tracked, bin) != NULL;
+  g_mutex_unlock (&notifier->priv->mutex);
 
-  if (g_signal_handler_find (bin,
-          G_SIGNAL_MATCH_FUNC | G_SIGNAL_MATCH_DATA,
-          0, 0, NULL, /* id, detail, closure */
-          _element_added_callback, notifier) != 0)
-  {
+  if (tracked)
     _element_removed_callback (NULL, GST_ELEMENT (bin), notifier);
-    return TRUE;
-  }
-  else
-  {
-    return FALSE;
-  }
+
+  g_ptr_array_remove (notifier->priv->bins, bin);
+
+  return tracked;
 }
 
 
@@ -245,71 +360,196 @@ fs_element_added_notifier_remove (FsElementAddedNotifier *notifier,
 # define DEBUG g_debug
 #endif
 
+/*
+ * The keyfile is compiled into a table of groups when it is passed in. For
+ * each group, the properties are resolved and deserialized the first time an
+ * element of a given type is matched, the following elements of the same type
+ * only need a lookup.
+ */
+
+typedef struct {
+  GParamSpec *pspec;
+  GValue value;
+} PropertySetting;
+
+typedef struct {
+  gchar **keys;
+  gchar **values;
+  /* GType -> GArray of PropertySetting */
+  GHashTable *by_type;
+} PropertyGroup;
+
+typedef struct {
+  GMutex mutex;
+  /* group name -> PropertyGroup */
+  GHashTable *groups;
+} PropertyPlan;
+
 static void
-set_properties_from_keyfile (GKeyFile *keyfile, GstElement *element)
+property_settings_free (gpointer data)
 {
-  const gchar *name = NULL;
-  gchar *free_name = NULL;
-  gchar **keys;
-  gint i;
-  GstElementFactory *factory = gst_element_get_factory (element);
+  GArray *settings = data;
+  guint i;
 
-  if (factory)
+  for (i = 0; i < settings->len; i++)
   {
-    name = gst_plugin_feature_get_name (GST_PLUGIN_FEATURE (factory));
-    if (name && !g_key_file_has_group (keyfile, name))
-        name = NULL;
+    PropertySetting *setting = &g_array_index (settings, PropertySetting, i);
+
+    g_param_spec_unref (setting->pspec);
+    g_value_unset (&setting->value);
   }
+  g_array_free (settings, TRUE);
+}
+
+static void
+property_group_free (gpointer data)
+{
+  PropertyGroup *group = data;
 
-  if (!name)
+  g_strfreev (group->keys);
+  g_strfreev (group->values);
+  g_hash_table_unref (group->by_type);
+  g_slice_free (PropertyGroup, group);
+}
+
+static PropertyPlan *
+property_plan_new (GKeyFile *keyfile)
+{
+  PropertyPlan *plan = g_slice_new (PropertyPlan);
+  gchar **groups;
+  gint i;
+
+  g_mutex_init (&plan->mutex);
+  plan->groups = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+      property_group_free);
+
+  groups = g_key_file_get_groups (keyfile, NULL);
+  for (i = 0; groups[i]; i++)
   {
-    GST_OBJECT_LOCK (element);
-    if (GST_OBJECT_NAME (element) &&
-        g_key_file_has_group (keyfile, GST_OBJECT_NAME (element)))
-      name = free_name = g_strdup (GST_OBJECT_NAME (element));
-    GST_OBJECT_UNLOCK (element);
+    PropertyGroup *group = g_slice_new (PropertyGroup);
+    gint j;
+
+    group->keys = g_key_file_get_keys (keyfile, groups[i], NULL, NULL);
+    group->values = g_new0 (gchar *, g_strv_length (group->keys) + 1);
+    for (j = 0; group->keys[j]; j++)
+      group->values[j] = g_key_file_get_value (keyfile, groups[i],
+          group->keys[j], NULL);
+    group->by_type = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+        NULL, property_settings_free);
+
+    g_hash_table_insert (plan->groups, g_strdup (groups[i]), group);
   }
+  g_strfreev (groups);
 
-  if (!name)
-    return;
+  return plan;
+}
 
-  DEBUG ("Found config for %s", name);
-  keys = g_key_file_get_keys (keyfile, name, NULL, NULL);
+static void
+property_plan_free (gpointer data, GClosure *closure)
+{
+  PropertyPlan *plan = data;
+
+  g_hash_table_unref (plan->groups);
+  g_mutex_clear (&plan->mutex);
+  g_slice_free (PropertyPlan, plan);
+}
+
+static GArray *
+property_group_resolve (PropertyGroup *group, const gchar *name,
+    GObjectClass *klass)
+{
+  GArray *settings = g_array_new (FALSE, TRUE, sizeof (PropertySetting));
+  gint i;
 
-  for (i = 0; keys[i]; i++)
+  for (i = 0; group->keys[i]; i++)
   {
-    GParamSpec *param_spec;
-    GValue prop_value = { 0 };
-    gchar *str_value;
+    PropertySetting setting = { NULL, { 0 } };
 
-    DEBUG ("getting %s", keys[i]);
-    param_spec = g_object_class_find_property (G_OBJECT_GET_CLASS(element),
-        keys[i]);
+    DEBUG ("getting %s", group->keys[i]);
+    setting.pspec = g_object_class_find_property (klass, group->keys[i]);
 
-    if (!param_spec)
+    if (!setting.pspec)
     {
       DEBUG ("Property %s does not exist in element %s, ignoring",
-          keys[i], name);
+          group->keys[i], name);
       continue;
     }
 
-    g_value_init (&prop_value, param_spec->value_type);
+    g_value_init (&setting.value, setting.pspec->value_type);
 
-    str_value = g_key_file_get_value (keyfile, name, keys[i], NULL);
-    if (str_value && gst_value_deserialize (&prop_value, str_value))
+    if (group->values[i] &&
+        gst_value_deserialize (&setting.value, group->values[i]))
     {
-      DEBUG ("Setting %s to on %s", keys[i], name);
-      g_object_set_property (G_OBJECT (element), keys[i], &prop_value);
+      g_param_spec_ref (setting.pspec);
+      g_array_append_val (settings, setting);
     }
     else
     {
-      DEBUG ("Could not read value for property %s", keys[i]);
+      DEBUG ("Could not read value for property %s", group->keys[i]);
+      g_value_unset (&setting.value);
+    }
+  }
+
+  return settings;
+}
+
+static void
+set_properties_from_plan (PropertyPlan *plan, GstElement *element)
+{
+  const gchar *name = NULL;
+  gchar *free_name = NULL;
+  PropertyGroup *group = NULL;
+  GArray *settings;
+  GType element_type = G_OBJECT_TYPE (element);
+  guint i;
+  GstElementFactory *factory = gst_element_get_factory (element);
+
+  if (factory)
+  {
+    name = gst_plugin_feature_get_name (GST_PLUGIN_FEATURE (factory));
+    if (name)
+      group = g_hash_table_lookup (plan->groups, name);
+  }
+
+  if (!group)
+  {
+    GST_OBJECT_LOCK (element);
+    if (GST_OBJECT_NAME (element))
+    {
+      group = g_hash_table_lookup (plan->groups, GST_OBJECT_NAME (element));
+      if (group)
+        name = free_name = g_strdup (GST_OBJECT_NAME (element));
     }
-    g_free (str_value);
-    g_value_unset (&prop_value);
+    GST_OBJECT_UNLOCK (element);
+  }
+
+  if (!group)
+    return;
+
+  DEBUG ("Found config for %s", name);
+
+  g_mutex_lock (&plan->mutex);
+  settings = g_hash_table_lookup (group->by_type,
+      GSIZE_TO_POINTER (element_type));
+  if (!settings)
+  {
+    settings = property_group_resolve (group, name,
+        G_OBJECT_GET_CLASS (element));
+    g_hash_table_insert (group->by_type, GSIZE_TO_POINTER (element_type),
+        settings);
+  }
+  g_mutex_unlock (&plan->mutex);
+
+  /* Once resolved, the settings are never modified until the plan is freed */
+  for (i = 0; i < settings->len; i++)
+  {
+    PropertySetting *setting = &g_array_index (settings, PropertySetting, i);
+
+    DEBUG ("Setting %s to on %s", setting->pspec->name, name);
+    g_object_set_property (G_OBJECT (element), setting->pspec->name,
+        &setting->value);
   }
 
-  g_strfreev (keys);
   g_free (free_name);
 }
 
@@ -317,18 +557,18 @@ static void
 _bin_added_from_keyfile (FsElementAddedNotifier *notifier, GstBin *bin,
     GstElement *element, gpointer user_data)
 {
-  GKeyFile *keyfile = user_data;
+  PropertyPlan *plan = user_data;
 
-  set_properties_from_keyfile (keyfile, element);
+  set_properties_from_plan (plan, element);
 }
 
 static void
 _element_foreach_keyfile (const GValue * item, gpointer user_data)
 {
   GstElement *element = g_value_get_object (item);
-  GKeyFile *keyfile = user_data;
+  PropertyPlan *plan = user_data;
 
-  set_properties_from_keyfile (keyfile, element);
+  set_properties_from_plan (plan, element);
 }
 
 
@@ -352,26 +592,29 @@ fs_element_added_notifier_set_properties_from_keyfile (
     FsElementAddedNotifier *notifier,
     GKeyFile *keyfile)
 {
+  PropertyPlan *plan;
   guint i;
 
   g_return_val_if_fail (FS_IS_ELEMENT_ADDED_NOTIFIER (notifier), 0);
   g_return_val_if_fail (keyfile, 0);
 
+  plan = property_plan_new (keyfile);
+  g_key_file_free (keyfile);
+
   for (i = 0; i < notifier->priv->bins->len; i++)
   {
     GstIterator *iter;
 
     iter = gst_bin_iterate_recurse (
         g_ptr_array_index (notifier->priv->bins, i));
-    while (gst_iterator_foreach (iter, _element_foreach_keyfile, keyfile) ==
+    while (gst_iterator_foreach (iter, _element_foreach_keyfile, plan) ==
         GST_ITERATOR_RESYNC)
       gst_iterator_resync (iter);
     gst_iterator_free (iter);
   }
 
   return g_signal_connect_data (notifier, "element-added",
-      G_CALLBACK (_bin_added_from_keyfile), keyfile,
-      (GClosureNotify) g_key_file_free, 0);
+      G_CALLBACK (_bin_added_from_keyfile), plan, property_plan_free, 0);
 }
 
 
@@ -410,55 +653,33 @@ _element_added_callback (GstBin *parent, GstElement *element,
     gpointer user_data)
 {
   FsElementAddedNotifier *notifier = FS_ELEMENT_ADDED_NOTIFIER (user_data);
+  GQueue queue = G_QUEUE_INIT;
 
-  if (GST_IS_BIN (element)) {
-    GstIterator *iter = NULL;
-    gboolean done;
-
-    g_signal_connect_object (element, "element-added",
-        G_CALLBACK (_element_added_callback), notifier, 0);
-
+  if (GST_IS_BIN (element) && _track_bin (notifier, GST_BIN (element)))
+    _push_children (GST_BIN (element), &queue);
 
-    g_signal_connect_object (element, "element-removed",
-        G_CALLBACK (_element_removed_callback), notifier, 0);
+  if (parent)
+    g_signal_emit (notifier, signals[ELEMENT_ADDED], 0, parent, element);
 
-    iter = gst_bin_iterate_elements (GST_BIN (element));
+  /*
+   * The sub-bins are walked breadth-first, a bin that is already tracked
+   * has already been announced along with all of its children.
+   */
+  while (!g_queue_is_empty (&queue))
+  {
+    GstBin *bin = g_queue_pop_head (&queue);
+    GstElement *child = g_queue_pop_head (&queue);
 
-    done = FALSE;
-    while (!done)
+    if (!GST_IS_BIN (child) || _track_bin (notifier, GST_BIN (child)))
     {
-      GValue item = {0,};
-
-      switch (gst_iterator_next (iter, &item)) {
-       case GST_ITERATOR_OK:
-         /* We make sure the callback has not already been added */
-         if (g_signal_handler_find (g_value_get_object (&item),
-                 G_SIGNAL_MATCH_FUNC | G_SIGNAL_MATCH_DATA,
-                 0, 0, NULL, /* id, detail, closure */
-                 _element_added_callback, notifier) == 0)
-           _element_added_callback (GST_BIN_CAST (element),
-               g_value_get_object (&item), notifier);
-         g_value_reset (&item);
-         break;
-       case GST_ITERATOR_RESYNC:
-         // We don't rollback anything, we just ignore already processed ones
-         gst_iterator_resync (iter);
-         break;
-       case GST_ITERATOR_ERROR:
-         g_error ("Wrong parameters were given?");
-         done = TRUE;
-         break;
-       case GST_ITERATOR_DONE:
-         done = TRUE;
-         break;
-     }
+      if (GST_IS_BIN (child))
+        _push_children (GST_BIN (child), &queue);
+      g_signal_emit (notifier, signals[ELEMENT_ADDED], 0, bin, child);
     }
 
-    gst_iterator_free (iter);
+    gst_object_unref (child);
+    gst_object_unref (bin);
   }
-
-  if (parent)
-    g_signal_emit (notifier, signals[ELEMENT_ADDED], 0, parent, element);
 }
 
 
@@ -32,6 +32,11 @@
 #include "fs-plugin.h"
 
 #include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <time.h>
+
+#include <glib/gstdio.h>
 
 #include "fs-conference.h"
 #include "fs-private.h"
@@ -56,6 +61,11 @@ static GMutex mutex;
 static gchar **search_paths = NULL;
 static GList *plugins = NULL;
 
+/* protected by mutex */
+static GKeyFile *plugin_index = NULL;
+static gchar *plugin_index_loaded_path = NULL;
+static gboolean plugin_index_dirty = FALSE;
+
 struct _FsPluginPrivate
 {
   GModule *handle;
@@ -90,6 +100,236 @@ fs_plugin_search_path_init (void)
     }
 }
 
+/*
+ * The plugin index records which plugins each directory of the search path
+ * contains, so that listing the available plugins does not need to go
+ * through the directories every time. It is persisted in the user cache
+ * directory and contains one group per directory, with the mtime of the
+ * directory and one key per type suffix listing the plugin names.
+ * A directory is only scanned again when its mtime changes.
+ */
+
+static gchar *
+fs_plugin_index_path (void)
+{
+  gchar *path = g_strdup (g_getenv ("FS_PLUGIN_INDEX"));
+
+  if (path == NULL)
+    path = g_build_filename (g_get_user_cache_dir (), "farstream",
+        "plugins-" FS_APIVERSION "." HOST_CPU ".index", NULL);
+
+  return path;
+}
+
+static void fs_plugin_index_save_locked (void);
+
+/*
+ * The index is loaded again if FS_PLUGIN_INDEX points somewhere else since
+ * the last time it was loaded
+ */
+static void
+fs_plugin_index_load_locked (void)
+{
+  gchar *path = fs_plugin_index_path ();
+
+  if (plugin_index)
+  {
+    if (!strcmp (path, plugin_index_loaded_path))
+    {
+      g_free (path);
+      return;
+    }
+
+    fs_plugin_index_save_locked ();
+    g_key_file_free (plugin_index);
+    g_free (plugin_index_loaded_path);
+  }
+
+  plugin_index = g_key_file_new ();
+  plugin_index_loaded_path = path;
+  plugin_index_dirty = FALSE;
+
+  if (!g_key_file_load_from_file (plugin_index, path, G_KEY_FILE_NONE, NULL))
+    GST_DEBUG ("No usable plugin index at %s", path);
+}
+
+static void
+fs_plugin_index_save_locked (void)
+{
+  GError *error = NULL;
+  const gchar *path = plugin_index_loaded_path;
+  gchar *dir;
+  gchar *data;
+  gsize length;
+
+  if (!plugin_index_dirty)
+    return;
+  plugin_index_dirty = FALSE;
+
+  dir = g_path_get_dirname (path);
+  g_mkdir_with_parents (dir, 0777);
+  g_free (dir);
+
+  data = g_key_file_to_data (plugin_index, &length, NULL);
+  if (!g_file_set_contents (path, data, length, &error))
+  {
+    GST_WARNING ("Could not save the plugin index to %s: %s", path,
+        error->message);
+    g_clear_error (&error);
+  }
+  g_free (data);
+}
+
+static void
+fs_plugin_index_scan_dir_locked (const gchar *search_path, gint64 mtime)
+{
+  GHashTable *by_suffix;
+  GHashTableIter iter;
+  gpointer key, value;
+  GRegex *matcher;
+  GError *error = NULL;
+  GDir *dir;
+  const gchar *entry;
+  gchar *tmp1, *tmp2;
+
+  GST_DEBUG ("Indexing plugins in %s", search_path);
+
+  g_key_file_remove_group (plugin_index, search_path, NULL);
+  plugin_index_dirty = TRUE;
+
+  dir = g_dir_open (search_path, 0, &error);
+  if (!dir)
+  {
+    GST_WARNING ("Could not open path %s to look for plugins: %s",
+        search_path, error ? error->message : "Unknown error");
+    g_clear_error (&error);
+    return;
+  }
+
+  tmp1 = g_module_build_path ("", "(.+)-([^-.]+)");
+  tmp2 = g_strconcat ("^", tmp1, NULL);
+  matcher = g_regex_new (tmp2, 0, 0, NULL);
+  g_free (tmp1);
+  g_free (tmp2);
+
+  /* suffix -> GPtrArray of plugin names */
+  by_suffix = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+      (GDestroyNotify) g_ptr_array_unref);
+
+  while ((entry = g_dir_read_name (dir)))
+  {
+    GMatchInfo *match_info = NULL;
+
+    if (g_regex_match (matcher, entry, 0, &match_info))
+    {
+      gchar *name = g_match_info_fetch (match_info, 1);
+      gchar *suffix = g_match_info_fetch (match_info, 2);
+      GPtrArray *names = g_hash_table_lookup (by_suffix, suffix);
+      gboolean found = FALSE;
+      guint i;
+
+      if (!names)
+      {
+        names = g_ptr_array_new_with_free_func (g_free);
+        g_hash_table_insert (by_suffix, g_strdup (suffix), names);
+      }
+
+      for (i = 0; i < names->len; i++)
+        if (!strcmp (name, g_ptr_array_index (names, i)))
+          found = TRUE;
+
+      if (found)
+        g_free (name);
+      else
+        g_ptr_array_add (names, name);
+      g_free (suffix);
+    }
+    g_match_info_free (match_info);
+  }
+
+  g_dir_close (dir);
+  g_regex_unref (matcher);
+
+  /* A file could still be added during the same second without changing
+   * the mtime, so such a directory will be scanned again next time */
+  if (mtime >= (gint64) time (NULL) - 1)
+    mtime = -1;
+  g_key_file_set_int64 (plugin_index, search_path, "mtime", mtime);
+
+  g_hash_table_iter_init (&iter, by_suffix);
+  while (g_hash_table_iter_next (&iter, &key, &value))
+  {
+    GPtrArray *names = value;
+
+    g_key_file_set_string_list (plugin_index, search_path, key,
+        (const gchar * const *) names->pdata, names->len);
+  }
+
+  g_hash_table_unref (by_suffix);
+}
+
+/*
+ * Returns %FALSE if the directory does not exist, otherwise makes sure
+ * that its entry in the index is up to date.
+ */
+static gboolean
+fs_plugin_index_update_dir_locked (const gchar *search_path)
+{
+  GStatBuf statbuf;
+
+  if (g_stat (search_path, &statbuf) != 0)
+  {
+    if (g_key_file_has_group (plugin_index, search_path))
+    {
+      g_key_file_remove_group (plugin_index, search_path, NULL);
+      plugin_index_dirty = TRUE;
+    }
+    return FALSE;
+  }
+
+  if (!g_key_file_has_group (plugin_index, search_path) ||
+      g_key_file_get_int64 (plugin_index, search_path, "mtime", NULL) !=
+      (gint64) statbuf.st_mtime)
+    fs_plugin_index_scan_dir_locked (search_path, statbuf.st_mtime);
+
+  return TRUE;
+}
+
+static gboolean
+fs_plugin_index_dir_has_locked (const gchar *search_path, const gchar *name,
+    const gchar *type_suffix)
+{
+  gchar **names;
+  gboolean found = FALSE;
+  guint i;
+
+  names = g_key_file_get_string_list (plugin_index, search_path, type_suffix,
+      NULL, NULL);
+  if (!names)
+    return FALSE;
+
+  for (i = 0; names[i]; i++)
+    if (!strcmp (names[i], name))
+      found = TRUE;
+
+  g_strfreev (names);
+
+  return found;
+}
+
+/*
+ * Scans a directory again even if its mtime did not change, this is used
+ * when the index turned out to be wrong about it.
+ */
+static void
+fs_plugin_index_rescan_dir_locked (const gchar *search_path)
+{
+  GStatBuf statbuf;
+
+  if (g_stat (search_path, &statbuf) == 0)
+    fs_plugin_index_scan_dir_locked (search_path, statbuf.st_mtime);
+}
+
 static void
 fs_plugin_class_init (FsPluginClass * klass)
 {
@@ -113,44 +353,90 @@ fs_plugin_init (FsPlugin * plugin)
   plugin->priv->handle = NULL;
 }
 
+static gboolean
+fs_plugin_open_module (FsPlugin *plugin, const gchar *search_path,
+    gboolean (**fs_init_plugin) (FsPlugin *))
+{
+  gchar *path;
+
+  path = g_module_build_path (search_path, plugin->name);
+
+  plugin->priv->handle = g_module_open (path, G_MODULE_BIND_LOCAL);
+  GST_INFO ("opening module %s: %s\n", path,
+    (plugin->priv->handle != NULL) ? "succeeded" : g_module_error ());
+  g_free (path);
+
+  if (!plugin->priv->handle)
+    return FALSE;
+
+  if (!g_module_symbol (plugin->priv->handle,
+                        "fs_init_plugin",
+                        (gpointer) fs_init_plugin)) {
+    g_module_close (plugin->priv->handle);
+    plugin->priv->handle = NULL;
+    GST_WARNING ("could not find init function in plugin\n");
+    return FALSE;
+  }
+
+  return TRUE;
+}
+
 static gboolean fs_plugin_load (GTypeModule *module)
 {
   FsPlugin *plugin = FS_PLUGIN(module);
   gchar **search_path = NULL;
-  gchar *path=NULL;
+  gchar *short_name;
+  gchar *type_suffix;
 
   gboolean (*fs_init_plugin) (FsPlugin *);
 
   g_return_val_if_fail (plugin != NULL, FALSE);
   g_return_val_if_fail (plugin->name != NULL && plugin->name[0] != '\0', FALSE);
+  g_return_val_if_fail (strrchr (plugin->name, '-') != NULL, FALSE);
 
-  for (search_path = search_paths; *search_path; search_path++) {
-    GST_DEBUG("looking for plugins in %s", *search_path);
-
-    path = g_module_build_path (*search_path, plugin->name);
+  short_name = g_strdup (plugin->name);
+  type_suffix = strrchr (short_name, '-');
+  *type_suffix = '\0';
+  type_suffix++;
 
-    plugin->priv->handle = g_module_open (path, G_MODULE_BIND_LOCAL);
-    GST_INFO ("opening module %s: %s\n", path,
-      (plugin->priv->handle != NULL) ? "succeeded" : g_module_error ());
-    g_free (path);
+  fs_plugin_index_load_locked ();
 
-    if (!plugin->priv->handle) {
-      continue;
-    }
+  /* First only open the modules that the index knows about */
+  for (search_path = search_paths; *search_path; search_path++) {
+    GST_DEBUG("looking for plugins in %s", *search_path);
 
-    else if (!g_module_symbol (plugin->priv->handle,
-                          "fs_init_plugin",
-                          (gpointer) & fs_init_plugin)) {
-      g_module_close (plugin->priv->handle);
-      plugin->priv->handle = NULL;
-      GST_WARNING ("could not find init function in plugin\n");
+    if (!fs_plugin_index_update_dir_locked (*search_path) ||
+        !fs_plugin_index_dir_has_locked (*search_path, short_name,
+            type_suffix))
       continue;
-    }
 
-    else
+    if (fs_plugin_open_module (plugin, *search_path, &fs_init_plugin))
       break;
   }
 
+  /* The index can be wrong, for example if a plugin was installed without
+   * changing the mtime of its directory, so probe the other directories like
+   * before and correct the index where the module is found */
+  if (!plugin->priv->handle) {
+    GST_DEBUG ("%s not found through the plugin index, probing the search"
+        " path", plugin->name);
+
+    for (search_path = search_paths; *search_path; search_path++) {
+      if (!g_file_test (*search_path, G_FILE_TEST_IS_DIR) ||
+          fs_plugin_index_dir_has_locked (*search_path, short_name,
+              type_suffix))
+        continue;
+
+      if (fs_plugin_open_module (plugin, *search_path, &fs_init_plugin)) {
+        fs_plugin_index_rescan_dir_locked (*search_path);
+        break;
+      }
+    }
+  }
+
+  g_free (short_name);
+  fs_plugin_index_save_locked ();
+
   if (!plugin->priv->handle) {
     return FALSE;
   }
@@ -311,69 +597,51 @@ fs_plugin_list_available (const gchar *type_suffix)
   GPtrArray *list = g_ptr_array_new ();
   gchar **retval = NULL;
   gchar **search_path = NULL;
-  GRegex *matcher;
-  GError *error = NULL;
-  gchar *tmp1, *tmp2, *tmp3;
 
   _fs_conference_init_debug ();
 
   g_mutex_lock (&mutex);
 
   fs_plugin_search_path_init ();
-
-  tmp1 = g_strdup_printf ("(.+)-%s", type_suffix);
-  tmp2 = g_module_build_path ("", tmp1);
-  tmp3 = g_strconcat ("^", tmp2, NULL);
-  matcher = g_regex_new (tmp3, 0, 0, NULL);
-  g_free (tmp1);
-  g_free (tmp2);
-  g_free (tmp3);
-
+  fs_plugin_index_load_locked ();
 
   for (search_path = search_paths; *search_path; search_path++)
   {
-    GDir *dir = NULL;
-    const gchar *entry;
+    gchar **names;
+    guint i, j;
 
-    dir = g_dir_open (*search_path, 0, &error);
-    if (!dir)
+    if (!fs_plugin_index_update_dir_locked (*search_path))
     {
-      GST_WARNING ("Could not open path %s to look for plugins: %s",
-          *search_path, error ? error->message : "Unknown error");
-      g_clear_error (&error);
+      GST_WARNING ("Could not open path %s to look for plugins",
+          *search_path);
       continue;
     }
 
-    while ((entry = g_dir_read_name (dir)))
-    {
-      gchar **matches = NULL;
+    names = g_key_file_get_string_list (plugin_index, *search_path,
+        type_suffix, NULL, NULL);
+    if (!names)
+      continue;
 
-      matches = g_regex_split (matcher, entry, 0);
+    for (i = 0; names[i]; i++)
+    {
+      gboolean found = FALSE;
 
-      if (matches && g_strv_length (matches) == 3)
+      for (j = 0; j < list->len; j++)
       {
-        gint i;
-        gboolean found = FALSE;
-
-        for (i = 0; i < list->len; i++)
+        if (!strcmp (names[i], g_ptr_array_index (list, j)))
         {
-          if (!strcmp (matches[1], g_ptr_array_index (list, i)))
-          {
-            found = TRUE;
-            break;
-          }
+          found = TRUE;
+          break;
         }
-        if (!found)
-          g_ptr_array_add (list, g_strdup (matches[1]));
       }
-
-      g_strfreev (matches);
+      if (!found)
+        g_ptr_array_add (list, g_strdup (names[i]));
     }
 
-    g_dir_close (dir);
+    g_strfreev (names);
   }
 
-  g_regex_unref (matcher);
+  fs_plugin_index_save_locked ();
 
   if (list->len)
   {
@@ -533,6 +533,108 @@ fs_session_new_stream (FsSession *session,
   return new_stream;
 }
 
+static GList *
+fs_session_new_streams_one_by_one (FsSession *session,
+    GList *participants,
+    FsStreamDirection direction,
+    GList *remote_codecs,
+    GError **error)
+{
+  FsSessionClass *klass = FS_SESSION_GET_CLASS (session);
+  GQueue streams = G_QUEUE_INIT;
+  GList *item;
+
+  for (item = participants; item; item = g_list_next (item))
+  {
+    FsStream *stream = klass->new_stream (session, item->data, direction,
+        error);
+
+    if (!stream)
+      goto error;
+
+    g_queue_push_tail (&streams, stream);
+
+    if (remote_codecs)
+    {
+      if (remote_codecs->data &&
+          !fs_stream_set_remote_codecs (stream, remote_codecs->data, error))
+        goto error;
+      remote_codecs = g_list_next (remote_codecs);
+    }
+  }
+
+  return streams.head;
+
+ error:
+
+  for (item = streams.head; item; item = g_list_next (item))
+  {
+    fs_stream_destroy (item->data);
+    g_object_unref (item->data);
+  }
+  g_list_free (streams.head);
+
+  return NULL;
+}
+
+/**
+ * fs_session_new_streams:
+ * @session: a #FsSession
+ * @participants: (element-type FsParticipant): a #GList of #FsParticipant,
+ *  one new stream is created for each of them
+ * @direction: #FsStreamDirection describing the direction of the new streams
+ * @remote_codecs: (element-type GList) (allow-none): a #GList with one
+ *  #GList of #FsCodec per participant, in the same order, to be set as
+ *  the remote codecs of each new stream, or %NULL. An element can be %NULL
+ *  if there are no remote codecs for that participant yet.
+ * @error: location of a #GError, or %NULL if no error occured
+ *
+ * This function creates one stream for each of the given participants, like
+ * fs_session_new_stream() and sets their remote codecs, like
+ * fs_stream_set_remote_codecs(). Sessions that support it will do a single
+ * codec negotiation for all of the new streams, instead of one per stream,
+ * which makes it much faster to add many participants at once.
+ *
+ * If an error occurs, none of the streams is created.
+ *
+ * Returns: (element-type FsStream) (transfer full): a #GList of the new
+ * #FsStream in the same order as @participants. The user must unref
+ * each #FsStream and free the list. If an error occured, returns %NULL.
+ */
+GList *
+fs_session_new_streams (FsSession *session,
+    GList *participants,
+    FsStreamDirection direction,
+    GList *remote_codecs,
+    GError **error)
+{
+  FsSessionClass *klass;
+  GList *new_streams = NULL;
+  GList *item;
+
+  g_return_val_if_fail (session, NULL);
+  g_return_val_if_fail (FS_IS_SESSION (session), NULL);
+  g_return_val_if_fail (participants, NULL);
+  g_return_val_if_fail (remote_codecs == NULL ||
+      g_list_length (remote_codecs) == g_list_length (participants), NULL);
+  klass = FS_SESSION_GET_CLASS (session);
+  g_return_val_if_fail (klass->new_stream, NULL);
+
+  if (klass->new_streams)
+    new_streams = klass->new_streams (session, participants, direction,
+        remote_codecs, error);
+  else
+    new_streams = fs_session_new_streams_one_by_one (session, participants,
+        direction, remote_codecs, error);
+
+  /* Let's catch all stream errors and forward them */
+  for (item = new_streams; item; item = g_list_next (item))
+    g_signal_connect_object (item->data, "error",
+        G_CALLBACK (fs_session_error_forward), session, 0);
+
+  return new_streams;
+}
+
 /**
  * fs_session_start_telephony_event:
  * @session: a #FsSession
@@ -111,6 +111,8 @@ typedef enum _FsDTMFMethod
  * @codecs_need_resend: Returns the list of codecs that need resending
  * @set_allowed_caps: Set the possible allowed src and sink caps
  * @set_encryption_parameters: Set encryption parameters
+ * @new_streams: Create many #FsStream at once, if unset the streams are
+ *  created one by one using @new_stream
  *
  * You must override at least new_stream in a subclass.
  */
@@ -150,8 +152,11 @@ struct _FsSessionClass
   gboolean (* set_encryption_parameters) (FsSession *session,
       GstStructure *parameters, GError **error);
 
+  GList* (* new_streams) (FsSession *session, GList *participants,
+      FsStreamDirection direction, GList *remote_codecs, GError **error);
+
   /*< private >*/
-  gpointer _padding[6];
+  gpointer _padding[5];
 };
 
 /**
@@ -177,6 +182,12 @@ FsStream *fs_session_new_stream (FsSession *session,
                                  FsStreamDirection direction,
                                  GError **error);
 
+GList *fs_session_new_streams (FsSession *session,
+    GList *participants,
+    FsStreamDirection direction,
+    GList *remote_codecs,
+    GError **error);
+
 gboolean fs_session_start_telephony_event (FsSession *session, guint8 event,
                                            guint8 volume);
 
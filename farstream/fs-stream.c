@@ -46,6 +46,17 @@
  * This message is emitted when a new local candidate is discovered.
  * </para>
  * </refsect2>
+ * <refsect2><title>The "<literal>farstream-new-local-candidates</literal>" message</title>
+ * |[
+ * "stream"           #FsStream          The stream that emits the message
+ * "candidates"       #FsCandidateGList  A #GList of the new #FsCandidate
+ * ]|
+ * <para>
+ * This message is emitted with each batch of local candidates discovered
+ * together, before the "farstream-new-local-candidate" message of each of
+ * them. Only some transmitters (like nice) batch their candidates.
+ * </para>
+ * </refsect2>
  * <refsect2><title>The "<literal>farstream-local-candidates-prepared</literal>" message</title>
  * |[
  * "stream"           #FsStream          The stream that emits the message
@@ -897,6 +908,45 @@ fs_stream_parse_new_local_candidate (FsStream *stream,
 }
 
 
+/**
+ * fs_stream_parse_new_local_candidates:
+ * @stream: a #FsStream to match against the message
+ * @message: a #GstMessage to parse
+ * @candidates: (out) (transfer none) (element-type FsCandidate):
+ *  Returns a #GList of the #FsCandidate in the message if not %NULL
+ *
+ * Parses a "farstream-new-local-candidates" message and checks if it matches
+ * the @stream parameters.
+ *
+ * Returns: %TRUE if the message matches the stream and is valid.
+ *
+ * Since: UNRELEASED
+ */
+gboolean
+fs_stream_parse_new_local_candidates (FsStream *stream,
+    GstMessage *message,
+    GList **candidates)
+{
+  const GstStructure *s;
+  const GValue *value;
+
+  g_return_val_if_fail (stream != NULL, FALSE);
+
+  if (!check_message (message, stream, "farstream-new-local-candidates"))
+    return FALSE;
+
+  s = gst_message_get_structure (message);
+
+  value = gst_structure_get_value (s, "candidates");
+  if (!value || !G_VALUE_HOLDS (value, FS_TYPE_CANDIDATE_LIST))
+    return FALSE;
+  if (candidates)
+    *candidates = g_value_get_boxed (value);
+
+  return TRUE;
+}
+
+
 /**
  * fs_stream_parse_local_candidates_prepared:
  * @stream: a #FsStream to match against the message
@@ -202,6 +202,9 @@ void fs_stream_destroy (FsStream *stream);
 gboolean fs_stream_parse_new_local_candidate (FsStream *stream,
     GstMessage *message,
     FsCandidate **candidate);
+gboolean fs_stream_parse_new_local_candidates (FsStream *stream,
+    GstMessage *message,
+    GList **candidates);
 gboolean fs_stream_parse_local_candidates_prepared (FsStream *stream,
     GstMessage *message);
 gboolean fs_stream_parse_new_active_candidate_pair (FsStream *stream,
@@ -35,6 +35,79 @@
  * @short_description: Miscellaneous useful functions
  */
 
+/*
+ * The parsed default preferences are cached per factory name for the whole
+ * process, so that creating conferences does not hit the data directories
+ * every time. The %NULL results are cached too.
+ */
+
+typedef struct {
+  gboolean codec_prefs_loaded;
+  GList *codec_prefs;
+
+  gboolean element_properties_loaded;
+  /* Serialized, since every caller gets its own #GKeyFile */
+  gchar *element_properties;
+
+  gboolean hdrext_prefs_loaded[FS_MEDIA_TYPE_LAST + 1];
+  GList *hdrext_prefs[FS_MEDIA_TYPE_LAST + 1];
+} DefaultPreferences;
+
+G_LOCK_DEFINE_STATIC (default_preferences);
+static GHashTable *default_preferences = NULL;
+
+static void
+default_preferences_free (gpointer data)
+{
+  DefaultPreferences *prefs = data;
+  guint i;
+
+  fs_codec_list_destroy (prefs->codec_prefs);
+  g_free (prefs->element_properties);
+  for (i = 0; i <= FS_MEDIA_TYPE_LAST; i++)
+    fs_rtp_header_extension_list_destroy (prefs->hdrext_prefs[i]);
+  g_slice_free (DefaultPreferences, prefs);
+}
+
+static DefaultPreferences *
+get_default_preferences_locked (const gchar *factory_name)
+{
+  DefaultPreferences *prefs;
+
+  if (!default_preferences)
+    default_preferences = g_hash_table_new_full (g_str_hash, g_str_equal,
+        g_free, default_preferences_free);
+
+  prefs = g_hash_table_lookup (default_preferences, factory_name);
+  if (!prefs)
+  {
+    prefs = g_slice_new0 (DefaultPreferences);
+    g_hash_table_insert (default_preferences, g_strdup (factory_name), prefs);
+  }
+
+  return prefs;
+}
+
+/**
+ * fs_utils_invalidate_default_preferences_cache:
+ *
+ * The default codec preferences, element properties and RTP header
+ * extension preferences are only read from the disk the first time they
+ * are requested for each element. This function drops the cached values,
+ * so that the next calls read the files again, for example after they
+ * have been modified.
+ *
+ * Since: UNRELEASED
+ */
+void
+fs_utils_invalidate_default_preferences_cache (void)
+{
+  G_LOCK (default_preferences);
+  if (default_preferences)
+    g_hash_table_remove_all (default_preferences);
+  G_UNLOCK (default_preferences);
+}
+
 static GList *
 load_default_codec_preferences_from_path (const gchar *element_name,
     const gchar *path)
@@ -61,6 +134,29 @@ factory_name_from_element (GstElement *element)
     return NULL;
 }
 
+static GList *
+load_default_codec_preferences (const gchar *factory_name)
+{
+  const gchar * const * system_data_dirs = g_get_system_data_dirs ();
+  GList *codec_prefs = NULL;
+  guint i;
+
+  codec_prefs = load_default_codec_preferences_from_path (factory_name,
+      g_get_user_data_dir ());
+  if (codec_prefs)
+    return codec_prefs;
+
+  for (i = 0; system_data_dirs[i]; i++)
+  {
+    codec_prefs = load_default_codec_preferences_from_path (factory_name,
+        system_data_dirs[i]);
+    if (codec_prefs)
+      return codec_prefs;
+  }
+
+  return NULL;
+}
+
 /**
  * fs_utils_get_default_codec_preferences:
  * @element: Element for which to fetch default codec preferences
@@ -76,28 +172,46 @@ factory_name_from_element (GstElement *element)
 GList *
 fs_utils_get_default_codec_preferences (GstElement *element)
 {
-  const gchar * const * system_data_dirs = g_get_system_data_dirs ();
-  GList *codec_prefs = NULL;
-  guint i;
+  DefaultPreferences *prefs;
+  GList *codec_prefs;
   const gchar *factory_name = factory_name_from_element (element);
 
   if (!factory_name)
     return NULL;
 
-  codec_prefs = load_default_codec_preferences_from_path (factory_name,
-      g_get_user_data_dir ());
-  if (codec_prefs)
-    return codec_prefs;
-
-  for (i = 0; system_data_dirs[i]; i++)
+  G_LOCK (default_preferences);
+  prefs = get_default_preferences_locked (factory_name);
+  if (!prefs->codec_prefs_loaded)
   {
-    codec_prefs = load_default_codec_preferences_from_path (factory_name,
-        system_data_dirs[i]);
-    if (codec_prefs)
-      return codec_prefs;
+    prefs->codec_prefs = load_default_codec_preferences (factory_name);
+    prefs->codec_prefs_loaded = TRUE;
   }
+  codec_prefs = fs_codec_list_copy (prefs->codec_prefs);
+  G_UNLOCK (default_preferences);
 
-  return NULL;
+  return codec_prefs;
+}
+
+static gchar *
+load_default_element_properties (const gchar *factory_name)
+{
+  gboolean file_loaded;
+  GKeyFile *keyfile = g_key_file_new ();
+  gchar *filename;
+  gchar *data = NULL;
+
+  filename = g_build_filename (PACKAGE, FS_APIVERSION, factory_name,
+      "default-element-properties", NULL);
+  file_loaded = g_key_file_load_from_data_dirs (keyfile, filename, NULL,
+      G_KEY_FILE_NONE, NULL);
+  g_free (filename);
+
+  if (file_loaded)
+    data = g_key_file_to_data (keyfile, NULL, NULL);
+
+  g_key_file_free (keyfile);
+
+  return data;
 }
 
 /**
@@ -116,29 +230,103 @@ fs_utils_get_default_codec_preferences (GstElement *element)
 GKeyFile *
 fs_utils_get_default_element_properties (GstElement *element)
 {
-  gboolean file_loaded;
-  GKeyFile *keyfile = g_key_file_new ();
-  gchar *filename;
+  DefaultPreferences *prefs;
+  GKeyFile *keyfile = NULL;
   const gchar *factory_name = factory_name_from_element (element);
 
   if (factory_name == NULL)
     return NULL;
 
-  filename = g_build_filename (PACKAGE, FS_APIVERSION, factory_name,
-      "default-element-properties", NULL);
-  file_loaded = g_key_file_load_from_data_dirs (keyfile, filename, NULL,
-      G_KEY_FILE_NONE, NULL);
-  g_free (filename);
-
-  if (file_loaded)
+  G_LOCK (default_preferences);
+  prefs = get_default_preferences_locked (factory_name);
+  if (!prefs->element_properties_loaded)
   {
-    return keyfile;
+    prefs->element_properties = load_default_element_properties (factory_name);
+    prefs->element_properties_loaded = TRUE;
   }
-  else
+
+  if (prefs->element_properties)
   {
-    g_key_file_free (keyfile);
-    return NULL;
+    keyfile = g_key_file_new ();
+    if (!g_key_file_load_from_data (keyfile, prefs->element_properties, -1,
+            G_KEY_FILE_NONE, NULL))
+    {
+      g_key_file_free (keyfile);
+      keyfile = NULL;
+    }
   }
+  G_UNLOCK (default_preferences);
+
+  return keyfile;
+}
+
+/*
+ * Which property to use and its unit only depend on the type of the element,
+ * so they are resolved once per type.
+ */
+
+typedef struct {
+  GParamSpec *spec;
+  glong divisor;
+} BitrateProperty;
+
+G_LOCK_DEFINE_STATIC (bitrate_properties);
+static GHashTable *bitrate_properties = NULL;
+
+static void
+bitrate_property_free (gpointer data)
+{
+  BitrateProperty *prop = data;
+
+  g_param_spec_unref (prop->spec);
+  g_slice_free (BitrateProperty, prop);
+}
+
+static BitrateProperty *
+resolve_bitrate_property (GstElement *element)
+{
+  const char *elements_in_kbps[] = { "lamemp3enc", "lame", "x264enc", "twolame",
+    "mpeg2enc", NULL
+  };
+  int i;
+  GType type = G_OBJECT_TYPE (element);
+  BitrateProperty *prop;
+  GParamSpec *spec;
+  const gchar *factory_name;
+
+  G_LOCK (bitrate_properties);
+  if (!bitrate_properties)
+    bitrate_properties = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+        NULL, bitrate_property_free);
+
+  prop = g_hash_table_lookup (bitrate_properties, GSIZE_TO_POINTER (type));
+  if (prop)
+    goto out;
+
+  spec = g_object_class_find_property (G_OBJECT_GET_CLASS (element), "bitrate");
+  if (!spec)
+    goto out;
+
+  prop = g_slice_new (BitrateProperty);
+  prop->spec = g_param_spec_ref (spec);
+  prop->divisor = 1;
+
+  factory_name = factory_name_from_element (element);
+
+  /* divide by 1000 for elements that are known to use kbs */
+  for (i = 0; elements_in_kbps[i]; i++)
+    if (factory_name && !strcmp (factory_name, elements_in_kbps[i]))
+    {
+      prop->divisor = 1000;
+      break;
+    }
+
+  g_hash_table_insert (bitrate_properties, GSIZE_TO_POINTER (type), prop);
+
+ out:
+  G_UNLOCK (bitrate_properties);
+
+  return prop;
 }
 
 /**
@@ -157,29 +345,15 @@ void
 fs_utils_set_bitrate (GstElement *element, glong bitrate)
 {
   GParamSpec *spec;
-  const char *elements_in_kbps[] = { "lamemp3enc", "lame", "x264enc", "twolame",
-    "mpeg2enc", NULL
-  };
-  int i;
-  GstElementFactory *factory;
-  const gchar *factory_name = NULL;
+  BitrateProperty *prop;
 
   g_return_if_fail (GST_IS_ELEMENT (element));
 
-  spec = g_object_class_find_property (G_OBJECT_GET_CLASS (element), "bitrate");
-  g_return_if_fail (spec != NULL);
+  prop = resolve_bitrate_property (element);
+  g_return_if_fail (prop != NULL);
 
-  factory = gst_element_get_factory (element);
-  if (factory)
-    factory_name = gst_plugin_feature_get_name (GST_PLUGIN_FEATURE (factory));
-
-  /* divide by 1000 for elements that are known to use kbs */
-  for (i = 0; elements_in_kbps[i]; i++)
-    if (factory_name && !strcmp (factory_name, elements_in_kbps[i]))
-    {
-      bitrate /= 1000;
-      break;
-    }
+  spec = prop->spec;
+  bitrate /= prop->divisor;
 
   if (G_PARAM_SPEC_TYPE (spec) == G_TYPE_LONG)
   {
@@ -231,6 +405,30 @@ load_default_rtp_hdrext_preferences_from_path (const gchar *element_name,
   return rtp_hdrext_prefs;
 }
 
+static GList *
+load_default_rtp_hdrext_preferences (const gchar *factory_name,
+    FsMediaType media_type)
+{
+  const gchar * const * system_data_dirs = g_get_system_data_dirs ();
+  GList *rtp_hdrext_prefs = NULL;
+  guint i;
+
+  rtp_hdrext_prefs = load_default_rtp_hdrext_preferences_from_path (
+    factory_name, g_get_user_data_dir (), media_type);
+  if (rtp_hdrext_prefs)
+    return rtp_hdrext_prefs;
+
+  for (i = 0; system_data_dirs[i]; i++)
+  {
+    rtp_hdrext_prefs = load_default_rtp_hdrext_preferences_from_path (
+      factory_name, system_data_dirs[i], media_type);
+    if (rtp_hdrext_prefs)
+      return rtp_hdrext_prefs;
+  }
+
+  return NULL;
+}
+
 /**
  * fs_utils_get_default_rtp_header_extension_preferences:
  * @element: Element for which to fetch default RTP Header Extension preferences
@@ -249,26 +447,26 @@ GList *
 fs_utils_get_default_rtp_header_extension_preferences (GstElement *element,
     FsMediaType media_type)
 {
-  const gchar * const * system_data_dirs = g_get_system_data_dirs ();
-  GList *rtp_hdrext_prefs = NULL;
-  guint i;
+  DefaultPreferences *prefs;
+  GList *rtp_hdrext_prefs;
   const gchar *factory_name = factory_name_from_element (element);
 
+  g_return_val_if_fail (media_type <= FS_MEDIA_TYPE_LAST, NULL);
+
   if (!factory_name)
     return NULL;
 
-  rtp_hdrext_prefs = load_default_rtp_hdrext_preferences_from_path (
-    factory_name, g_get_user_data_dir (), media_type);
-  if (rtp_hdrext_prefs)
-    return rtp_hdrext_prefs;
-
-  for (i = 0; system_data_dirs[i]; i++)
+  G_LOCK (default_preferences);
+  prefs = get_default_preferences_locked (factory_name);
+  if (!prefs->hdrext_prefs_loaded[media_type])
   {
-    rtp_hdrext_prefs = load_default_rtp_hdrext_preferences_from_path (
-      factory_name, system_data_dirs[i], media_type);
-    if (rtp_hdrext_prefs)
-      return rtp_hdrext_prefs;
+    prefs->hdrext_prefs[media_type] = load_default_rtp_hdrext_preferences (
+        factory_name, media_type);
+    prefs->hdrext_prefs_loaded[media_type] = TRUE;
   }
+  rtp_hdrext_prefs = fs_rtp_header_extension_list_copy (
+      prefs->hdrext_prefs[media_type]);
+  G_UNLOCK (default_preferences);
 
-  return NULL;
+  return rtp_hdrext_prefs;
 }
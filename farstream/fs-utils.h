@@ -40,6 +40,8 @@ void fs_utils_set_bitrate (GstElement *element, glong bitrate);
 GList *fs_utils_get_default_rtp_header_extension_preferences (
   GstElement *element, FsMediaType media_type);
 
+void fs_utils_invalidate_default_preferences_cache (void);
+
 G_END_DECLS
 
 #endif /* __FS_UTILS_H__ */
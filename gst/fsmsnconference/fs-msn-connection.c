@@ -33,6 +33,7 @@
 #include <arpa/inet.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <netdb.h>
 #include <netinet/in.h>
 #include <string.h>
 #include <sys/socket.h>
@@ -79,18 +80,48 @@ typedef enum {
 typedef struct _FsMsnPollFD FsMsnPollFD;
 typedef void (*PollFdCallback) (FsMsnConnection *self, FsMsnPollFD *pollfd);
 
+/* Each socket is a GSource attached to the shared polling thread */
+
 struct _FsMsnPollFD {
-  GstPollFD pollfd;
+  GSource source;
+  GPollFD pollfd;
+  /* Not a reference, the sources are destroyed in dispose */
+  FsMsnConnection *self;
+  gboolean polled;
   FsMsnStatus status;
   gboolean server;
   gboolean want_read;
   gboolean want_write;
   PollFdCallback callback;
+  gchar *address;
+  gint64 start_time;
 };
 
+/*
+ * Remote candidates are raced: a new connection attempt is started every
+ * FS_MSN_CONNECTION_ATTEMPT_DELAY ms, or as soon as one fails, and the
+ * first one that completes the handshake wins
+ */
+#define FS_MSN_CONNECTION_ATTEMPT_DELAY 250
+
+#define POLLFD_HAS_ERROR(p)  ((p)->pollfd.revents & (G_IO_ERR | G_IO_NVAL))
+#define POLLFD_HAS_CLOSED(p) ((p)->pollfd.revents & G_IO_HUP)
+#define POLLFD_CAN_READ(p)   ((p)->pollfd.revents & (G_IO_IN | G_IO_PRI))
+#define POLLFD_CAN_WRITE(p)  ((p)->pollfd.revents & G_IO_OUT)
+
 #define FS_MSN_CONNECTION_LOCK(conn)   g_rec_mutex_lock(&(conn)->mutex)
 #define FS_MSN_CONNECTION_UNLOCK(conn) g_rec_mutex_unlock(&(conn)->mutex)
 
+/*
+ * All of the connections of the process are polled from a single thread,
+ * it is started by the first connection and is never stopped.
+ * The GMainContext still hands every polled fd to poll() and checks every
+ * source on each wakeup, so a wakeup costs O(number of sockets), only the
+ * callbacks are limited to the ready sockets.
+ */
+static GMutex reactor_mutex;
+static GMainContext *reactor_context = NULL;
+
 
 G_DEFINE_TYPE(FsMsnConnection, fs_msn_connection, G_TYPE_OBJECT);
 
@@ -118,7 +149,12 @@ static void successful_connection_cb (FsMsnConnection *self, FsMsnPollFD *fd);
 static void accept_connection_cb (FsMsnConnection *self, FsMsnPollFD *fd);
 static void connection_cb (FsMsnConnection *self, FsMsnPollFD *fd);
 
-static gpointer connection_polling_thread (gpointer data);
+static gboolean fs_msn_connection_ensure_context_locked (FsMsnConnection *self,
+    GError **error);
+static void pollfd_update_events (FsMsnPollFD *pollfd);
+static gboolean fs_msn_connection_attempt_next_locked (FsMsnConnection *self,
+    GError **error);
+static void schedule_next_attempt_locked (FsMsnConnection *self);
 static void shutdown_fd (FsMsnConnection *self, FsMsnPollFD *pollfd,
     gboolean equal);
 static void shutdown_fd_locked (FsMsnConnection *self, FsMsnPollFD *pollfd,
@@ -190,33 +226,85 @@ fs_msn_connection_init (FsMsnConnection *self)
 {
   /* member init */
 
-  self->poll_timeout = GST_CLOCK_TIME_NONE;
-  self->poll = gst_poll_new (TRUE);
-  gst_poll_set_flushing (self->poll, FALSE);
   self->pollfds = g_ptr_array_new ();
 
   g_rec_mutex_init (&self->mutex);
 }
 
+typedef struct {
+  FsMsnConnection *self;
+  GMutex mutex;
+  GCond cond;
+  gboolean done;
+} DetachData;
+
+static gboolean
+detach_sources_cb (gpointer user_data)
+{
+  DetachData *data = user_data;
+  FsMsnConnection *self = data->self;
+  gint i;
+
+  FS_MSN_CONNECTION_LOCK (self);
+  for (i = 0; i < self->pollfds->len; i++)
+    g_source_destroy (g_ptr_array_index (self->pollfds, i));
+  if (self->attempt_source)
+    g_source_destroy (self->attempt_source);
+  FS_MSN_CONNECTION_UNLOCK (self);
+
+  g_mutex_lock (&data->mutex);
+  data->done = TRUE;
+  g_cond_signal (&data->cond);
+  g_mutex_unlock (&data->mutex);
+
+  return FALSE;
+}
+
 static void
 fs_msn_connection_dispose (GObject *object)
 {
   FsMsnConnection *self = FS_MSN_CONNECTION (object);
+  GMainContext *context;
 
   FS_MSN_CONNECTION_LOCK(self);
+  context = self->context;
+  self->context = NULL;
+  FS_MSN_CONNECTION_UNLOCK(self);
 
-  if (self->polling_thread)
+  /* The sources are destroyed from the polling thread, so that none of
+   * their callbacks can still be running once we return */
+  if (context)
   {
-    GThread *polling_thread = g_thread_ref (self->polling_thread);
-    gst_poll_set_flushing (self->poll, TRUE);
-    FS_MSN_CONNECTION_UNLOCK(self);
-    g_thread_join (polling_thread);
-    FS_MSN_CONNECTION_LOCK(self);
-    g_thread_unref (polling_thread);
-    self->polling_thread = NULL;
-  }
+    DetachData data;
 
-  FS_MSN_CONNECTION_UNLOCK(self);
+    data.self = self;
+    data.done = FALSE;
+    g_mutex_init (&data.mutex);
+    g_cond_init (&data.cond);
+
+    if (g_main_context_is_owner (context))
+    {
+      detach_sources_cb (&data);
+    }
+    else
+    {
+      GSource *idle = g_idle_source_new ();
+
+      g_source_set_priority (idle, G_PRIORITY_HIGH);
+      g_source_set_callback (idle, detach_sources_cb, &data, NULL);
+      g_source_attach (idle, context);
+      g_source_unref (idle);
+
+      g_mutex_lock (&data.mutex);
+      while (!data.done)
+        g_cond_wait (&data.cond, &data.mutex);
+      g_mutex_unlock (&data.mutex);
+    }
+
+    g_mutex_clear (&data.mutex);
+    g_cond_clear (&data.cond);
+    g_main_context_unref (context);
+  }
 
   G_OBJECT_CLASS (fs_msn_connection_parent_class)->dispose (object);
 }
@@ -230,16 +318,19 @@ fs_msn_connection_finalize (GObject *object)
   g_free (self->local_recipient_id);
   g_free (self->remote_recipient_id);
 
-  gst_poll_free (self->poll);
-
   for (i = 0; i < self->pollfds->len; i++)
   {
     FsMsnPollFD *p = g_ptr_array_index(self->pollfds, i);
     close (p->pollfd.fd);
-    g_slice_free (FsMsnPollFD, p);
+    g_source_destroy ((GSource *) p);
+    g_source_unref ((GSource *) p);
   }
   g_ptr_array_free (self->pollfds, TRUE);
 
+  if (self->attempt_source)
+    g_source_unref (self->attempt_source);
+  fs_candidate_list_destroy (self->pending_candidates);
+
   g_rec_mutex_clear (&self->mutex);
 
   G_OBJECT_CLASS (fs_msn_connection_parent_class)->finalize (object);
@@ -322,10 +413,7 @@ fs_msn_connection_gather_local_candidates (FsMsnConnection *self,
 
   FS_MSN_CONNECTION_LOCK(self);
 
-  self->polling_thread = g_thread_try_new ("msn polling thread",
-      connection_polling_thread, self, error);
-
-  if (!self->polling_thread)
+  if (!fs_msn_connection_ensure_context_locked (self, error))
   {
     FS_MSN_CONNECTION_UNLOCK(self);
     return FALSE;
@@ -339,6 +427,161 @@ fs_msn_connection_gather_local_candidates (FsMsnConnection *self,
 }
 
 
+static gboolean
+candidate_is_ipv6 (FsCandidate *candidate)
+{
+  return strchr (candidate->ip, ':') != NULL;
+}
+
+/*
+ * Returns copies of the candidates, alternating between the address family
+ * of the first candidate and the other one, so that an unreachable family
+ * does not delay the other
+ */
+static GList *
+interleave_candidates (GList *candidates)
+{
+  GList *item;
+  GList *first = NULL;
+  GList *other = NULL;
+  GList *result = NULL;
+  gboolean first_ipv6 = candidate_is_ipv6 (candidates->data);
+
+  for (item = candidates; item; item = g_list_next (item))
+  {
+    FsCandidate *candidate = item->data;
+
+    if (candidate_is_ipv6 (candidate) == first_ipv6)
+      first = g_list_prepend (first, fs_candidate_copy (candidate));
+    else
+      other = g_list_prepend (other, fs_candidate_copy (candidate));
+  }
+
+  first = g_list_reverse (first);
+  other = g_list_reverse (other);
+
+  while (first || other)
+  {
+    if (first)
+    {
+      result = g_list_prepend (result, first->data);
+      first = g_list_delete_link (first, first);
+    }
+    if (other)
+    {
+      result = g_list_prepend (result, other->data);
+      other = g_list_delete_link (other, other);
+    }
+  }
+
+  return g_list_reverse (result);
+}
+
+/* Starts the next queued candidate, skipping those that fail right away */
+
+static gboolean
+fs_msn_connection_attempt_next_locked (FsMsnConnection *self, GError **error)
+{
+  GError *myerror = NULL;
+
+  while (self->pending_candidates)
+  {
+    FsCandidate *candidate = self->pending_candidates->data;
+    gboolean started;
+
+    self->pending_candidates = g_list_delete_link (self->pending_candidates,
+        self->pending_candidates);
+
+    g_clear_error (&myerror);
+    started = fs_msn_connection_attempt_connection_locked (self, candidate,
+        &myerror);
+    if (!started)
+      GST_WARNING ("Could not start connection to %s:%u: %s", candidate->ip,
+          candidate->port, myerror->message);
+    fs_candidate_destroy (candidate);
+
+    if (started)
+      return TRUE;
+  }
+
+  if (myerror)
+    g_propagate_error (error, myerror);
+  else
+    g_set_error (error, FS_ERROR, FS_ERROR_NETWORK,
+        "No remote candidate left to connect to");
+
+  return FALSE;
+}
+
+static gboolean
+next_attempt_timeout_cb (gpointer user_data)
+{
+  FsMsnConnection *self = g_object_ref (user_data);
+  gboolean failed = FALSE;
+
+  FS_MSN_CONNECTION_LOCK (self);
+  if (!g_source_is_destroyed (g_main_current_source ()))
+  {
+    if (!fs_msn_connection_attempt_next_locked (self, NULL))
+      failed = (self->pollfds->len <= 1);
+    schedule_next_attempt_locked (self);
+  }
+  FS_MSN_CONNECTION_UNLOCK (self);
+
+  if (failed)
+    g_signal_emit (self, signals[SIGNAL_CONNECTION_FAILED], 0);
+
+  g_object_unref (self);
+
+  return FALSE;
+}
+
+static void
+schedule_next_attempt_locked (FsMsnConnection *self)
+{
+  if (self->attempt_source)
+  {
+    g_source_destroy (self->attempt_source);
+    g_source_unref (self->attempt_source);
+    self->attempt_source = NULL;
+  }
+
+  if (self->pending_candidates && self->context)
+  {
+    self->attempt_source =
+      g_timeout_source_new (FS_MSN_CONNECTION_ATTEMPT_DELAY);
+    g_source_set_callback (self->attempt_source, next_attempt_timeout_cb,
+        self, NULL);
+    g_source_attach (self->attempt_source, self->context);
+  }
+}
+
+static void
+connection_attempt_failed (FsMsnConnection *self, FsMsnPollFD *pollfd)
+{
+  gboolean failed;
+
+  GST_INFO ("Connection on fd %d (%s) failed after %" G_GINT64_FORMAT " ms",
+      pollfd->pollfd.fd, pollfd->address ? pollfd->address : "incoming",
+      (g_get_monotonic_time () - pollfd->start_time) / 1000);
+
+  FS_MSN_CONNECTION_LOCK (self);
+  shutdown_fd_locked (self, pollfd, TRUE);
+
+  /* Don't wait for the timer, race the next candidate right away */
+  if (self->pending_candidates)
+  {
+    fs_msn_connection_attempt_next_locked (self, NULL);
+    schedule_next_attempt_locked (self);
+  }
+
+  failed = (self->pollfds->len <= 1);
+  FS_MSN_CONNECTION_UNLOCK (self);
+
+  if (failed)
+    g_signal_emit (self, signals[SIGNAL_CONNECTION_FAILED], 0);
+}
+
 /**
  * fs_msn_connection_add_remote_candidate:
  */
@@ -421,18 +664,16 @@ fs_msn_connection_add_remote_candidates (FsMsnConnection *self,
     }
   }
 
+  if (!fs_msn_connection_ensure_context_locked (self, error))
+    goto out;
+
   self->remote_recipient_id = g_strdup (recipient_id);
   self->session_id = session_id;
-  ret = TRUE;
-  for (item = candidates; item; item = g_list_next (item))
-  {
-    FsCandidate *candidate = item->data;
-    if (!fs_msn_connection_attempt_connection_locked (self, candidate, error))
-    {
-      ret = FALSE;
-      break;
-    }
-  }
+
+  self->pending_candidates = g_list_concat (self->pending_candidates,
+      interleave_candidates (candidates));
+  ret = fs_msn_connection_attempt_next_locked (self, error);
+  schedule_next_attempt_locked (self);
 
  out:
   FS_MSN_CONNECTION_UNLOCK(self);
@@ -589,32 +830,45 @@ fs_msn_connection_attempt_connection_locked (FsMsnConnection *connection,
     GError **error)
 {
   FsMsnConnection *self = FS_MSN_CONNECTION (connection);
+  FsMsnPollFD *pollfd;
   gint fd = -1;
   gint ret;
-  struct sockaddr_in theiraddr;
-  memset(&theiraddr, 0, sizeof(theiraddr));
-
+  struct addrinfo hints;
+  struct addrinfo *res = NULL;
+  gchar port_str[6];
+
+  memset (&hints, 0, sizeof (hints));
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  hints.ai_flags = AI_NUMERICHOST | AI_NUMERICSERV;
+  snprintf (port_str, sizeof (port_str), "%u", candidate->port);
+
+  ret = getaddrinfo (candidate->ip, port_str, &hints, &res);
+  if (ret != 0)
+  {
+    g_set_error (error, FS_ERROR, FS_ERROR_INVALID_ARGUMENTS,
+        "Invalid address %s: %s", candidate->ip, gai_strerror (ret));
+    return FALSE;
+  }
 
-  if ( (fd = socket(PF_INET, SOCK_STREAM, 0)) == -1 )
+  if ( (fd = socket(res->ai_family, SOCK_STREAM, 0)) == -1 )
   {
     gchar error_str[256];
     strerror_r (errno, error_str, 256);
     g_set_error (error, FS_ERROR, FS_ERROR_NETWORK,
         "Could not create socket: %s", error_str);
+    freeaddrinfo (res);
     return FALSE;
   }
 
   // set non-blocking mode
   fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
 
-  theiraddr.sin_family = AF_INET;
-  theiraddr.sin_addr.s_addr = inet_addr (candidate->ip);
-  theiraddr.sin_port = htons (candidate->port);
-
   GST_DEBUG ("Attempting connection to %s %d on socket %d", candidate->ip,
       candidate->port, fd);
   // this is non blocking, the return value isn't too usefull
-  ret = connect (fd, (struct sockaddr *) &theiraddr, sizeof (theiraddr));
+  ret = connect (fd, res->ai_addr, res->ai_addrlen);
+  freeaddrinfo (res);
   if (ret < 0 && errno != EINPROGRESS)
   {
     gchar error_str[256];
@@ -626,7 +880,9 @@ fs_msn_connection_attempt_connection_locked (FsMsnConnection *connection,
   }
 
   FS_MSN_CONNECTION_LOCK (self);
-  add_pollfd_locked (self, fd, successful_connection_cb, TRUE, TRUE, FALSE);
+  pollfd = add_pollfd_locked (self, fd, successful_connection_cb, TRUE, TRUE,
+      FALSE);
+  pollfd->address = g_strdup_printf ("%s:%u", candidate->ip, candidate->port);
   FS_MSN_CONNECTION_UNLOCK (self);
 
   return TRUE;
@@ -639,8 +895,7 @@ accept_connection_cb (FsMsnConnection *self, FsMsnPollFD *pollfd)
   int fd = -1;
   socklen_t n = sizeof (in);
 
-  if (gst_poll_fd_has_error (self->poll, &pollfd->pollfd) ||
-      gst_poll_fd_has_closed (self->poll, &pollfd->pollfd))
+  if (POLLFD_HAS_ERROR (pollfd) || POLLFD_HAS_CLOSED (pollfd))
   {
     GST_WARNING ("Error in accept socket : %d", pollfd->pollfd.fd);
     goto error;
@@ -678,8 +933,7 @@ successful_connection_cb (FsMsnConnection *self, FsMsnPollFD *pollfd)
   GST_DEBUG ("handler called on fd %d", pollfd->pollfd.fd);
 
   errno = 0;
-  if (gst_poll_fd_has_error (self->poll, &pollfd->pollfd) ||
-      gst_poll_fd_has_closed (self->poll, &pollfd->pollfd))
+  if (POLLFD_HAS_ERROR (pollfd) || POLLFD_HAS_CLOSED (pollfd))
   {
     GST_WARNING ("connecton closed or error");
     goto error;
@@ -709,8 +963,7 @@ successful_connection_cb (FsMsnConnection *self, FsMsnPollFD *pollfd)
   /* Error */
  error:
   GST_WARNING ("Got error from fd %d, closing", pollfd->pollfd.fd);
-  // find, shutdown and remove channel from fdlist
-  shutdown_fd (self, pollfd, TRUE);
+  connection_attempt_failed (self, pollfd);
 
   return;
 }
@@ -724,19 +977,16 @@ connection_cb (FsMsnConnection *self, FsMsnPollFD *pollfd)
   GST_DEBUG ("handler called on fd:%d server: %d status:%d r:%d w:%d",
       pollfd->pollfd.fd,
       pollfd->server, pollfd->status,
-      gst_poll_fd_can_read (self->poll, &pollfd->pollfd),
-      gst_poll_fd_can_write (self->poll, &pollfd->pollfd));
+      POLLFD_CAN_READ (pollfd) != 0, POLLFD_CAN_WRITE (pollfd) != 0);
 
-  if (gst_poll_fd_has_error (self->poll, &pollfd->pollfd) ||
-      gst_poll_fd_has_closed (self->poll, &pollfd->pollfd))
+  if (POLLFD_HAS_ERROR (pollfd) || POLLFD_HAS_CLOSED (pollfd))
   {
     GST_WARNING ("connecton closed or error (error: %d closed: %d)",
-        gst_poll_fd_has_error (self->poll, &pollfd->pollfd),
-        gst_poll_fd_has_closed (self->poll, &pollfd->pollfd));
+        POLLFD_HAS_ERROR (pollfd) != 0, POLLFD_HAS_CLOSED (pollfd) != 0);
     goto error;
   }
 
-  if (gst_poll_fd_can_read (self->poll, &pollfd->pollfd))
+  if (POLLFD_CAN_READ (pollfd))
   {
     switch (pollfd->status)
     {
@@ -758,7 +1008,7 @@ connection_cb (FsMsnConnection *self, FsMsnPollFD *pollfd)
               GST_DEBUG ("Authentication successful");
               pollfd->status = FS_MSN_STATUS_CONNECTED;
               pollfd->want_write = TRUE;
-              gst_poll_fd_ctl_write (self->poll, &pollfd->pollfd, TRUE);
+              pollfd_update_events (pollfd);
             }
             else
             {
@@ -800,7 +1050,7 @@ connection_cb (FsMsnConnection *self, FsMsnPollFD *pollfd)
               }
               pollfd->status = FS_MSN_STATUS_CONNECTED2;
               pollfd->want_write = TRUE;
-              gst_poll_fd_ctl_write (self->poll, &pollfd->pollfd, TRUE);
+              pollfd_update_events (pollfd);
             }
             else if (!self->producer)
             {
@@ -881,10 +1131,10 @@ connection_cb (FsMsnConnection *self, FsMsnPollFD *pollfd)
 
     }
   }
-  else if (gst_poll_fd_can_write (self->poll, &pollfd->pollfd))
+  else if (POLLFD_CAN_WRITE (pollfd))
   {
     pollfd->want_write = FALSE;
-    gst_poll_fd_ctl_write (self->poll, &pollfd->pollfd, FALSE);
+    pollfd_update_events (pollfd);
     switch (pollfd->status)
     {
       case FS_MSN_STATUS_AUTH:
@@ -971,95 +1221,183 @@ connection_cb (FsMsnConnection *self, FsMsnPollFD *pollfd)
   }
 
   if (success) {
-    // success! we need to shutdown/close all other channels
-    shutdown_fd (self, pollfd, FALSE);
+    GST_INFO ("Connection on fd %d (%s) established in %" G_GINT64_FORMAT
+        " ms", pollfd->pollfd.fd,
+        pollfd->address ? pollfd->address : "incoming",
+        (g_get_monotonic_time () - pollfd->start_time) / 1000);
+
+    // success! we need to cancel the other attempts and close their channels
+    FS_MSN_CONNECTION_LOCK (self);
+    fs_candidate_list_destroy (self->pending_candidates);
+    self->pending_candidates = NULL;
+    schedule_next_attempt_locked (self);
+    shutdown_fd_locked (self, pollfd, FALSE);
+    FS_MSN_CONNECTION_UNLOCK (self);
 
     g_signal_emit (self, signals[SIGNAL_CONNECTED], 0, pollfd->pollfd.fd);
 
+    /* The socket now belongs to the stream, stop watching it */
     pollfd->want_read = FALSE;
     pollfd->want_write = FALSE;
-    gst_poll_fd_ctl_read (self->poll, &pollfd->pollfd, FALSE);
-    gst_poll_fd_ctl_write (self->poll, &pollfd->pollfd, FALSE);
+    pollfd_update_events (pollfd);
   }
 
   return;
  error:
   /* Error */
   GST_WARNING ("Got error from fd %d, closing", pollfd->pollfd.fd);
-  shutdown_fd (self, pollfd, TRUE);
+  connection_attempt_failed (self, pollfd);
+
+  return;
+}
+
+static gboolean
+pollfd_source_prepare (GSource *source, gint *timeout)
+{
+  *timeout = -1;
+  return FALSE;
+}
+
+static gboolean
+pollfd_source_check (GSource *source)
+{
+  FsMsnPollFD *pollfd = (FsMsnPollFD *) source;
+
+  return pollfd->polled && pollfd->pollfd.revents != 0;
+}
+
+static gboolean
+pollfd_source_dispatch (GSource *source, GSourceFunc callback,
+    gpointer user_data)
+{
+  FsMsnPollFD *pollfd = (FsMsnPollFD *) source;
+  FsMsnConnection *self = g_object_ref (pollfd->self);
 
   FS_MSN_CONNECTION_LOCK (self);
-  success = (self->pollfds->len > 1);
+
+  /* It may have been shut down by the callback of another socket */
+  if (g_source_is_destroyed (source))
+    goto out;
+
+  GST_DEBUG ("%p - error %d, close %d, read %d-%d, write %d-%d",
+      pollfd,
+      POLLFD_HAS_ERROR (pollfd) != 0,
+      POLLFD_HAS_CLOSED (pollfd) != 0,
+      pollfd->want_read,
+      POLLFD_CAN_READ (pollfd) != 0,
+      pollfd->want_write,
+      POLLFD_CAN_WRITE (pollfd) != 0);
+
+  if (POLLFD_HAS_ERROR (pollfd) || POLLFD_HAS_CLOSED (pollfd))
+  {
+    pollfd->callback (self, pollfd);
+    if (!g_source_is_destroyed (source))
+      shutdown_fd_locked (self, pollfd, TRUE);
+  }
+  else if ((pollfd->want_read && POLLFD_CAN_READ (pollfd)) ||
+      (pollfd->want_write && POLLFD_CAN_WRITE (pollfd)))
+  {
+    pollfd->callback (self, pollfd);
+  }
+
+ out:
   FS_MSN_CONNECTION_UNLOCK (self);
+  g_object_unref (self);
 
-  if (!success)
-    g_signal_emit (self, signals[SIGNAL_CONNECTION_FAILED], 0);
+  return TRUE;
+}
 
-  return;
+static void
+pollfd_source_finalize (GSource *source)
+{
+  FsMsnPollFD *pollfd = (FsMsnPollFD *) source;
+
+  g_free (pollfd->address);
 }
 
-static gpointer
-connection_polling_thread (gpointer data)
+static GSourceFuncs pollfd_source_funcs = {
+  pollfd_source_prepare,
+  pollfd_source_check,
+  pollfd_source_dispatch,
+  pollfd_source_finalize
+};
+
+/* Only polls the socket if we are waiting for something on it */
+
+static void
+pollfd_update_events (FsMsnPollFD *pollfd)
 {
-  FsMsnConnection *self = data;
-  gint ret;
-  GstClockTime timeout;
-  GstPoll * poll;
+  GSource *source = (GSource *) pollfd;
+  GMainContext *context;
+  gushort events = 0;
 
-  FS_MSN_CONNECTION_LOCK(self);
-  timeout = self->poll_timeout;
-  poll = self->poll;
-  GST_DEBUG ("poll waiting %d", self->pollfds->len);
-  FS_MSN_CONNECTION_UNLOCK(self);
+  if (pollfd->want_read)
+    events |= G_IO_IN | G_IO_PRI;
+  if (pollfd->want_write)
+    events |= G_IO_OUT;
+
+  pollfd->pollfd.events = events;
 
-  while ((ret = gst_poll_wait (poll, timeout)) >= 0)
+  if (events && !pollfd->polled)
   {
-    GST_DEBUG ("gst_poll_wait returned : %d", ret);
-    FS_MSN_CONNECTION_LOCK(self);
-    if (ret > 0)
-    {
-      gint i;
+    g_source_add_poll (source, &pollfd->pollfd);
+    pollfd->polled = TRUE;
+  }
+  else if (!events && pollfd->polled)
+  {
+    g_source_remove_poll (source, &pollfd->pollfd);
+    pollfd->pollfd.revents = 0;
+    pollfd->polled = FALSE;
+  }
 
-      for (i = 0; i < self->pollfds->len; i++)
-      {
-        FsMsnPollFD *pollfd = NULL;
+  context = g_source_get_context (source);
+  if (context && !g_main_context_is_owner (context))
+    g_main_context_wakeup (context);
+}
 
-        pollfd = g_ptr_array_index(self->pollfds, i);
+static gpointer
+reactor_thread_func (gpointer data)
+{
+  GMainLoop *loop = data;
 
-        GST_DEBUG ("ret %d - i = %d, len = %d", ret, i, self->pollfds->len);
+  g_main_loop_run (loop);
 
-        GST_DEBUG ("%p - error %d, close %d, read %d-%d, write %d-%d",
-            pollfd,
-            gst_poll_fd_has_error (poll, &pollfd->pollfd),
-            gst_poll_fd_has_closed (poll, &pollfd->pollfd),
-            pollfd->want_read,
-            gst_poll_fd_can_read (poll, &pollfd->pollfd),
-            pollfd->want_write,
-            gst_poll_fd_can_write (poll, &pollfd->pollfd));
+  return NULL;
+}
 
-        if (gst_poll_fd_has_error (poll, &pollfd->pollfd) ||
-            gst_poll_fd_has_closed (poll, &pollfd->pollfd))
-        {
-          pollfd->callback (self, pollfd);
-          shutdown_fd_locked (self, pollfd, TRUE);
-          i--;
-          continue;
-        }
-        if ((pollfd->want_read &&
-                gst_poll_fd_can_read (poll, &pollfd->pollfd)) ||
-            (pollfd->want_write &&
-                gst_poll_fd_can_write (poll, &pollfd->pollfd)))
-        {
-          pollfd->callback (self, pollfd);
-        }
+static gboolean
+fs_msn_connection_ensure_context_locked (FsMsnConnection *self,
+    GError **error)
+{
+  if (self->context)
+    return TRUE;
 
-      }
+  g_mutex_lock (&reactor_mutex);
+  if (!reactor_context)
+  {
+    GMainContext *context = g_main_context_new ();
+    GMainLoop *loop = g_main_loop_new (context, FALSE);
+    GThread *thread;
+
+    thread = g_thread_try_new ("msn polling thread", reactor_thread_func,
+        loop, error);
+
+    if (thread)
+    {
+      g_thread_unref (thread);
+      reactor_context = context;
+    }
+    else
+    {
+      g_main_loop_unref (loop);
+      g_main_context_unref (context);
     }
-    timeout = self->poll_timeout;
-    FS_MSN_CONNECTION_UNLOCK(self);
   }
+  if (reactor_context)
+    self->context = g_main_context_ref (reactor_context);
+  g_mutex_unlock (&reactor_mutex);
 
-  return NULL;
+  return self->context != NULL;
 }
 
 
@@ -1084,20 +1422,16 @@ shutdown_fd_locked (FsMsnConnection *self, FsMsnPollFD *pollfd, gboolean equal)
     {
       GST_DEBUG ("Shutting down p %p (fd %d)", p, p->pollfd.fd);
 
-      if (!gst_poll_fd_has_closed (self->poll, &p->pollfd))
-        close (p->pollfd.fd);
-      if (!gst_poll_remove_fd (self->poll, &p->pollfd))
-        GST_WARNING ("Could not remove pollfd %p", p);
+      close (p->pollfd.fd);
+      g_source_destroy ((GSource *) p);
       g_ptr_array_remove_index_fast (self->pollfds, i);
-      g_slice_free (FsMsnPollFD, p);
+      g_source_unref ((GSource *) p);
       closed++;
       i--;
     }
   }
 
-  if (closed)
-    gst_poll_restart (self->poll);
-  else
+  if (!closed)
     GST_WARNING ("Could find pollfd to remove");
 }
 
@@ -1105,30 +1439,25 @@ static FsMsnPollFD *
 add_pollfd_locked (FsMsnConnection *self, int fd, PollFdCallback callback,
     gboolean read, gboolean write, gboolean server)
 {
-  FsMsnPollFD *pollfd = g_slice_new0 (FsMsnPollFD);
-  gst_poll_fd_init (&pollfd->pollfd);
+  FsMsnPollFD *pollfd = (FsMsnPollFD *) g_source_new (&pollfd_source_funcs,
+      sizeof (FsMsnPollFD));
+
+  pollfd->self = self;
   pollfd->pollfd.fd = fd;
   pollfd->server = server;
   pollfd->want_read = read;
   pollfd->want_write = write;
   pollfd->status = FS_MSN_STATUS_AUTH;
-
-  gst_poll_add_fd (self->poll, &pollfd->pollfd);
-
-  gst_poll_fd_ctl_read (self->poll, &pollfd->pollfd, read);
-  gst_poll_fd_ctl_write (self->poll, &pollfd->pollfd, write);
   pollfd->callback = callback;
+  pollfd->start_time = g_get_monotonic_time ();
 
-  GST_DEBUG ("ADD_POLLFD %p (%p) - error %d, close %d, read %d-%d, write %d-%d",
-      self->pollfds, pollfd,
-      gst_poll_fd_has_error (self->poll, &pollfd->pollfd),
-      gst_poll_fd_has_closed (self->poll, &pollfd->pollfd),
-      pollfd->want_read,
-      gst_poll_fd_can_read (self->poll, &pollfd->pollfd),
-      pollfd->want_write,
-      gst_poll_fd_can_write (self->poll, &pollfd->pollfd));
+  pollfd_update_events (pollfd);
+
+  GST_DEBUG ("ADD_POLLFD %p (%p) - read %d, write %d",
+      self->pollfds, pollfd, pollfd->want_read, pollfd->want_write);
 
   g_ptr_array_add (self->pollfds, pollfd);
-  gst_poll_restart (self->poll);
+  g_source_attach ((GSource *) pollfd, self->context);
+
   return pollfd;
 }
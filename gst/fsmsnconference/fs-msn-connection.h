@@ -73,10 +73,10 @@ struct _FsMsnConnection
   guint initial_port;
   gboolean producer;
 
-  GThread *polling_thread; /* protected by lock */
-  GstClockTime poll_timeout; /* protected by lock */
-  GstPoll *poll;
+  GMainContext *context; /* protected by lock */
   GPtrArray *pollfds; /* protected by lock */
+  GList *pending_candidates; /* protected by lock */
+  GSource *attempt_source; /* protected by lock */
   GRecMutex mutex;
 };
 
@@ -787,9 +787,7 @@ _stream_remote_codecs_changed (FsRawStream *stream, GParamSpec *pspec,
   GList *codecs;
   GstCaps *caps;
   FsCodec *codec = NULL;
-  GstPad *transform_pad;
   GError *error = NULL;
-  GstElement *transform = NULL;
   FsRawConference *conference = fs_raw_session_get_conference (self, &error);
   gboolean changed;
   FsStreamDirection direction;
@@ -808,52 +806,23 @@ _stream_remote_codecs_changed (FsRawStream *stream, GParamSpec *pspec,
   else
     codec = codecs->data;
 
-  GST_OBJECT_LOCK (conference);
-  transform = self->priv->transform_bin;
-  self->priv->transform_bin = NULL;
-  GST_OBJECT_UNLOCK (conference);
-
-  /* Replace the transform bin */
-  if (transform != NULL)
+  /* The transform bin stays in place, changing the caps of the capsfilter
+   * makes it renegotiate. The converters are in passthrough mode whenever
+   * the input already has the right format, so they don't copy anything.
+   */
+  caps = fs_raw_codec_to_gst_caps (codec);
+  if (caps == NULL)
   {
-    gst_element_set_locked_state (transform, TRUE);
-    gst_element_set_state (transform, GST_STATE_NULL);
-    gst_bin_remove (GST_BIN (conference), transform);
-    g_object_unref (transform);
-  }
-
-  transform = _create_transform_bin (self, &error);
-
-  if (transform == NULL)
-    goto error;
-  gst_object_ref_sink (transform);
-
-  if (!gst_bin_add (GST_BIN (conference), transform))
+    g_set_error (&error, FS_ERROR, FS_ERROR_INVALID_ARGUMENTS,
+        "Could not convert the remote codec to caps");
+    fs_codec_list_destroy (codecs);
     goto error;
-
-  caps = fs_raw_codec_to_gst_caps (codec);
+  }
   if (self->priv->send_capsfilter)
     g_object_set (self->priv->send_capsfilter, "caps", caps, NULL);
   gst_caps_unref (caps);
 
-  if (!gst_element_link_pads (transform, "src",
-          self->priv->send_capsfilter, "sink"))
-    goto error;
-
-  if (!gst_element_sync_state_with_parent (transform))
-    goto error;
-
-  transform_pad = gst_element_get_static_pad (transform, "sink");
-  if (transform_pad == NULL)
-    goto error;
-
-  if (GST_PAD_LINK_FAILED (gst_pad_link (self->priv->send_tee_pad,
-      transform_pad)))
-    goto error;
-
   GST_OBJECT_LOCK (conference);
-  self->priv->transform_bin = transform;
-  transform = NULL;
 
   if (self->priv->codecs)
     fs_codec_list_destroy (self->priv->codecs);
@@ -909,12 +878,10 @@ error:
   else
     fs_session_emit_error (FS_SESSION (self), FS_ERROR_INTERNAL,
         "Unable to change transform bin");
+  g_clear_error (&error);
 
   if (conference != NULL)
     gst_object_unref (conference);
-
-  if (transform != NULL)
-    gst_object_unref (transform);
 }
 
 void
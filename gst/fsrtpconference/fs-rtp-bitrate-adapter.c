@@ -33,6 +33,9 @@
 /* This is H.264... other codecs (H.265 / VP9 ) will have different numbers */
 #define  H264_MAX_PIXELS_PER_BIT 25
 
+/* Understood by fsvideoanyrate in the send codec bins */
+#define MAX_FRAMERATE_EVENT "farstream-max-framerate"
+
 GST_DEBUG_CATEGORY_STATIC (fs_rtp_bitrate_adapter_debug);
 #define GST_CAT_DEFAULT fs_rtp_bitrate_adapter_debug
 
@@ -177,6 +180,8 @@ fs_rtp_bitrate_adapter_finalize (GObject *object)
   g_queue_foreach (&self->bitrate_history, (GFunc) bitrate_point_free, NULL);
   g_queue_clear(&self->bitrate_history);
 
+  gst_event_replace (&self->framerate_event, NULL);
+
   G_OBJECT_CLASS (fs_rtp_bitrate_adapter_parent_class)->finalize (object);
 }
 
@@ -405,10 +410,20 @@ fs_rtp_bitrate_adapter_chain (GstPad *pad, GstObject *parent,
 {
   FsRtpBitrateAdapter *self = FS_RTP_BITRATE_ADAPTER (parent);
   GstFlowReturn ret;
+  GstEvent *framerate_event;
 
   if (!self)
     return GST_FLOW_NOT_LINKED;
 
+  /* The event is serialized, so it can only be pushed from here */
+  GST_OBJECT_LOCK (self);
+  framerate_event = self->framerate_event;
+  self->framerate_event = NULL;
+  GST_OBJECT_UNLOCK (self);
+
+  if (framerate_event)
+    gst_pad_push_event (self->srcpad, framerate_event);
+
   ret = gst_pad_push (self->srcpad, buffer);
 
   return ret;
@@ -446,10 +461,64 @@ fs_rtp_bitrate_adapter_get_bitrate_locked (FsRtpBitrateAdapter *self)
     return G_MAXUINT;
 }
 
+/*
+ * Tells the elements downstream how many frames per second the current
+ * resolution can have at this bitrate, so they can drop the extra frames
+ * before they are encoded. The event is sticky so that a codec bin linked
+ * after a codec change gets the current limit with its first buffer.
+ * It is only queued here and pushed from the streaming thread before the
+ * next buffer.
+ */
+static void
+fs_rtp_bitrate_adapter_push_max_framerate (FsRtpBitrateAdapter *self,
+    guint bitrate)
+{
+  GstCaps *caps = gst_pad_get_current_caps (self->srcpad);
+  GstStructure *s;
+  gint width, height;
+  guint max_framerate = 0;
+  GstEvent *event;
+
+  if (!caps)
+    return;
+
+  s = gst_caps_get_structure (caps, 0);
+  if (!g_str_has_prefix (gst_structure_get_name (s), "video/") ||
+      !gst_structure_get_int (s, "width", &width) ||
+      !gst_structure_get_int (s, "height", &height) ||
+      width <= 0 || height <= 0)
+  {
+    gst_caps_unref (caps);
+    return;
+  }
+  gst_caps_unref (caps);
+
+  if (bitrate != G_MAXUINT)
+  {
+    guint64 max_pixels_per_second = (guint64) bitrate * H264_MAX_PIXELS_PER_BIT;
+
+    max_framerate = CLAMP (max_pixels_per_second / (width * height), 1, 66);
+  }
+
+  GST_DEBUG_OBJECT (self, "Limiting the framerate to %u for %dx%d at %u",
+      max_framerate, width, height, bitrate);
+
+  event = gst_event_new_custom (GST_EVENT_CUSTOM_DOWNSTREAM_STICKY,
+      gst_structure_new (MAX_FRAMERATE_EVENT,
+          "framerate", GST_TYPE_FRACTION, max_framerate, 1,
+          NULL));
+
+  GST_OBJECT_LOCK (self);
+  gst_event_replace (&self->framerate_event, event);
+  GST_OBJECT_UNLOCK (self);
+  gst_event_unref (event);
+}
+
 static void
 fs_rtp_bitrate_adapter_updated_unlock (FsRtpBitrateAdapter *self)
 {
   gboolean changed = FALSE;
+  guint bitrate;
 
   self->bitrate = fs_rtp_bitrate_adapter_get_bitrate_locked (self);
 
@@ -461,10 +530,14 @@ fs_rtp_bitrate_adapter_updated_unlock (FsRtpBitrateAdapter *self)
     self->last_bitrate = self->bitrate;
     changed = TRUE;
   }
+  bitrate = self->bitrate;
   GST_OBJECT_UNLOCK (self);
 
   if (changed)
+  {
     gst_pad_push_event (self->sinkpad, gst_event_new_reconfigure ());
+    fs_rtp_bitrate_adapter_push_max_framerate (self, bitrate);
+  }
 }
 
 static void
@@ -606,6 +679,9 @@ fs_rtp_bitrate_adapter_change_state (GstElement *element,
 
   switch (transition) {
     case GST_STATE_CHANGE_PAUSED_TO_READY:
+      GST_OBJECT_LOCK (self);
+      gst_event_replace (&self->framerate_event, NULL);
+      GST_OBJECT_UNLOCK (self);
       self->last_bitrate = G_MAXUINT;
       g_queue_foreach (&self->bitrate_history, (GFunc) bitrate_point_free,
           NULL);
@@ -58,6 +58,9 @@ struct _FsRtpBitrateAdapter
   GstClockID clockid;
   guint bitrate;
   guint last_bitrate;
+
+  /* The max-framerate event to push before the next buffer */
+  GstEvent *framerate_event;
 };
 
 struct _FsRtpBitrateAdapterClass
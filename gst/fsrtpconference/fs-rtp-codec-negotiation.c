@@ -47,9 +47,6 @@ static CodecAssociation *
 lookup_codec_association_by_pt_list (GList *codec_associations, gint pt,
     gboolean want_empty);
 
-static CodecAssociation *
-codec_association_copy (CodecAssociation *ca);
-
 static CodecAssociation *
 lookup_codec_association_custom_internal (GList *codec_associations,
     gboolean want_disabled, CAFindFunc func, gpointer user_data);
@@ -374,14 +371,27 @@ validate_codecs_configuration (FsMediaType media_type, GList *blueprints,
 }
 
 
-static void
-_codec_association_destroy (CodecAssociation *ca)
+/**
+ * codec_association_destroy:
+ * @ca: a #CodecAssociation
+ *
+ * Frees a #CodecAssociation, including its codecs and profiles
+ */
+
+void
+codec_association_destroy (CodecAssociation *ca)
 {
   if (!ca)
     return;
 
-  fs_codec_destroy (ca->codec);
-  fs_codec_destroy (ca->send_codec);
+  if (ca->interned_codec)
+    fs_rtp_interned_codec_unref (ca->interned_codec);
+  else
+    fs_codec_destroy (ca->codec);
+  if (ca->interned_send_codec)
+    fs_rtp_interned_codec_unref (ca->interned_send_codec);
+  else
+    fs_codec_destroy (ca->send_codec);
   g_free (ca->send_profile);
   g_free (ca->recv_profile);
   g_slice_free (CodecAssociation, ca);
@@ -1179,25 +1189,31 @@ finish_codec_negotiation (
 {
   int i;
   GList *item;
+  CodecAssociation *new_by_pt[CODEC_ASSOCIATION_PT_TABLE_SIZE];
+  CodecAssociation *old_by_pt[CODEC_ASSOCIATION_PT_TABLE_SIZE];
+
+  codec_association_list_fill_pt_table (new_codec_associations, TRUE,
+      new_by_pt);
+  codec_association_list_fill_pt_table (old_codec_associations, FALSE,
+      old_by_pt);
 
   /* Now, lets fill all of the PTs that were previously used in the session
    * even if they are not currently used, so they can't be re-used
    */
 
-  for (i=0; i < 128; i++)
+  for (i=0; i < CODEC_ASSOCIATION_PT_TABLE_SIZE; i++)
   {
     CodecAssociation *local_ca = NULL;
 
     /* We can skip ids where something already exists */
-    if (lookup_codec_association_by_pt_list (new_codec_associations, i, TRUE))
+    if (new_by_pt[i])
       continue;
 
     /* We check if our local table (our offer) and if we offered
      * something, we add it. Some broken implementation (like Tandberg's)
      * send packets on PTs that they did not put in their response
      */
-    local_ca = lookup_codec_association_by_pt_list (old_codec_associations,
-        i, FALSE);
+    local_ca = old_by_pt[i];
     if (local_ca) {
       CodecAssociation *new_ca = codec_association_copy (local_ca);
       new_ca->recv_only = TRUE;
@@ -1219,7 +1235,10 @@ finish_codec_negotiation (
     old_ca = lookup_codec_association_custom_internal (old_codec_associations,
         TRUE, match_send_codec_no_pt, new_ca);
     if (old_ca)
+    {
+      codec_association_make_writable (new_ca);
       keep_config_from_old_codec (new_ca->codec, old_ca->codec);
+    }
 
     new_ca->need_config = codec_needs_config (new_ca->codec);
   }
@@ -1248,6 +1267,45 @@ lookup_codec_association_by_pt_list (GList *codec_associations, gint pt,
 }
 
 
+/**
+ * codec_association_list_fill_pt_table:
+ * @codec_associations: a #GList of #CodecAssociation
+ * @want_disabled: whether disabled and reserved entries should be indexed
+ * @pt_table: an array of %CODEC_ASSOCIATION_PT_TABLE_SIZE entries to fill
+ *
+ * Indexes the list by payload type, so that repeated lookups do not have to
+ * walk the list. Each entry points to the first #CodecAssociation with that
+ * payload type, exactly like lookup_codec_association_by_pt_list() would
+ * return, or %NULL. The entries are not referenced, they are only valid as
+ * long as the list is.
+ */
+
+void
+codec_association_list_fill_pt_table (GList *codec_associations,
+    gboolean want_disabled, CodecAssociation **pt_table)
+{
+  GList *item;
+
+  memset (pt_table, 0,
+      sizeof (CodecAssociation *) * CODEC_ASSOCIATION_PT_TABLE_SIZE);
+
+  for (item = codec_associations; item; item = g_list_next (item))
+  {
+    CodecAssociation *ca = item->data;
+
+    if (!ca)
+      continue;
+    if (ca->codec->id < 0 || ca->codec->id >= CODEC_ASSOCIATION_PT_TABLE_SIZE)
+      continue;
+    if (!want_disabled && (ca->disable || ca->reserved))
+      continue;
+
+    if (!pt_table[ca->codec->id])
+      pt_table[ca->codec->id] = ca;
+  }
+}
+
+
 /**
  * lookup_codec_association_by_codec:
  * @codec_associations: a #GList of CodecAssociation
@@ -1301,27 +1359,103 @@ lookup_codec_association_by_codec (GList *codec_associations, FsCodec *codec)
 void
 codec_association_list_destroy (GList *list)
 {
-  g_list_foreach (list, (GFunc) _codec_association_destroy, NULL);
+  g_list_foreach (list, (GFunc) codec_association_destroy, NULL);
   g_list_free (list);
 }
 
+/**
+ * codec_association_copy:
+ * @ca: a #CodecAssociation
+ *
+ * Makes a deep copy of a #CodecAssociation, the blueprint and the interned
+ * codecs are shared
+ *
+ * Returns: a new #CodecAssociation, free with codec_association_destroy()
+ */
 
-static CodecAssociation *
-codec_association_copy (CodecAssociation *ca)
+CodecAssociation *
+codec_association_copy (const CodecAssociation *ca)
 {
   CodecAssociation *newca = g_slice_new (CodecAssociation);
 
   g_return_val_if_fail (ca, NULL);
 
   memcpy (newca, ca, sizeof(CodecAssociation));
-  newca->codec = fs_codec_copy (ca->codec);
-  newca->send_codec = fs_codec_copy (ca->send_codec);
+  if (ca->interned_codec)
+    fs_rtp_interned_codec_ref (ca->interned_codec);
+  else
+    newca->codec = fs_codec_copy (ca->codec);
+  if (ca->interned_send_codec)
+    fs_rtp_interned_codec_ref (ca->interned_send_codec);
+  else
+    newca->send_codec = fs_codec_copy (ca->send_codec);
   newca->send_profile = g_strdup (ca->send_profile);
   newca->recv_profile = g_strdup (ca->recv_profile);
 
   return newca;
 }
 
+static FsRtpInternedCodec *
+intern_codec (FsCodec **codec)
+{
+  FsRtpInternedCodec *interned = fs_rtp_interned_codec_get (*codec);
+
+  fs_codec_destroy (*codec);
+  *codec = interned->codec;
+
+  return interned;
+}
+
+/**
+ * codec_association_intern:
+ * @ca: a #CodecAssociation
+ *
+ * Replaces the codecs of @ca by their shared copy, after this, they must
+ * not be modified and two interned associations have equal codecs if and
+ * only if they point to the same #FsRtpInternedCodec.
+ */
+
+void
+codec_association_intern (CodecAssociation *ca)
+{
+  if (ca->codec && !ca->interned_codec)
+    ca->interned_codec = intern_codec (&ca->codec);
+  if (ca->send_codec && !ca->interned_send_codec)
+    ca->interned_send_codec = intern_codec (&ca->send_codec);
+}
+
+void
+codec_association_list_intern (GList *list)
+{
+  for (; list; list = g_list_next (list))
+    codec_association_intern (list->data);
+}
+
+/**
+ * codec_association_make_writable:
+ * @ca: a #CodecAssociation
+ *
+ * Gives @ca its own copy of its codecs so they can be modified, call
+ * codec_association_intern() again once it is done.
+ */
+
+void
+codec_association_make_writable (CodecAssociation *ca)
+{
+  if (ca->interned_codec)
+  {
+    ca->codec = fs_codec_copy (ca->interned_codec->codec);
+    fs_rtp_interned_codec_unref (ca->interned_codec);
+    ca->interned_codec = NULL;
+  }
+  if (ca->interned_send_codec)
+  {
+    ca->send_codec = fs_codec_copy (ca->interned_send_codec->codec);
+    fs_rtp_interned_codec_unref (ca->interned_send_codec);
+    ca->interned_send_codec = NULL;
+  }
+}
+
 GList *
 codec_associations_to_codecs_internal (GList *codec_associations,
     gboolean include_config, gboolean send_codecs)
@@ -1485,8 +1619,16 @@ codec_associations_list_are_equal (GList *list1, GList *list2)
     if (ca1->recv_only != ca2->recv_only)
       return FALSE;
 
-    if (!fs_codec_are_equal (ca1->codec, ca2->codec))
+    /* Interned codecs are unique, no need to look inside */
+    if (ca1->interned_codec && ca2->interned_codec)
+    {
+      if (ca1->interned_codec != ca2->interned_codec)
+        return FALSE;
+    }
+    else if (!fs_codec_are_equal (ca1->codec, ca2->codec))
+    {
       return FALSE;
+    }
   }
 
   if (list1 == NULL && list2 == NULL)
@@ -26,6 +26,7 @@
 #define __FS_RTP_CODEC_NEGOTIATION_H__
 
 #include "fs-rtp-discover-codecs.h"
+#include "fs-rtp-interned-codec.h"
 
 G_BEGIN_DECLS
 
@@ -41,6 +42,14 @@ G_BEGIN_DECLS
  * @need_config: means that the config has to be retreived from the codec data
  * @recv_only: means thats its not a real negotiated codec, just a codec that
  * we have offered from which we have to be ready to receive stuff, just in case
+ * @interned_codec: The shared copy @codec points to, or NULL if @codec is
+ *  owned by this association
+ * @interned_send_codec: The shared copy @send_codec points to, or NULL
+ *
+ * Once negotiation is over, the codecs are interned with
+ * codec_association_intern(). They are then shared read-only between every
+ * copy of the association, call codec_association_make_writable() before
+ * modifying them.
  *
  * The codec association structure represents the link between a #FsCodec and
  * a CodecBlueprint that implements it.
@@ -65,6 +74,8 @@ typedef struct _CodecAssociation {
   gboolean need_config;
   gboolean recv_only;
 
+  FsRtpInternedCodec *interned_codec;
+  FsRtpInternedCodec *interned_send_codec;
 } CodecAssociation;
 
 typedef struct _CodecPreference {
@@ -101,6 +112,13 @@ finish_codec_negotiation (
 CodecAssociation *
 lookup_codec_association_by_pt (GList *codec_associations, gint pt);
 
+/* RTP payload types are 7 bits */
+#define CODEC_ASSOCIATION_PT_TABLE_SIZE 128
+
+void
+codec_association_list_fill_pt_table (GList *codec_associations,
+    gboolean want_disabled, CodecAssociation **pt_table);
+
 CodecAssociation *
 lookup_codec_association_by_codec (GList *codec_associations, FsCodec *codec);
 
@@ -125,6 +143,21 @@ codec_associations_list_are_equal (GList *list1, GList *list2);
 void
 codec_association_list_destroy (GList *list);
 
+CodecAssociation *
+codec_association_copy (const CodecAssociation *ca);
+
+void
+codec_association_destroy (CodecAssociation *ca);
+
+void
+codec_association_intern (CodecAssociation *ca);
+
+void
+codec_association_list_intern (GList *list);
+
+void
+codec_association_make_writable (CodecAssociation *ca);
+
 typedef gboolean (*CAFindFunc) (CodecAssociation *ca, gpointer user_data);
 
 CodecAssociation *
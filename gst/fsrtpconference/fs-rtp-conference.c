@@ -66,8 +66,19 @@ enum
 {
   PROP_0,
   PROP_SDES,
+  PROP_PENDING_TEARDOWNS
 };
 
+/* Past that many queued teardowns, building new elements waits a bit */
+#define MAX_PENDING_TEARDOWNS 16
+#define TEARDOWN_WAIT_TIMEOUT (G_TIME_SPAN_SECOND)
+
+/* Threads shared by all the sessions to tear down elements, they are only
+ * started when needed. A couple are enough to keep one teardown stuck in a
+ * state change from holding back all the other ones, if they all get stuck
+ * the backpressure gives up after its timeout. */
+#define MAX_TEARDOWN_THREADS 2
+
 
 static GstStaticPadTemplate fs_rtp_conference_sink_template =
   GST_STATIC_PAD_TEMPLATE ("sink_%u",
@@ -98,8 +109,22 @@ struct _FsRtpConferencePrivate
 
   /* Array of all internal threads, as GThreads */
   GPtrArray *threads;
+
+  /* Protected by GST_OBJECT_LOCK */
+  GThreadPool *teardown_pool;
+  guint pending_teardowns;
+  guint completed_teardowns;
+  /* completed_teardowns when the last wait timed out */
+  guint stalled_at;
+  gboolean stalled;
+  GCond teardown_cond;
 };
 
+typedef struct {
+  FsRtpConferenceTeardownFunc func;
+  gpointer data;
+} TeardownJob;
+
 G_DEFINE_TYPE (FsRtpConference, fs_rtp_conference, FS_TYPE_CONFERENCE);
 
 static void fs_rtp_conference_get_property (GObject *object,
@@ -202,6 +227,12 @@ fs_rtp_conference_finalize (GObject * object)
 
   g_ptr_array_free (self->priv->threads, TRUE);
 
+  /* Every job holds a ref, so the pool is idle, but this may be running from
+   * inside one of its threads, so it must not wait */
+  if (self->priv->teardown_pool)
+    g_thread_pool_free (self->priv->teardown_pool, FALSE, FALSE);
+  g_cond_clear (&self->priv->teardown_cond);
+
   G_OBJECT_CLASS (fs_rtp_conference_parent_class)->finalize (object);
 }
 
@@ -255,6 +286,13 @@ fs_rtp_conference_class_init (FsRtpConferenceClass * klass)
       g_param_spec_boxed ("sdes", "SDES Items for this conference",
           "SDES items to use for sessions in this conference",
           GST_TYPE_STRUCTURE, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_PENDING_TEARDOWNS,
+      g_param_spec_uint ("pending-teardowns",
+          "Number of pending teardowns",
+          "The number of internal elements waiting to be torn down",
+          0, G_MAXUINT, 0,
+          G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
 }
 
 static void
@@ -268,6 +306,7 @@ fs_rtp_conference_init (FsRtpConference *conf)
   conf->priv->max_session_id = 1;
 
   conf->priv->threads = g_ptr_array_new ();
+  g_cond_init (&conf->priv->teardown_cond);
 
   conf->rtpbin = gst_element_factory_make ("rtpbin", NULL);
 
@@ -318,6 +357,11 @@ fs_rtp_conference_get_property (GObject *object,
     case PROP_SDES:
       g_object_get_property (G_OBJECT (self->rtpbin), "sdes", value);
       break;
+    case PROP_PENDING_TEARDOWNS:
+      GST_OBJECT_LOCK (self);
+      g_value_set_uint (value, self->priv->pending_teardowns);
+      GST_OBJECT_UNLOCK (self);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -864,3 +908,101 @@ fs_rtp_conference_is_internal_thread (FsRtpConference *self)
 
   return ret;
 }
+
+static void
+_run_teardown (gpointer data, gpointer user_data)
+{
+  FsRtpConference *self = FS_RTP_CONFERENCE (user_data);
+  TeardownJob *job = data;
+
+  job->func (job->data);
+  g_slice_free (TeardownJob, job);
+
+  GST_OBJECT_LOCK (self);
+  self->priv->pending_teardowns--;
+  self->priv->completed_teardowns++;
+  g_cond_broadcast (&self->priv->teardown_cond);
+  GST_OBJECT_UNLOCK (self);
+
+  g_object_notify (G_OBJECT (self), "pending-teardowns");
+
+  gst_object_unref (self);
+}
+
+/**
+ * fs_rtp_conference_push_teardown:
+ * @self: a #FsRtpConference
+ * @func: the function that does the teardown
+ * @data: the data to pass to @func
+ *
+ * Runs @func from one of the threads shared by the whole conference. This
+ * never blocks, so it can be called with locks held, but @func must not
+ * depend on anything the caller may wait on.
+ */
+
+void
+fs_rtp_conference_push_teardown (FsRtpConference *self,
+    FsRtpConferenceTeardownFunc func, gpointer data)
+{
+  TeardownJob *job = g_slice_new (TeardownJob);
+
+  job->func = func;
+  job->data = data;
+
+  GST_OBJECT_LOCK (self);
+  if (!self->priv->teardown_pool)
+    self->priv->teardown_pool = g_thread_pool_new (_run_teardown, self,
+        MAX_TEARDOWN_THREADS, FALSE, NULL);
+  self->priv->pending_teardowns++;
+  gst_object_ref (self);
+  g_thread_pool_push (self->priv->teardown_pool, job, NULL);
+  GST_OBJECT_UNLOCK (self);
+
+  g_object_notify (G_OBJECT (self), "pending-teardowns");
+}
+
+/**
+ * fs_rtp_conference_wait_teardowns:
+ * @self: a #FsRtpConference
+ *
+ * Applies backpressure to the code building new elements: if too many
+ * teardowns are queued, waits for some of them to be done. This must be
+ * called without holding any lock a teardown may take. It gives up after
+ * a while so that a stuck teardown can not block the conference, and does
+ * not wait at all anymore until one of the teardowns completes.
+ */
+
+void
+fs_rtp_conference_wait_teardowns (FsRtpConference *self)
+{
+  gint64 end_time = g_get_monotonic_time () + TEARDOWN_WAIT_TIMEOUT;
+
+  GST_OBJECT_LOCK (self);
+  if (self->priv->stalled &&
+      self->priv->stalled_at == self->priv->completed_teardowns)
+  {
+    if (self->priv->pending_teardowns >= MAX_PENDING_TEARDOWNS)
+      GST_LOG_OBJECT (self, "No teardown completed since the last wait timed"
+          " out, not waiting for the %u pending ones",
+          self->priv->pending_teardowns);
+    GST_OBJECT_UNLOCK (self);
+    return;
+  }
+  self->priv->stalled = FALSE;
+
+  while (self->priv->pending_teardowns >= MAX_PENDING_TEARDOWNS)
+  {
+    GST_DEBUG_OBJECT (self, "Waiting for %u pending teardowns",
+        self->priv->pending_teardowns);
+    if (!g_cond_wait_until (&self->priv->teardown_cond,
+            GST_OBJECT_GET_LOCK (self), end_time))
+    {
+      GST_WARNING_OBJECT (self, "Still %u pending teardowns, not waiting"
+          " anymore", self->priv->pending_teardowns);
+      self->priv->stalled = TRUE;
+      self->priv->stalled_at = self->priv->completed_teardowns;
+      break;
+    }
+  }
+  GST_OBJECT_UNLOCK (self);
+}
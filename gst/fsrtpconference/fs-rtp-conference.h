@@ -79,6 +79,13 @@ GstCaps *fs_codec_to_gst_caps_with_ptime (const FsCodec *codec);
 
 gboolean fs_rtp_conference_is_internal_thread (FsRtpConference *self);
 
+typedef void (*FsRtpConferenceTeardownFunc) (gpointer data);
+
+void fs_rtp_conference_push_teardown (FsRtpConference *self,
+    FsRtpConferenceTeardownFunc func, gpointer data);
+
+void fs_rtp_conference_wait_teardowns (FsRtpConference *self);
+
 G_END_DECLS
 
 #endif /* __FS_RTP_CONFERENCE_H__ */
@@ -35,6 +35,7 @@
 #include "fs-rtp-discover-codecs.h"
 #include "fs-rtp-codec-negotiation.h"
 #include "fs-rtp-codec-specific.h"
+#include "fs-rtp-dtmf-tone-src.h"
 
 #define GST_CAT_DEFAULT fsrtpconference_debug
 
@@ -174,29 +175,27 @@ fs_rtp_dtmf_sound_source_get_codec (FsRtpSpecialSourceClass *klass,
     FsCodec *selected_codec)
 {
   FsCodec *codec = NULL;
-  gchar *encoder_name = NULL;
   gchar *payloader_name = NULL;
   CodecAssociation *ca;
 
   if (selected_codec->media_type != FS_MEDIA_TYPE_AUDIO)
     return NULL;
 
-  if (!_check_element_factory ("dtmfsrc"))
-    return NULL;
-
+  /* PCMA/PCMU tones come from the shared tables, no encoder needed */
   if (selected_codec->clock_rate == 8000)
   {
     codec = get_pcm_law_sound_codec (negotiated_codec_associations,
-        &encoder_name, &payloader_name, NULL);
+        NULL, &payloader_name, NULL);
     if (codec) {
-      if (!_check_element_factory (encoder_name))
-        return NULL;
       if (!_check_element_factory (payloader_name))
         return NULL;
       return codec;
     }
   }
 
+  if (!_check_element_factory ("dtmfsrc"))
+    return NULL;
+
   ca = _get_main_codec_association (negotiated_codec_associations,
       selected_codec);
 
@@ -218,16 +217,14 @@ fs_rtp_dtmf_sound_source_build (FsRtpSpecialSource *source,
   GstElement *capsfilter = NULL;
   GstPad *ghostpad = NULL;
   GstElement *bin = NULL;
-  GstElement *encoder = NULL;
   GstElement *payloader = NULL;
-  gchar *encoder_name = NULL;
   gchar *payloader_name = NULL;
   CodecAssociation *ca = NULL;
 
 
   if (selected_codec->clock_rate == 8000)
     telephony_codec = get_pcm_law_sound_codec (negotiated_codec_associations,
-        &encoder_name, &payloader_name, &ca);
+        NULL, &payloader_name, NULL);
 
   if (!telephony_codec)
   {
@@ -246,15 +243,20 @@ fs_rtp_dtmf_sound_source_build (FsRtpSpecialSource *source,
 
   bin = gst_bin_new (NULL);
 
-  dtmfsrc = gst_element_factory_make ("dtmfsrc", NULL);
+  /* PCMA/PCMU tones are spliced from the shared pre-encoded tables, any
+   * other codec has to synthesize and encode them */
+  if (ca)
+    dtmfsrc = gst_element_factory_make ("dtmfsrc", NULL);
+  else
+    dtmfsrc = fs_rtp_dtmf_tone_src_new ();
   if (!dtmfsrc)
   {
-    GST_ERROR ("Could not make rtpdtmfsrc");
+    GST_ERROR ("Could not make dtmfsrc");
     goto error;
   }
   if (!gst_bin_add (GST_BIN (bin), dtmfsrc))
   {
-    GST_ERROR ("Could not add rtpdtmfsrc to bin");
+    GST_ERROR ("Could not add dtmfsrc to bin");
     gst_object_unref (dtmfsrc);
     goto error;
   }
@@ -347,25 +349,6 @@ fs_rtp_dtmf_sound_source_build (FsRtpSpecialSource *source,
   }
   else
   {
-    encoder = gst_element_factory_make (encoder_name, NULL);
-    if (!encoder)
-    {
-      GST_ERROR ("Could not make %s", encoder_name);
-      goto error;
-    }
-    if (!gst_bin_add (GST_BIN (bin), encoder))
-    {
-      GST_ERROR ("Could not add %s to bin", encoder_name);
-      gst_object_unref (encoder);
-      goto error;
-    }
-
-    if (!gst_element_link_pads (dtmfsrc, "src", encoder, "sink"))
-    {
-      GST_ERROR ("Could not link the rtpdtmfsrc and %s", encoder_name);
-      goto error;
-    }
-
     payloader = gst_element_factory_make (payloader_name, NULL);
     if (!payloader)
     {
@@ -379,9 +362,11 @@ fs_rtp_dtmf_sound_source_build (FsRtpSpecialSource *source,
       goto error;
     }
 
-    if (!gst_element_link_pads (encoder, "src", payloader, "sink"))
+    g_object_set (payloader, "pt", telephony_codec->id, NULL);
+
+    if (!gst_element_link_pads (dtmfsrc, "src", payloader, "sink"))
     {
-      GST_ERROR ("Could not link the %s and %s", encoder_name, payloader_name);
+      GST_ERROR ("Could not link the tone source and %s", payloader_name);
       goto error;
     }
 
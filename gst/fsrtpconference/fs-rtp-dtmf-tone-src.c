@@ -0,0 +1,564 @@
+/*
+ * Farstream Voice+Video library
+ *
+ * fs-rtp-dtmf-tone-src.c - Source of pre-encoded in-band DTMF tones
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+/*
+ * This element replaces dtmfsrc ! mulawenc/alawenc for in-band DTMF on
+ * G.711. It understands the same "dtmf-event" upstream events and posts the
+ * same "dtmf-event-processed" messages, but instead of synthesizing and
+ * encoding every tone sample by sample, it hands out slices of encoded
+ * tables that are computed once per process and shared by every session.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "fs-rtp-dtmf-tone-src.h"
+
+#include <math.h>
+#include <string.h>
+
+GST_DEBUG_CATEGORY_STATIC (fs_rtp_dtmf_tone_src_debug);
+#define GST_CAT_DEFAULT fs_rtp_dtmf_tone_src_debug
+
+#define SAMPLE_RATE 8000
+#define FRAME_SAMPLES 160
+#define FRAME_DURATION (20 * GST_MSECOND)
+
+/* Every DTMF frequency is a whole number of Hz, so a one second table
+ * loops without a phase jump */
+#define TABLE_SAMPLES SAMPLE_RATE
+#define TABLE_FRAMES (TABLE_SAMPLES / FRAME_SAMPLES)
+
+/* The minimums of dtmfsrc in whole frames: its 250ms of tone round up to
+ * 260ms, then 100ms of silence */
+#define MIN_PULSE_FRAMES 13
+#define MIN_INTER_DIGIT_FRAMES 5
+
+#define MAX_EVENT 15
+#define MAX_VOLUME 36
+#define SILENCE_EVENT (MAX_EVENT + 1)
+
+enum {
+  G711_ULAW,
+  G711_ALAW,
+  G711_LAST
+};
+
+static const struct {
+  gint low;
+  gint high;
+} dtmf_frequencies[] = {
+  {941, 1336},
+  {697, 1209},
+  {697, 1336},
+  {697, 1477},
+  {770, 1209},
+  {770, 1336},
+  {770, 1477},
+  {852, 1209},
+  {852, 1336},
+  {852, 1477},
+  {941, 1209},
+  {941, 1477},
+  {697, 1633},
+  {770, 1633},
+  {852, 1633},
+  {941, 1633}
+};
+
+typedef struct {
+  gboolean start;
+  gint number;
+  gint volume;
+} ToneRequest;
+
+/* Filled lazily, never freed: buffers wrap the tables directly */
+G_LOCK_DEFINE_STATIC (tone_tables);
+static guint8 *tone_tables[G711_LAST][SILENCE_EVENT + 1][MAX_VOLUME + 1];
+
+static GstStaticPadTemplate fs_rtp_dtmf_tone_src_src_template =
+    GST_STATIC_PAD_TEMPLATE ("src",
+        GST_PAD_SRC,
+        GST_PAD_ALWAYS,
+        GST_STATIC_CAPS ("audio/x-mulaw, rate = (int) 8000, channels = (int) 1;"
+            "audio/x-alaw, rate = (int) 8000, channels = (int) 1"));
+
+G_DEFINE_TYPE (FsRtpDtmfToneSrc, fs_rtp_dtmf_tone_src, GST_TYPE_BASE_SRC);
+
+static void fs_rtp_dtmf_tone_src_finalize (GObject *object);
+
+static gboolean fs_rtp_dtmf_tone_src_set_caps (GstBaseSrc *src,
+    GstCaps *caps);
+static gboolean fs_rtp_dtmf_tone_src_start (GstBaseSrc *src);
+static gboolean fs_rtp_dtmf_tone_src_stop (GstBaseSrc *src);
+static gboolean fs_rtp_dtmf_tone_src_unlock (GstBaseSrc *src);
+static gboolean fs_rtp_dtmf_tone_src_unlock_stop (GstBaseSrc *src);
+static gboolean fs_rtp_dtmf_tone_src_event (GstBaseSrc *src, GstEvent *event);
+static void fs_rtp_dtmf_tone_src_get_times (GstBaseSrc *src,
+    GstBuffer *buffer, GstClockTime *start, GstClockTime *end);
+static GstFlowReturn fs_rtp_dtmf_tone_src_create (GstBaseSrc *src,
+    guint64 offset, guint length, GstBuffer **buffer);
+
+static void
+fs_rtp_dtmf_tone_src_class_init (FsRtpDtmfToneSrcClass *klass)
+{
+  GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
+  GstElementClass *gstelement_class = GST_ELEMENT_CLASS (klass);
+  GstBaseSrcClass *gstbasesrc_class = GST_BASE_SRC_CLASS (klass);
+
+  gobject_class->finalize = fs_rtp_dtmf_tone_src_finalize;
+
+  gstbasesrc_class->set_caps = fs_rtp_dtmf_tone_src_set_caps;
+  gstbasesrc_class->start = fs_rtp_dtmf_tone_src_start;
+  gstbasesrc_class->stop = fs_rtp_dtmf_tone_src_stop;
+  gstbasesrc_class->unlock = fs_rtp_dtmf_tone_src_unlock;
+  gstbasesrc_class->unlock_stop = fs_rtp_dtmf_tone_src_unlock_stop;
+  gstbasesrc_class->event = fs_rtp_dtmf_tone_src_event;
+  gstbasesrc_class->get_times = fs_rtp_dtmf_tone_src_get_times;
+  gstbasesrc_class->create = fs_rtp_dtmf_tone_src_create;
+
+  GST_DEBUG_CATEGORY_INIT
+      (fs_rtp_dtmf_tone_src_debug, "fsrtpdtmftonesrc", 0,
+          "fsrtpdtmftonesrc element");
+
+  gst_element_class_set_details_simple (gstelement_class,
+      "Farstream RTP DTMF tone source",
+      "Source/Audio",
+      "Produces G.711 encoded DTMF tones from shared precomputed tables",
+      "Farstream developers"
+      " <http://www.freedesktop.org/wiki/Software/Farstream>");
+
+  gst_element_class_add_pad_template (gstelement_class,
+      gst_static_pad_template_get (&fs_rtp_dtmf_tone_src_src_template));
+}
+
+static void
+fs_rtp_dtmf_tone_src_init (FsRtpDtmfToneSrc *self)
+{
+  g_cond_init (&self->cond);
+  g_queue_init (&self->events);
+  self->law = G711_ULAW;
+  self->timestamp = GST_CLOCK_TIME_NONE;
+
+  gst_base_src_set_format (GST_BASE_SRC (self), GST_FORMAT_TIME);
+  gst_base_src_set_live (GST_BASE_SRC (self), TRUE);
+}
+
+static void
+tone_request_free (gpointer data)
+{
+  g_slice_free (ToneRequest, data);
+}
+
+static void
+fs_rtp_dtmf_tone_src_finalize (GObject *object)
+{
+  FsRtpDtmfToneSrc *self = FS_RTP_DTMF_TONE_SRC (object);
+
+  g_queue_foreach (&self->events, (GFunc) tone_request_free, NULL);
+  g_queue_clear (&self->events);
+  g_cond_clear (&self->cond);
+
+  G_OBJECT_CLASS (fs_rtp_dtmf_tone_src_parent_class)->finalize (object);
+}
+
+GstElement *
+fs_rtp_dtmf_tone_src_new (void)
+{
+  return g_object_new (FS_TYPE_RTP_DTMF_TONE_SRC, NULL);
+}
+
+static guint8
+linear_to_ulaw (gint sample)
+{
+  gint sign = 0;
+  gint exponent;
+  gint mantissa;
+  gint mask;
+
+  if (sample < 0)
+  {
+    sign = 0x80;
+    sample = -sample;
+  }
+  if (sample > 32635)
+    sample = 32635;
+  sample += 0x84;
+
+  exponent = 7;
+  for (mask = 0x4000; !(sample & mask) && exponent > 0; mask >>= 1)
+    exponent--;
+  mantissa = (sample >> (exponent + 3)) & 0x0F;
+
+  return ~(sign | (exponent << 4) | mantissa);
+}
+
+static guint8
+linear_to_alaw (gint sample)
+{
+  gint xor_mask = 0xD5;
+  gint exponent;
+  gint mantissa;
+  gint mask;
+
+  if (sample < 0)
+  {
+    xor_mask = 0x55;
+    sample = -sample - 1;
+  }
+  if (sample > 32767)
+    sample = 32767;
+
+  if (sample >= 256)
+  {
+    exponent = 7;
+    for (mask = 0x4000; !(sample & mask); mask >>= 1)
+      exponent--;
+    mantissa = (sample >> (exponent + 3)) & 0x0F;
+  }
+  else
+  {
+    exponent = 0;
+    mantissa = sample >> 4;
+  }
+
+  return ((exponent << 4) | mantissa) ^ xor_mask;
+}
+
+/* Same waveform as dtmfsrc: the average of both sines, attenuated by
+ * volume dBm0 */
+static guint8 *
+tone_table_new (gint law, gint number, gint volume)
+{
+  guint8 *table = g_malloc (TABLE_SAMPLES);
+  gdouble volume_factor = pow (10, (gdouble) -volume / 20);
+  guint i;
+
+  for (i = 0; i < TABLE_SAMPLES; i++)
+  {
+    gint sample = 0;
+
+    if (number != SILENCE_EVENT)
+    {
+      gdouble f1 = sin (2 * M_PI * i * dtmf_frequencies[number].low /
+          SAMPLE_RATE);
+      gdouble f2 = sin (2 * M_PI * i * dtmf_frequencies[number].high /
+          SAMPLE_RATE);
+
+      sample = (gint) (((f1 + f2) / 2) * volume_factor * 32767);
+    }
+
+    if (law == G711_ULAW)
+      table[i] = linear_to_ulaw (sample);
+    else
+      table[i] = linear_to_alaw (sample);
+  }
+
+  return table;
+}
+
+static const guint8 *
+get_tone_table (gint law, gint number, gint volume)
+{
+  guint8 *table;
+
+  G_LOCK (tone_tables);
+  table = tone_tables[law][number][volume];
+  if (!table)
+  {
+    GST_DEBUG ("Computing %s table for event %d at volume %d",
+        law == G711_ULAW ? "PCMU" : "PCMA", number, volume);
+    table = tone_table_new (law, number, volume);
+    tone_tables[law][number][volume] = table;
+  }
+  G_UNLOCK (tone_tables);
+
+  return table;
+}
+
+static gboolean
+fs_rtp_dtmf_tone_src_set_caps (GstBaseSrc *src, GstCaps *caps)
+{
+  FsRtpDtmfToneSrc *self = FS_RTP_DTMF_TONE_SRC (src);
+  GstStructure *s = gst_caps_get_structure (caps, 0);
+
+  GST_OBJECT_LOCK (self);
+  if (gst_structure_has_name (s, "audio/x-alaw"))
+    self->law = G711_ALAW;
+  else
+    self->law = G711_ULAW;
+  GST_OBJECT_UNLOCK (self);
+
+  return TRUE;
+}
+
+static void
+fs_rtp_dtmf_tone_src_reset_locked (FsRtpDtmfToneSrc *self)
+{
+  g_queue_foreach (&self->events, (GFunc) tone_request_free, NULL);
+  g_queue_clear (&self->events);
+  self->tone = NULL;
+  self->frame = 0;
+  self->frames_left = 0;
+  self->silence_left = 0;
+  self->stopping = FALSE;
+  self->timestamp = GST_CLOCK_TIME_NONE;
+}
+
+static gboolean
+fs_rtp_dtmf_tone_src_start (GstBaseSrc *src)
+{
+  FsRtpDtmfToneSrc *self = FS_RTP_DTMF_TONE_SRC (src);
+
+  GST_OBJECT_LOCK (self);
+  fs_rtp_dtmf_tone_src_reset_locked (self);
+  GST_OBJECT_UNLOCK (self);
+
+  return TRUE;
+}
+
+static gboolean
+fs_rtp_dtmf_tone_src_stop (GstBaseSrc *src)
+{
+  return fs_rtp_dtmf_tone_src_start (src);
+}
+
+static gboolean
+fs_rtp_dtmf_tone_src_unlock (GstBaseSrc *src)
+{
+  FsRtpDtmfToneSrc *self = FS_RTP_DTMF_TONE_SRC (src);
+
+  GST_OBJECT_LOCK (self);
+  self->flushing = TRUE;
+  g_cond_broadcast (&self->cond);
+  GST_OBJECT_UNLOCK (self);
+
+  return TRUE;
+}
+
+static gboolean
+fs_rtp_dtmf_tone_src_unlock_stop (GstBaseSrc *src)
+{
+  FsRtpDtmfToneSrc *self = FS_RTP_DTMF_TONE_SRC (src);
+
+  GST_OBJECT_LOCK (self);
+  self->flushing = FALSE;
+  GST_OBJECT_UNLOCK (self);
+
+  return TRUE;
+}
+
+static gboolean
+fs_rtp_dtmf_tone_src_event (GstBaseSrc *src, GstEvent *event)
+{
+  FsRtpDtmfToneSrc *self = FS_RTP_DTMF_TONE_SRC (src);
+  const GstStructure *s;
+  ToneRequest *request;
+  gint type;
+  gint method;
+
+  if (GST_EVENT_TYPE (event) != GST_EVENT_CUSTOM_UPSTREAM)
+    goto chain_up;
+
+  s = gst_event_get_structure (event);
+  if (!gst_structure_has_name (s, "dtmf-event"))
+    goto chain_up;
+
+  request = g_slice_new0 (ToneRequest);
+
+  if (!gst_structure_get_int (s, "type", &type) ||
+      !gst_structure_get_boolean (s, "start", &request->start) ||
+      (request->start && type != 1))
+    goto refuse;
+
+  if (gst_structure_get_int (s, "method", &method) && method != 2)
+    goto refuse;
+
+  if (request->start)
+  {
+    if (!gst_structure_get_int (s, "number", &request->number) ||
+        !gst_structure_get_int (s, "volume", &request->volume))
+      goto refuse;
+
+    if (request->number < 0 || request->number > MAX_EVENT ||
+        request->volume < 0 || request->volume > MAX_VOLUME)
+      goto refuse;
+  }
+
+  GST_DEBUG_OBJECT (self, "Queueing tone %s for %d",
+      request->start ? "start" : "stop", request->number);
+
+  GST_OBJECT_LOCK (self);
+  g_queue_push_head (&self->events, request);
+  g_cond_broadcast (&self->cond);
+  GST_OBJECT_UNLOCK (self);
+
+  return TRUE;
+
+ refuse:
+  tone_request_free (request);
+  return FALSE;
+
+ chain_up:
+  return GST_BASE_SRC_CLASS (fs_rtp_dtmf_tone_src_parent_class)->event (src,
+      event);
+}
+
+static void
+fs_rtp_dtmf_tone_src_get_times (GstBaseSrc *src, GstBuffer *buffer,
+    GstClockTime *start, GstClockTime *end)
+{
+  *start = GST_BUFFER_PTS (buffer);
+  *end = *start + GST_BUFFER_DURATION (buffer);
+}
+
+static GstClockTime
+fs_rtp_dtmf_tone_src_running_time_locked (FsRtpDtmfToneSrc *self)
+{
+  GstClock *clock = GST_ELEMENT_CLOCK (self);
+
+  if (!clock)
+    return 0;
+
+  return gst_clock_get_time (clock) - GST_ELEMENT_CAST (self)->base_time;
+}
+
+/* Returns the message to post once the lock is released */
+static GstMessage *
+fs_rtp_dtmf_tone_src_handle_request_locked (FsRtpDtmfToneSrc *self,
+    ToneRequest *request)
+{
+  GstStructure *s;
+
+  if (request->start)
+  {
+    GstClockTime now = fs_rtp_dtmf_tone_src_running_time_locked (self);
+
+    /* Keep the timestamps contiguous if we are still in the inter-digit
+     * silence of the previous tone */
+    if (!GST_CLOCK_TIME_IS_VALID (self->timestamp) || self->timestamp < now)
+      self->timestamp = now;
+
+    self->tone = get_tone_table (self->law, request->number, request->volume);
+    self->frame = 0;
+    self->frames_left = MIN_PULSE_FRAMES;
+    self->silence_left = 0;
+    self->stopping = FALSE;
+
+    s = gst_structure_new ("dtmf-event-processed",
+        "type", G_TYPE_INT, 1,
+        "method", G_TYPE_INT, 2,
+        "start", G_TYPE_BOOLEAN, TRUE,
+        "number", G_TYPE_INT, request->number,
+        "volume", G_TYPE_INT, request->volume,
+        NULL);
+  }
+  else
+  {
+    const gchar *name = "dtmf-event-processed";
+
+    if (self->tone)
+      self->stopping = TRUE;
+    else
+      name = "dtmf-event-dropped";
+
+    s = gst_structure_new (name,
+        "type", G_TYPE_INT, 1,
+        "method", G_TYPE_INT, 2,
+        "start", G_TYPE_BOOLEAN, FALSE,
+        NULL);
+  }
+
+  return gst_message_new_element (GST_OBJECT (self), s);
+}
+
+static GstFlowReturn
+fs_rtp_dtmf_tone_src_create (GstBaseSrc *src, guint64 offset, guint length,
+    GstBuffer **buffer)
+{
+  FsRtpDtmfToneSrc *self = FS_RTP_DTMF_TONE_SRC (src);
+  const guint8 *table;
+  GstBuffer *buf;
+
+  GST_OBJECT_LOCK (self);
+  for (;;)
+  {
+    ToneRequest *request;
+
+    if (self->flushing)
+    {
+      GST_OBJECT_UNLOCK (self);
+      return GST_FLOW_FLUSHING;
+    }
+
+    request = g_queue_pop_tail (&self->events);
+    if (request)
+    {
+      GstMessage *message =
+          fs_rtp_dtmf_tone_src_handle_request_locked (self, request);
+
+      tone_request_free (request);
+      GST_OBJECT_UNLOCK (self);
+      gst_element_post_message (GST_ELEMENT (self), message);
+      GST_OBJECT_LOCK (self);
+      continue;
+    }
+
+    if (self->tone || self->silence_left)
+      break;
+
+    g_cond_wait (&self->cond, GST_OBJECT_GET_LOCK (self));
+  }
+
+  if (self->tone)
+  {
+    table = self->tone;
+    if (self->frames_left)
+      self->frames_left--;
+    if (self->stopping && self->frames_left == 0)
+    {
+      self->tone = NULL;
+      self->stopping = FALSE;
+      self->silence_left = MIN_INTER_DIGIT_FRAMES;
+    }
+  }
+  else
+  {
+    table = get_tone_table (self->law, SILENCE_EVENT, 0);
+    self->silence_left--;
+  }
+
+  buf = gst_buffer_new ();
+  gst_buffer_append_memory (buf,
+      gst_memory_new_wrapped (GST_MEMORY_FLAG_READONLY, (gpointer) table,
+          TABLE_SAMPLES, self->frame * FRAME_SAMPLES, FRAME_SAMPLES,
+          NULL, NULL));
+  GST_BUFFER_PTS (buf) = self->timestamp;
+  GST_BUFFER_DURATION (buf) = FRAME_DURATION;
+
+  self->frame = (self->frame + 1) % TABLE_FRAMES;
+  self->timestamp += FRAME_DURATION;
+  GST_OBJECT_UNLOCK (self);
+
+  *buffer = buf;
+
+  return GST_FLOW_OK;
+}
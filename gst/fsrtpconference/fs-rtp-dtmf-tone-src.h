@@ -0,0 +1,81 @@
+/*
+ * Farstream Voice+Video library
+ *
+ * fs-rtp-dtmf-tone-src.h - Source of pre-encoded in-band DTMF tones
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#ifndef __FS_RTP_DTMF_TONE_SRC_H__
+#define __FS_RTP_DTMF_TONE_SRC_H__
+
+#include <gst/gst.h>
+#include <gst/base/gstbasesrc.h>
+
+G_BEGIN_DECLS
+
+/* #define's don't like whitespacey bits */
+#define FS_TYPE_RTP_DTMF_TONE_SRC \
+  (fs_rtp_dtmf_tone_src_get_type())
+#define FS_RTP_DTMF_TONE_SRC(obj) \
+  (G_TYPE_CHECK_INSTANCE_CAST((obj), \
+  FS_TYPE_RTP_DTMF_TONE_SRC,FsRtpDtmfToneSrc))
+#define FS_RTP_DTMF_TONE_SRC_CLASS(klass) \
+  (G_TYPE_CHECK_CLASS_CAST((klass), \
+  FS_TYPE_RTP_DTMF_TONE_SRC,FsRtpDtmfToneSrcClass))
+#define FS_IS_RTP_DTMF_TONE_SRC(obj) \
+  (G_TYPE_CHECK_INSTANCE_TYPE((obj),FS_TYPE_RTP_DTMF_TONE_SRC))
+#define FS_IS_RTP_DTMF_TONE_SRC_CLASS(obj) \
+  (G_TYPE_CHECK_CLASS_TYPE((klass),FS_TYPE_RTP_DTMF_TONE_SRC))
+
+typedef struct _FsRtpDtmfToneSrc FsRtpDtmfToneSrc;
+typedef struct _FsRtpDtmfToneSrcClass FsRtpDtmfToneSrcClass;
+
+/* Everything below is protected by the object lock */
+struct _FsRtpDtmfToneSrc
+{
+  GstBaseSrc parent;
+
+  GCond cond;
+  gboolean flushing;
+
+  /* One of the G711_* laws, set from the negotiated caps */
+  gint law;
+
+  /* The pending start/stop requests, oldest at the tail */
+  GQueue events;
+
+  /* The table for the tone currently playing, NULL when silent */
+  const guint8 *tone;
+  guint frame;
+  guint frames_left;
+  guint silence_left;
+  gboolean stopping;
+
+  GstClockTime timestamp;
+};
+
+struct _FsRtpDtmfToneSrcClass
+{
+  GstBaseSrcClass parent_class;
+};
+
+GType fs_rtp_dtmf_tone_src_get_type (void);
+
+GstElement *fs_rtp_dtmf_tone_src_new (void);
+
+G_END_DECLS
+
+#endif /* __FS_RTP_DTMF_TONE_SRC_H__ */
@@ -0,0 +1,195 @@
+/*
+ * Farstream Voice+Video library
+ *
+ * fs-rtp-interned-codec.c - Shared immutable copies of negotiated codecs
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "fs-rtp-interned-codec.h"
+
+#include <string.h>
+
+/*
+ * Every negotiated codec in the process lives in this table exactly once.
+ * An entry is removed when its last reference goes away, the 1 -> 0
+ * transition is always done with the lock held so that a concurrent lookup
+ * can never resurrect an entry that is being freed.
+ */
+
+G_LOCK_DEFINE_STATIC (interned_codecs);
+static GHashTable *interned_codecs = NULL;
+
+static guint
+hash_ascii_lower (const gchar *str)
+{
+  guint hash = 5381;
+
+  if (!str)
+    return 0;
+
+  for (; *str; str++)
+    hash = (hash << 5) + hash + g_ascii_tolower (*str);
+
+  return hash;
+}
+
+/**
+ * fs_rtp_codec_hash:
+ * @codec: a #FsCodec
+ *
+ * Computes a hash that is consistent with fs_codec_are_equal(), the
+ * parameters are combined with an OR so their order (and repetitions)
+ * does not matter, just like in the comparison.
+ *
+ * Returns: the hash value
+ */
+
+guint
+fs_rtp_codec_hash (const FsCodec *codec)
+{
+  guint hash;
+  guint params_hash = 0;
+  GList *item;
+
+  hash = hash_ascii_lower (codec->encoding_name);
+  hash = hash * 31 + codec->id;
+  hash = hash * 31 + codec->media_type;
+  hash = hash * 31 + codec->clock_rate;
+  hash = hash * 31 + codec->channels;
+  hash = hash * 31 + codec->minimum_reporting_interval;
+
+  for (item = codec->optional_params; item; item = item->next)
+  {
+    FsCodecParameter *param = item->data;
+
+    params_hash |= 1U << ((hash_ascii_lower (param->name) ^
+            g_str_hash (param->value)) % 32);
+  }
+
+  for (item = codec->feedback_params; item; item = item->next)
+  {
+    FsFeedbackParameter *param = item->data;
+
+    params_hash |= 1U << ((hash_ascii_lower (param->type) ^
+            hash_ascii_lower (param->subtype)) % 32);
+  }
+
+  return hash ^ params_hash;
+}
+
+static guint
+interned_codec_hash (gconstpointer key)
+{
+  const FsRtpInternedCodec *interned = key;
+
+  return interned->hash;
+}
+
+static gboolean
+interned_codec_equal (gconstpointer a, gconstpointer b)
+{
+  const FsRtpInternedCodec *interned1 = a;
+  const FsRtpInternedCodec *interned2 = b;
+
+  return interned1->hash == interned2->hash &&
+      fs_codec_are_equal (interned1->codec, interned2->codec);
+}
+
+/**
+ * fs_rtp_interned_codec_get:
+ * @codec: a #FsCodec
+ *
+ * Finds the shared copy of @codec, creating it if this is the first time
+ * this codec is seen. @codec itself is not kept.
+ *
+ * Returns: a reference to the #FsRtpInternedCodec,
+ *  release with fs_rtp_interned_codec_unref()
+ */
+
+FsRtpInternedCodec *
+fs_rtp_interned_codec_get (const FsCodec *codec)
+{
+  FsRtpInternedCodec key;
+  FsRtpInternedCodec *interned;
+
+  g_return_val_if_fail (codec, NULL);
+
+  key.codec = (FsCodec *) codec;
+  key.hash = fs_rtp_codec_hash (codec);
+
+  G_LOCK (interned_codecs);
+  if (!interned_codecs)
+    interned_codecs = g_hash_table_new (interned_codec_hash,
+        interned_codec_equal);
+
+  interned = g_hash_table_lookup (interned_codecs, &key);
+  if (interned)
+  {
+    g_atomic_int_inc (&interned->refcount);
+  }
+  else
+  {
+    interned = g_slice_new (FsRtpInternedCodec);
+    interned->codec = fs_codec_copy (codec);
+    interned->hash = key.hash;
+    interned->refcount = 1;
+    g_hash_table_add (interned_codecs, interned);
+  }
+  G_UNLOCK (interned_codecs);
+
+  return interned;
+}
+
+FsRtpInternedCodec *
+fs_rtp_interned_codec_ref (FsRtpInternedCodec *interned)
+{
+  g_atomic_int_inc (&interned->refcount);
+
+  return interned;
+}
+
+void
+fs_rtp_interned_codec_unref (FsRtpInternedCodec *interned)
+{
+  gint old;
+
+  /* Fast path, this is not the last reference */
+  do {
+    old = g_atomic_int_get (&interned->refcount);
+    if (old <= 1)
+      break;
+  } while (!g_atomic_int_compare_and_exchange (&interned->refcount, old,
+          old - 1));
+
+  if (old > 1)
+    return;
+
+  G_LOCK (interned_codecs);
+  if (!g_atomic_int_dec_and_test (&interned->refcount))
+  {
+    G_UNLOCK (interned_codecs);
+    return;
+  }
+  g_hash_table_remove (interned_codecs, interned);
+  G_UNLOCK (interned_codecs);
+
+  fs_codec_destroy (interned->codec);
+  g_slice_free (FsRtpInternedCodec, interned);
+}
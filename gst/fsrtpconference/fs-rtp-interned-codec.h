@@ -0,0 +1,56 @@
+/*
+ * Farstream Voice+Video library
+ *
+ * fs-rtp-interned-codec.h - Shared immutable copies of negotiated codecs
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#ifndef __FS_RTP_INTERNED_CODEC_H__
+#define __FS_RTP_INTERNED_CODEC_H__
+
+#include <farstream/fs-codec.h>
+
+G_BEGIN_DECLS
+
+/**
+ * FsRtpInternedCodec:
+ * @codec: The shared codec, it must never be modified
+ * @hash: The hash of @codec, computed once when it is interned
+ *
+ * There is only ever one #FsRtpInternedCodec for a given set of codec values
+ * in the process, so two interned codecs are equal if and only if they
+ * are the same pointer.
+ */
+
+typedef struct _FsRtpInternedCodec {
+  FsCodec *codec;
+  guint hash;
+
+  /*< private >*/
+  volatile gint refcount;
+} FsRtpInternedCodec;
+
+guint fs_rtp_codec_hash (const FsCodec *codec);
+
+FsRtpInternedCodec *fs_rtp_interned_codec_get (const FsCodec *codec);
+
+FsRtpInternedCodec *fs_rtp_interned_codec_ref (FsRtpInternedCodec *interned);
+
+void fs_rtp_interned_codec_unref (FsRtpInternedCodec *interned);
+
+G_END_DECLS
+
+#endif /* __FS_RTP_INTERNED_CODEC_H__ */
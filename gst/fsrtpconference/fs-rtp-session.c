@@ -133,6 +133,19 @@
 
 #define GST_CAT_DEFAULT fsrtpconference_debug
 
+/* Maximum number of stopped send codec bins kept for re-use */
+#define MAX_IDLE_SEND_CODECBINS 2
+
+/* What a codec bin was built from, attached to the bin */
+typedef struct {
+  CodecBlueprint *blueprint;
+  gchar *profile;
+  FsCodec *send_codec;
+} CodecBinKey;
+
+static GQuark codecbin_key_quark;
+static GQuark codecbin_bitrate_elements_quark;
+
 /* Signals */
 enum
 {
@@ -229,6 +242,10 @@ struct _FsRtpSessionPrivate
 
   /* Can only be modified by the streaming thread with the pad blocked */
   GstElement *send_codecbin;
+
+  /* Stopped send codec bins that can be re-used if we switch back to the same
+   * codec, most recent first. Protected by the session mutex */
+  GQueue idle_send_codecbins;
   GList *extra_send_capsfilters;
 
   /* These lists are protected by the session mutex */
@@ -243,8 +260,15 @@ struct _FsRtpSessionPrivate
   GList *codec_preferences;
   guint codec_preferences_generation;
 
+  /* Streams whose remote codecs are being set as part of a batch, the
+   * negotiation is done once the whole batch has been created.
+   * Protected by the session mutex */
+  GList *batch_streams;
+
   /* These are protected by the session mutex */
   GList *codec_associations;
+  /* Index of codec_associations by payload type, rebuilt on negotiation */
+  CodecAssociation *codec_associations_by_pt[CODEC_ASSOCIATION_PT_TABLE_SIZE];
 
   GList *hdrext_negotiated;
   GList *hdrext_preferences;
@@ -311,6 +335,11 @@ static FsStream *fs_rtp_session_new_stream (FsSession *session,
     FsParticipant *participant,
     FsStreamDirection direction,
     GError **error);
+static GList *fs_rtp_session_new_streams (FsSession *session,
+    GList *participants,
+    FsStreamDirection direction,
+    GList *remote_codecs,
+    GError **error);
 static gboolean fs_rtp_session_start_telephony_event (FsSession *session,
     guint8 event,
     guint8 volume);
@@ -414,7 +443,12 @@ fs_rtp_session_class_init (FsRtpSessionClass *klass)
   gobject_class->get_property = fs_rtp_session_get_property;
   gobject_class->constructed = fs_rtp_session_constructed;
 
+  codecbin_key_quark = g_quark_from_static_string ("fs-rtp-codecbin-key");
+  codecbin_bitrate_elements_quark =
+      g_quark_from_static_string ("fs-rtp-codecbin-bitrate-elements");
+
   session_class->new_stream = fs_rtp_session_new_stream;
+  session_class->new_streams = fs_rtp_session_new_streams;
   session_class->start_telephony_event = fs_rtp_session_start_telephony_event;
   session_class->stop_telephony_event = fs_rtp_session_stop_telephony_event;
   session_class->set_send_codec = fs_rtp_session_set_send_codec;
@@ -731,6 +765,10 @@ fs_rtp_session_dispose (GObject *obj)
   }
 
   stop_and_remove (conferencebin, &self->priv->send_codecbin, FALSE);
+  FS_RTP_SESSION_LOCK (self);
+  while (!g_queue_is_empty (&self->priv->idle_send_codecbins))
+    gst_object_unref (g_queue_pop_head (&self->priv->idle_send_codecbins));
+  FS_RTP_SESSION_UNLOCK (self);
   stop_and_remove (conferencebin, &self->priv->media_sink_valve, TRUE);
   stop_and_remove (conferencebin, &self->priv->send_tee, TRUE);
   stop_and_remove (conferencebin, &self->priv->send_bitrate_adapter, FALSE);
@@ -2089,6 +2127,101 @@ fs_rtp_session_new_stream (FsSession *session,
   return new_stream;
 }
 
+/**
+ * fs_rtp_session_new_streams:
+ * @session: an #FsRtpSession
+ * @participants: a #GList of #FsParticipant
+ * @direction: #FsStreamDirection describing the direction of the new streams
+ * @remote_codecs: a #GList of #GList of remote #FsCodec, one per participant
+ * @error: location of a #GError, or NULL if no error occured
+ *
+ * Creates one stream per participant and sets their remote codecs, but only
+ * negotiates the codecs and verifies the send codec bin once all of them
+ * have been created.
+ *
+ * Returns: a #GList of the new #FsStream or NULL on error
+ */
+
+static GList *
+fs_rtp_session_new_streams (FsSession *session,
+    GList *participants,
+    FsStreamDirection direction,
+    GList *remote_codecs,
+    GError **error)
+{
+  FsRtpSession *self = FS_RTP_SESSION (session);
+  GQueue streams = G_QUEUE_INIT;
+  GList *item;
+  gboolean ret;
+
+  for (item = participants; item; item = g_list_next (item))
+  {
+    if (!FS_IS_RTP_PARTICIPANT (item->data))
+    {
+      g_set_error (error, FS_ERROR, FS_ERROR_INVALID_ARGUMENTS,
+          "You have to provide participants of type RTP");
+      return NULL;
+    }
+  }
+
+  for (item = participants; item; item = g_list_next (item))
+  {
+    FsStream *stream = fs_rtp_session_new_stream (session, item->data,
+        direction, error);
+
+    if (!stream)
+      goto error;
+
+    g_queue_push_tail (&streams, stream);
+
+    if (remote_codecs)
+    {
+      if (remote_codecs->data)
+      {
+        /* The stream only stores the codecs, see _stream_new_remote_codecs */
+        FS_RTP_SESSION_LOCK (self);
+        self->priv->batch_streams = g_list_prepend (self->priv->batch_streams,
+            stream);
+        FS_RTP_SESSION_UNLOCK (self);
+
+        ret = fs_stream_set_remote_codecs (stream, remote_codecs->data, error);
+
+        FS_RTP_SESSION_LOCK (self);
+        self->priv->batch_streams = g_list_remove (self->priv->batch_streams,
+            stream);
+        FS_RTP_SESSION_UNLOCK (self);
+
+        if (!ret)
+          goto error;
+      }
+      remote_codecs = g_list_next (remote_codecs);
+    }
+  }
+
+  if (fs_rtp_session_has_disposed_enter (self, error))
+    goto error;
+
+  ret = fs_rtp_session_update_codecs (self, NULL, NULL, error);
+
+  fs_rtp_session_has_disposed_exit (self);
+
+  if (!ret)
+    goto error;
+
+  return streams.head;
+
+ error:
+
+  for (item = streams.head; item; item = g_list_next (item))
+  {
+    fs_stream_destroy (item->data);
+    g_object_unref (item->data);
+  }
+  g_list_free (streams.head);
+
+  return NULL;
+}
+
 static GstEvent *
 fs_rtp_session_set_next_telephony_method (FsRtpSession *self,
     gint method)
@@ -2426,6 +2559,29 @@ fs_rtp_session_new (FsMediaType media_type, FsRtpConference *conference,
 }
 
 
+/**
+ * fs_rtp_session_lookup_codec_association_by_pt_locked:
+ * @session: a #FsRtpSession
+ * @pt: a payload type
+ *
+ * Same as lookup_codec_association_by_pt() on the negotiated codecs, but
+ * uses the index built at negotiation time instead of walking the list.
+ *
+ * MUST be called with the FsRtpSession lock held
+ *
+ * Returns: a #CodecAssociation, the caller doesn't own it
+ */
+
+static CodecAssociation *
+fs_rtp_session_lookup_codec_association_by_pt_locked (FsRtpSession *session,
+    gint pt)
+{
+  if (pt < 0 || pt >= CODEC_ASSOCIATION_PT_TABLE_SIZE)
+    return NULL;
+
+  return session->priv->codec_associations_by_pt[pt];
+}
+
 GstCaps *
 fs_rtp_session_request_pt_map (FsRtpSession *session, guint pt)
 {
@@ -2437,8 +2593,7 @@ fs_rtp_session_request_pt_map (FsRtpSession *session, guint pt)
 
   FS_RTP_SESSION_LOCK (session);
 
-  ca = lookup_codec_association_by_pt (
-      session->priv->codec_associations, pt);
+  ca = fs_rtp_session_lookup_codec_association_by_pt_locked (session, pt);
 
   if (ca)
   {
@@ -2969,12 +3124,16 @@ fs_rtp_session_negotiate_codecs_locked (FsRtpSession *session,
   fs_rtp_tfrc_filter_codecs (&new_negotiated_codec_associations,
       &new_hdrexts);
 
+  codec_association_list_intern (new_negotiated_codec_associations);
+
   if (session->priv->codec_associations)
     *is_new = ! codec_associations_list_are_equal (
       session->priv->codec_associations, new_negotiated_codec_associations);
 
   codec_association_list_destroy (session->priv->codec_associations);
   session->priv->codec_associations = new_negotiated_codec_associations;
+  codec_association_list_fill_pt_table (session->priv->codec_associations,
+      FALSE, session->priv->codec_associations_by_pt);
 
   new_hdrexts = finish_header_extensions_nego (new_hdrexts, hdrext_used_ids);
 
@@ -3069,11 +3228,21 @@ _stream_new_remote_codecs (FsRtpStream *stream,
 {
   FsRtpSession *session = FS_RTP_SESSION_CAST (user_data);
   gboolean ret;
+  gboolean in_batch;
 
   if (fs_rtp_session_has_disposed_enter (session, error))
     return FALSE;
 
-  ret = fs_rtp_session_update_codecs (session, stream, codecs, error);
+  FS_RTP_SESSION_LOCK (session);
+  in_batch = (g_list_find (session->priv->batch_streams, stream) != NULL);
+  FS_RTP_SESSION_UNLOCK (session);
+
+  /* Streams created by fs_rtp_session_new_streams() are all negotiated
+   * together at the end */
+  if (in_batch)
+    ret = TRUE;
+  else
+    ret = fs_rtp_session_update_codecs (session, stream, codecs, error);
 
   fs_rtp_session_has_disposed_exit (session);
   return ret;
@@ -3508,7 +3677,7 @@ fs_rtp_session_get_recv_codec_locked (FsRtpSession *session,
     return NULL;
   }
 
-  ca = lookup_codec_association_by_pt (session->priv->codec_associations, pt);
+  ca = fs_rtp_session_lookup_codec_association_by_pt_locked (session, pt);
 
   if (!ca)
   {
@@ -3812,6 +3981,111 @@ special_source_stopped (FsRtpSpecialSource *source, gpointer data)
   fs_rtp_session_has_disposed_exit (self);
 }
 
+static void
+codec_bin_key_free (CodecBinKey *key)
+{
+  g_free (key->profile);
+  fs_codec_destroy (key->send_codec);
+  g_slice_free (CodecBinKey, key);
+}
+
+static void
+codec_bin_set_key (GstElement *codecbin, const CodecAssociation *ca)
+{
+  CodecBinKey *key = g_slice_new (CodecBinKey);
+
+  key->blueprint = ca->blueprint;
+  key->profile = g_strdup (ca->send_profile);
+  key->send_codec = fs_codec_copy (ca->send_codec);
+
+  g_object_set_qdata_full (G_OBJECT (codecbin), codecbin_key_quark, key,
+      (GDestroyNotify) codec_bin_key_free);
+}
+
+static gboolean
+codec_bin_key_matches (GstElement *codecbin, const CodecAssociation *ca)
+{
+  CodecBinKey *key = g_object_get_qdata (G_OBJECT (codecbin),
+      codecbin_key_quark);
+
+  /* The optional parameters end up in the caps and element properties, so
+   * the whole send codec has to match, not just the payload type */
+  return key &&
+      key->blueprint == ca->blueprint &&
+      !g_strcmp0 (key->profile, ca->send_profile) &&
+      fs_codec_are_equal (key->send_codec, ca->send_codec);
+}
+
+/*
+ * Bins with more than one src pad have been validated and linked against the
+ * complete list of send codecs at the time, so they can't be re-used blindly.
+ */
+
+static gboolean
+fs_rtp_session_codec_bin_is_reusable (GstElement *codecbin)
+{
+  return g_object_get_qdata (G_OBJECT (codecbin), codecbin_key_quark) &&
+      codecbin->numsrcpads == 1;
+}
+
+/**
+ * fs_rtp_session_add_idle_send_codec_bin_locked:
+ * @session: a #FsRtpSession
+ * @codecbin: a stopped codec bin that is not in the conference anymore, the
+ *  reference is taken
+ *
+ * Keeps a send codec bin around so that it can be re-used if the same codec
+ * is selected again, dropping the oldest one if there are too many.
+ *
+ * MUST be called with the FsRtpSession lock held
+ */
+
+static void
+fs_rtp_session_add_idle_send_codec_bin_locked (FsRtpSession *session,
+    GstElement *codecbin)
+{
+  g_queue_push_head (&session->priv->idle_send_codecbins, codecbin);
+
+  while (g_queue_get_length (&session->priv->idle_send_codecbins) >
+      MAX_IDLE_SEND_CODECBINS)
+    gst_object_unref (g_queue_pop_tail (&session->priv->idle_send_codecbins));
+}
+
+/**
+ * fs_rtp_session_take_idle_send_codec_bin_locked:
+ * @session: a #FsRtpSession
+ * @ca: The #CodecAssociation that the bin is needed for
+ *
+ * Looks for a previously used send codec bin built for the same codec and
+ * removes it from the idle list.
+ *
+ * MUST be called with the FsRtpSession lock held
+ *
+ * Returns: a codec bin in the NULL state, or %NULL if there is none
+ */
+
+static GstElement *
+fs_rtp_session_take_idle_send_codec_bin_locked (FsRtpSession *session,
+    const CodecAssociation *ca)
+{
+  GList *item;
+
+  for (item = session->priv->idle_send_codecbins.head;
+       item;
+       item = g_list_next (item))
+  {
+    GstElement *codecbin = item->data;
+
+    if (codec_bin_key_matches (codecbin, ca))
+    {
+      g_queue_delete_link (&session->priv->idle_send_codecbins, item);
+      return codecbin;
+    }
+  }
+
+  return NULL;
+}
+
 /*
  * @codec: The currently selected codec for sending (but not the send_codec)
  */
@@ -3827,12 +4101,16 @@ fs_rtp_session_remove_send_codec_bin (FsRtpSession *self,
   if (self->priv->send_codecbin || send_codecbin)
   {
     GstElement *codecbin = self->priv->send_codecbin;
+    gboolean reuse = FALSE;
     self->priv->send_codecbin = NULL;
 
     FS_RTP_SESSION_UNLOCK (self);
 
+    /* Only keep the bins that were fully set up */
     if (!codecbin)
       codecbin = send_codecbin;
+    else
+      reuse = fs_rtp_session_codec_bin_is_reusable (codecbin);
 
     gst_element_set_locked_state (codecbin, TRUE);
     if (gst_element_set_state (codecbin, GST_STATE_NULL) !=
@@ -3847,8 +4125,12 @@ fs_rtp_session_remove_send_codec_bin (FsRtpSession *self,
       return FALSE;
     }
 
+    if (reuse)
+      gst_object_ref (codecbin);
     gst_bin_remove (GST_BIN (self->priv->conference), codecbin);
     FS_RTP_SESSION_LOCK (self);
+    if (reuse)
+      fs_rtp_session_add_idle_send_codec_bin_locked (self, codecbin);
   }
 
   fs_codec_destroy (self->priv->current_send_codec);
@@ -3922,6 +4204,8 @@ fs_rtp_session_add_send_codec_bin_unlock (FsRtpSession *session,
   struct link_data data;
   FsCodec *send_codec_copy = fs_codec_copy (ca->send_codec);
   FsCodec *codec_copy = fs_codec_copy (ca->codec);
+  CodecAssociation *ca_copy;
+  guint send_bitrate;
 
   GST_DEBUG ("Trying to add send codecbin for " FS_CODEC_FORMAT,
       FS_CODEC_ARGS (ca->send_codec));
@@ -3929,9 +4213,6 @@ fs_rtp_session_add_send_codec_bin_unlock (FsRtpSession *session,
   name = g_strdup_printf ("send_%u_%u", session->id, ca->send_codec->id);
   codecs = codec_associations_to_send_codecs (
       session->priv->codec_associations);
-  codecbin = _create_codec_bin (ca, ca->send_codec, name, FS_DIRECTION_SEND,
-      codecs, 0, NULL, error);
-  g_free (name);
 
   sendcaps = fs_codec_to_gst_caps (ca->send_codec);
 
@@ -3943,12 +4224,36 @@ fs_rtp_session_add_send_codec_bin_unlock (FsRtpSession *session,
     g_object_get (session->priv->rtp_tfrc, "bitrate", &bitrate, NULL);
     session->priv->send_bitrate = bitrate;
   }
+  send_bitrate = session->priv->send_bitrate;
 
+  codecbin = fs_rtp_session_take_idle_send_codec_bin_locked (session, ca);
   if (codecbin)
-    codecbin_set_bitrate (codecbin, session->priv->send_bitrate);
+  {
+    GST_DEBUG ("Re-using send codec bin %s", GST_ELEMENT_NAME (codecbin));
+    ca_copy = NULL;
+  }
+  else
+  {
+    ca_copy = codec_association_copy (ca);
+  }
 
   FS_RTP_SESSION_UNLOCK (session);
 
+  /* Instantiating the encoder can be slow, don't hold the session lock
+   * while doing it. The bitrate is set again once we re-take it. */
+  if (ca_copy)
+  {
+    codecbin = _create_codec_bin (ca_copy, ca_copy->send_codec, name,
+        FS_DIRECTION_SEND, codecs, 0, NULL, error);
+    if (codecbin)
+      codec_bin_set_key (codecbin, ca_copy);
+    codec_association_destroy (ca_copy);
+  }
+  g_free (name);
+
+  if (codecbin)
+    codecbin_set_bitrate (codecbin, send_bitrate);
+
   if (!codecbin)
   {
     g_set_error (error, FS_ERROR, FS_ERROR_CONSTRUCTION,
@@ -4077,7 +4382,7 @@ fs_rtp_session_add_send_codec_bin_unlock (FsRtpSession *session,
 
     data.other_codecs = g_list_remove (data.other_codecs, other_send_codec);
 
-    ca = lookup_codec_association_by_pt (session->priv->codec_associations,
+    ca = fs_rtp_session_lookup_codec_association_by_pt_locked (session,
         other_send_codec->id);
 
     if (ca)
@@ -4301,21 +4606,34 @@ _substream_get_codec_bin (FsRtpSubStream *substream,
 
   ca = fs_rtp_session_get_recv_codec_locked (session, substream->pt, stream,
       new_codec, error);
+  if (ca)
+    ca = codec_association_copy (ca);
+
+  FS_RTP_SESSION_UNLOCK (session);
+
   if (!ca)
     goto out;
 
+  /* Instantiating the elements can be slow, so do it on our own copy of the
+   * codec association without holding the session lock.
+   * Unlike the send side, decoder bins are not pooled: there is one substream
+   * per SSRC and payload type, so when the sender switches back and forth
+   * between codecs, each decoder stays alive in its own substream. A bin is
+   * only replaced here when the negotiated codec itself changed, in which
+   * case the old one could not be re-used anyway.
+   */
   name = g_strdup_printf ("recv_%u_%u_%u", session->id, substream->ssrc,
       substream->pt);
   codecbin = _create_codec_bin (ca, *new_codec, name, FS_DIRECTION_RECV, NULL,
       current_builder_hash, new_builder_hash, error);
   g_free (name);
 
+  codec_association_destroy (ca);
+
  out:
 
   fs_rtp_session_has_disposed_exit (session);
 
-  FS_RTP_SESSION_UNLOCK (session);
-
   return codecbin;
 }
 
@@ -4540,6 +4858,8 @@ gather_caps_parameters (CodecAssociation *ca, GstCaps *caps)
   int i;
   gboolean new_config = FALSE;
 
+  codec_association_make_writable (ca);
+
   s = gst_caps_get_structure (caps, 0);
 
   for (i = 0; i < gst_structure_n_fields (s); i++)
@@ -4589,6 +4909,7 @@ gather_caps_parameters (CodecAssociation *ca, GstCaps *caps)
   }
 
   ca->need_config = FALSE;
+  codec_association_intern (ca);
 
   return new_config;
 }
@@ -4749,13 +5070,17 @@ fs_rtp_session_get_codec_params_unlock (FsRtpSession *session,
   session->priv->discovery_codec = NULL;
 
   tmp = g_strdup_printf ("discoverAA_%u_%u", session->id, ca->send_codec->id);
+  ca = codec_association_copy (ca);
+
+  FS_RTP_SESSION_UNLOCK (session);
+
   codecbin = _create_codec_bin (ca, ca->send_codec, tmp, FS_DIRECTION_SEND,
       NULL,
       0, NULL, error);
   g_free (tmp);
 
-  FS_RTP_SESSION_UNLOCK (session);
-  /* Invalidate CA because we've just unlocked */
+  /* Only keep the copy while building, the original may be gone already */
+  codec_association_destroy (ca);
   ca = NULL;
 
   if (session->priv->discovery_codecbin)
@@ -5160,44 +5485,66 @@ fs_rtp_session_ssrc_validated (FsRtpSession *session,
   fs_rtp_session_has_disposed_exit (session);
 }
 
-struct CodecBinSetBitrateData
-{
-  guint bitrate;
-  gboolean ret;
-};
-
 static void
-codecbin_set_bitrate_func (const GValue *item, gpointer user_data)
+codecbin_find_bitrate_elements_func (const GValue *item, gpointer user_data)
 {
   GstElement *elem = g_value_get_object (item);
-  struct CodecBinSetBitrateData *data = user_data;
+  GPtrArray *elements = user_data;
 
   if (g_object_class_find_property (G_OBJECT_GET_CLASS (elem), "bitrate"))
+    g_ptr_array_add (elements, gst_object_ref (elem));
+}
+
+/*
+ * The elements of a codec bin never change once it has been built, so the
+ * ones that have a bitrate property are looked up once and kept on the bin.
+ */
+static GPtrArray *
+codecbin_get_bitrate_elements (GstElement *codecbin)
+{
+  GPtrArray *elements;
+  GstIterator *it;
+
+  elements = g_object_get_qdata (G_OBJECT (codecbin),
+      codecbin_bitrate_elements_quark);
+  if (elements)
+    return elements;
+
+  elements = g_ptr_array_new_with_free_func (gst_object_unref);
+
+  it = gst_bin_iterate_recurse (GST_BIN (codecbin));
+  while (gst_iterator_foreach (it, codecbin_find_bitrate_elements_func,
+          elements) == GST_ITERATOR_RESYNC)
   {
-    fs_utils_set_bitrate (elem, data->bitrate);
-    data->ret = TRUE;
+    g_ptr_array_set_size (elements, 0);
+    gst_iterator_resync (it);
   }
+  gst_iterator_free (it);
+
+  g_object_set_qdata_full (G_OBJECT (codecbin),
+      codecbin_bitrate_elements_quark, elements,
+      (GDestroyNotify) g_ptr_array_unref);
+
+  return elements;
 }
 
 static gboolean
 codecbin_set_bitrate (GstElement *codecbin, guint bitrate)
 {
-  GstIterator *it;
-  struct CodecBinSetBitrateData data;
+  GPtrArray *elements;
+  guint i;
 
   if (bitrate == 0)
     return FALSE;
 
   GST_DEBUG ("Setting bitrate to %u bits/sec", bitrate);
 
-  data.bitrate = bitrate;
-  data.ret = FALSE;
+  elements = codecbin_get_bitrate_elements (codecbin);
 
-  it = gst_bin_iterate_recurse (GST_BIN (codecbin));
-  gst_iterator_foreach (it, codecbin_set_bitrate_func, &data);
-  gst_iterator_free (it);
+  for (i = 0; i < elements->len; i++)
+    fs_utils_set_bitrate (g_ptr_array_index (elements, i), bitrate);
 
-  return data.ret;
+  return elements->len > 0;
 }
 
 static void
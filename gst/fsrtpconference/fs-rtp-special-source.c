@@ -64,7 +64,7 @@ struct _FsRtpSpecialSourcePrivate {
   GstPad *muxer_request_pad;
   GstElement *src;
 
-  GThread *stop_thread;
+  gboolean stopping;
 
   fs_rtp_special_source_stopped_callback stopped_callback;
   gpointer stopped_data;
@@ -145,15 +145,16 @@ fs_rtp_special_source_init (FsRtpSpecialSource *self)
 }
 
 /**
- * stop_source_thread:
+ * stop_source:
  * @data: a pointer to the current #FsRtpSpecialSource
  *
- * This functioin will lock on the source's state change until its release
- * and only then let the source be disposed of
+ * This function is run from the conference's teardown threads, it will lock
+ * on the source's state change until its release and only then let the
+ * source be disposed of
  */
 
-static gpointer
-stop_source_thread (gpointer data)
+static void
+stop_source (gpointer data)
 {
   FsRtpSpecialSource *self = FS_RTP_SPECIAL_SOURCE (data);
 
@@ -177,8 +178,6 @@ stop_source_thread (gpointer data)
     self->priv->stopped_callback (self, self->priv->stopped_data);
 
   g_object_unref (self);
-
-  return NULL;
 }
 
 static gboolean
@@ -187,7 +186,7 @@ fs_rtp_special_source_is_stopping (FsRtpSpecialSource *self)
   gboolean stopping;
 
   FS_RTP_SPECIAL_SOURCE_LOCK (self);
-  stopping = !!self->priv->stop_thread;
+  stopping = self->priv->stopping;
   FS_RTP_SPECIAL_SOURCE_UNLOCK (self);
 
   return stopping;
@@ -203,22 +202,22 @@ fs_rtp_special_source_stop_locked (FsRtpSpecialSource *self)
 
   if (self->priv->src)
   {
-    if (self->priv->stop_thread)
+    if (self->priv->stopping)
     {
-      GST_DEBUG ("stopping thread for special source already running");
+      GST_DEBUG ("stopping of special source already queued");
       return TRUE;
     }
 
     g_object_ref (self);
-    self->priv->stop_thread = g_thread_new ("special-source-stop",
-        stop_source_thread, self);
-    g_thread_unref (self->priv->stop_thread);
+    self->priv->stopping = TRUE;
+    fs_rtp_conference_push_teardown (
+        FS_RTP_CONFERENCE (self->priv->outer_bin), stop_source, self);
 
     return TRUE;
   }
   else
   {
-    self->priv->stop_thread = GUINT_TO_POINTER (1);
+    self->priv->stopping = TRUE;
     return FALSE;
   }
 }
@@ -479,7 +478,8 @@ fs_rtp_special_sources_remove (
  * @mutex: the mutex protecting the last two things
  * @selected_codec: The currently selected codec for sending (but not
  *    send_codec)
- * @bin: The #GstBin to add the stuff to
+ * @bin: The #FsRtpConference to add the stuff to, its teardown threads are
+ *   used to stop the sources
  * @rtpmuxer: The rtpmux element
  *
  * This function add special sources that don't already exist but are needed
@@ -500,6 +500,9 @@ fs_rtp_special_sources_create (
 
   fs_rtp_special_sources_init ();
 
+  /* Don't build new sources faster than the old ones are torn down */
+  fs_rtp_conference_wait_teardowns (FS_RTP_CONFERENCE (bin));
+
   g_mutex_lock (mutex);
 
   for (klass_item = g_list_first (classes);
@@ -78,7 +78,8 @@ enum
   PROP_RTP_HEADER_EXTENSIONS,
   PROP_DECRYPTION_PARAMETERS,
   PROP_SEND_RTCP_MUX,
-  PROP_REQUIRE_ENCRYPTION
+  PROP_REQUIRE_ENCRYPTION,
+  PROP_REMOTE_CANDIDATES_DONE
 };
 
 struct _FsRtpStreamPrivate
@@ -88,6 +89,7 @@ struct _FsRtpStreamPrivate
 
   FsStreamDirection direction;
   gboolean send_rtcp_mux;
+  gboolean remote_candidates_done;
 
   stream_new_remote_codecs_cb new_remote_codecs_cb;
   stream_known_source_packet_receive_cb known_source_packet_received_cb;
@@ -104,6 +106,7 @@ struct _FsRtpStreamPrivate
   gulong local_candidates_prepared_handler_id;
   gulong new_active_candidate_pair_handler_id;
   gulong new_local_candidate_handler_id;
+  gulong new_local_candidates_handler_id;
   gulong error_handler_id;
   gulong known_source_packet_received_handler_id;
   gulong state_changed_handler_id;
@@ -246,6 +249,17 @@ fs_rtp_stream_class_init (FsRtpStreamClass *klass)
           "Send RTCP muxed with on the same RTP connection",
           FALSE,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /* Forwarded to the stream transmitters that support it (like nice), so
+   * that the application can tell it that the peer has sent all of its
+   * candidates */
+  g_object_class_install_property (gobject_class,
+      PROP_REMOTE_CANDIDATES_DONE,
+      g_param_spec_boolean ("remote-candidates-done",
+          "Remote candidates done",
+          "Whether the remote side has sent all of its candidates",
+          FALSE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 }
 
 static void
@@ -341,6 +355,9 @@ fs_rtp_stream_dispose (GObject *object)
         self->priv->new_active_candidate_pair_handler_id);
     g_signal_handler_disconnect (st,
         self->priv->new_local_candidate_handler_id);
+    if (self->priv->new_local_candidates_handler_id)
+      g_signal_handler_disconnect (st,
+          self->priv->new_local_candidates_handler_id);
     g_signal_handler_disconnect (st,
         self->priv->error_handler_id);
     g_signal_handler_disconnect (st,
@@ -480,6 +497,29 @@ fs_rtp_stream_get_property (GObject *object,
         g_value_set_boolean (value, FALSE);
       FS_RTP_SESSION_UNLOCK (session);
       break;
+    case PROP_REMOTE_CANDIDATES_DONE:
+      {
+        FsStreamTransmitter *st = NULL;
+
+        FS_RTP_SESSION_LOCK (session);
+        /* An ICE restart clears it in the transmitter */
+        if (self->priv->stream_transmitter != NULL &&
+            g_object_class_find_property (
+                G_OBJECT_GET_CLASS (self->priv->stream_transmitter),
+                "remote-candidates-done") != NULL)
+          st = g_object_ref (self->priv->stream_transmitter);
+        else
+          g_value_set_boolean (value, self->priv->remote_candidates_done);
+        FS_RTP_SESSION_UNLOCK (session);
+
+        if (st)
+        {
+          g_object_get_property (G_OBJECT (st), "remote-candidates-done",
+              value);
+          g_object_unref (st);
+        }
+      }
+      break;
     case PROP_REQUIRE_ENCRYPTION:
       FS_RTP_SESSION_LOCK (session);
       g_value_set_boolean (value, fs_rtp_stream_requires_crypto_locked (self));
@@ -589,6 +629,25 @@ fs_rtp_stream_set_property (GObject *object,
         }
       }
       break;
+    case PROP_REMOTE_CANDIDATES_DONE:
+      {
+        FsRtpSession *session = fs_rtp_stream_get_session (self, NULL);
+
+        if (session) {
+          FS_RTP_SESSION_LOCK (session);
+          self->priv->remote_candidates_done = g_value_get_boolean (value);
+          if (self->priv->stream_transmitter != NULL &&
+              g_object_class_find_property (
+                  G_OBJECT_GET_CLASS (self->priv->stream_transmitter),
+                  "remote-candidates-done") != NULL)
+            g_object_set (self->priv->stream_transmitter,
+                "remote-candidates-done", self->priv->remote_candidates_done,
+                NULL);
+          FS_RTP_SESSION_UNLOCK (session);
+          g_object_unref (session);
+        }
+      }
+      break;
     case PROP_REQUIRE_ENCRYPTION:
       {
         FsRtpSession *session = fs_rtp_stream_get_session (self, NULL);
@@ -892,6 +951,32 @@ _new_local_candidate (
   g_object_unref (session);
 }
 
+static void
+_new_local_candidates (
+    FsStreamTransmitter *stream_transmitter,
+    GList *candidates,
+    gpointer user_data)
+{
+  FsRtpStream *self = FS_RTP_STREAM (user_data);
+  FsRtpSession *session = fs_rtp_stream_get_session (self, NULL);
+  GstElement *conf = NULL;
+
+  if (!session)
+    return;
+
+  g_object_get (session, "conference", &conf, NULL);
+
+  gst_element_post_message (conf,
+      gst_message_new_element (GST_OBJECT (conf),
+          gst_structure_new ("farstream-new-local-candidates",
+              "stream", FS_TYPE_STREAM, self,
+              "candidates", FS_TYPE_CANDIDATE_LIST, candidates,
+              NULL)));
+
+  gst_object_unref (conf);
+  g_object_unref (session);
+}
+
 static void
 _transmitter_error (
     FsStreamTransmitter *stream_transmitter,
@@ -1225,6 +1310,13 @@ fs_rtp_stream_set_transmitter (FsStream *stream,
         "new-local-candidate",
         G_CALLBACK (_new_local_candidate),
         self, 0);
+  /* Only some transmitters batch their candidates */
+  if (g_signal_lookup ("new-local-candidates", G_OBJECT_TYPE (st)))
+    self->priv->new_local_candidates_handler_id =
+      g_signal_connect_object (st,
+          "new-local-candidates",
+          G_CALLBACK (_new_local_candidates),
+          self, 0);
   self->priv->error_handler_id =
     g_signal_connect_object (st,
         "error",
@@ -1251,6 +1343,10 @@ fs_rtp_stream_set_transmitter (FsStream *stream,
   if (g_object_class_find_property (G_OBJECT_GET_CLASS (st),
           "send-component-mux") != NULL)
     g_object_set (st, "send-component-mux", self->priv->send_rtcp_mux, NULL);
+  if (self->priv->remote_candidates_done &&
+      g_object_class_find_property (G_OBJECT_GET_CLASS (st),
+          "remote-candidates-done") != NULL)
+    g_object_set (st, "remote-candidates-done", TRUE, NULL);
   FS_RTP_SESSION_UNLOCK (session);
 
   if (!fs_stream_transmitter_gather_local_candidates (st, error))
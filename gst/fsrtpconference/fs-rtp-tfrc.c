@@ -1416,6 +1416,20 @@ fs_rtp_tfrc_filter_codecs (GList **codec_associations,
     CodecAssociation *ca = item->data;
     GList *item2;
 
+    for (item2 = ca->codec->feedback_params; item2; item2 = item2->next)
+    {
+      FsFeedbackParameter *p = item2->data;
+
+      if (!g_ascii_strcasecmp (p->type, "tfrc"))
+        break;
+    }
+
+    if (!item2)
+      continue;
+
+    /* The recv-only ones may share their codec with the old associations */
+    codec_association_make_writable (ca);
+
     for (item2 = ca->codec->feedback_params; item2;)
     {
       GList *next2 = item2->next;
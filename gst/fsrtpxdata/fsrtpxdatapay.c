@@ -24,6 +24,19 @@
 #include "config.h"
 #endif
 
+/**
+ * SECTION:element-fsrtpxdatapay
+ *
+ * Payloads a x-data byte stream into RTP packets of at most the size of the
+ * MTU. Bigger buffers are split into multiple packets that share the memory
+ * of the input buffer.
+ *
+ * If the #GstRTPBasePayload:min-ptime property is set, small buffers are
+ * aggregated until there is enough data to fill a packet or the data
+ * covers at least min-ptime. Data is never held back for more than min-ptime
+ * of clock time, so a message on an otherwise idle channel is still sent.
+ */
+
 #include "fsrtpxdatapay.h"
 #include <gst/rtp/gstrtpbuffer.h>
 
@@ -54,6 +67,11 @@ static gboolean fs_rtp_xdata_pay_setcaps (GstRTPBasePayload * payload,
     GstCaps * caps);
 static GstFlowReturn fs_rtp_xdata_pay_handle_buffer (GstRTPBasePayload *payload,
     GstBuffer *buffer);
+static gboolean fs_rtp_xdata_pay_sink_event (GstRTPBasePayload *payload,
+    GstEvent *event);
+static GstStateChangeReturn fs_rtp_xdata_pay_change_state (
+    GstElement *element, GstStateChange transition);
+static void fs_rtp_xdata_pay_finalize (GObject *object);
 
 G_DEFINE_TYPE (FsRTPXdataPay, fs_rtp_xdata_pay,
     GST_TYPE_RTP_BASE_PAYLOAD);
@@ -61,14 +79,21 @@ G_DEFINE_TYPE (FsRTPXdataPay, fs_rtp_xdata_pay,
 static void
 fs_rtp_xdata_pay_class_init (FsRTPXdataPayClass * klass)
 {
+  GObjectClass *gobject_class;
   GstElementClass *gstelement_class;
   GstRTPBasePayloadClass *gstrtpbasepayload_class;
 
+  gobject_class = (GObjectClass *) klass;
   gstelement_class = (GstElementClass *) klass;
   gstrtpbasepayload_class = (GstRTPBasePayloadClass *) klass;
 
+  gobject_class->finalize = fs_rtp_xdata_pay_finalize;
+
+  gstelement_class->change_state = fs_rtp_xdata_pay_change_state;
+
   gstrtpbasepayload_class->set_caps = fs_rtp_xdata_pay_setcaps;
   gstrtpbasepayload_class->handle_buffer = fs_rtp_xdata_pay_handle_buffer;
+  gstrtpbasepayload_class->sink_event = fs_rtp_xdata_pay_sink_event;
 
   gst_element_class_add_pad_template (gstelement_class,
       gst_static_pad_template_get (&fs_rtp_xdata_pay_sink_template));
@@ -94,6 +119,18 @@ fs_rtp_xdata_pay_init (FsRTPXdataPay * rtpxdatapay)
       "X-DATA", 90000);
   GST_RTP_BASE_PAYLOAD_MTU(rtpbasepayload) = MAX_PAYLOAD_SIZE +
       gst_rtp_buffer_calc_header_len (0);
+
+  rtpxdatapay->adapter = gst_adapter_new ();
+}
+
+static void
+fs_rtp_xdata_pay_finalize (GObject *object)
+{
+  FsRTPXdataPay *self = FS_RTP_XDATA_PAY (object);
+
+  g_object_unref (self->adapter);
+
+  G_OBJECT_CLASS (fs_rtp_xdata_pay_parent_class)->finalize (object);
 }
 
 static gboolean
@@ -102,27 +139,181 @@ fs_rtp_xdata_pay_setcaps (GstRTPBasePayload * rtpbasepayload, GstCaps * caps)
   return gst_rtp_base_payload_set_outcaps (rtpbasepayload, NULL);
 }
 
+static guint
+fs_rtp_xdata_pay_get_max_payload (GstRTPBasePayload *payload)
+{
+  return GST_RTP_BASE_PAYLOAD_MTU (payload) -
+      gst_rtp_buffer_calc_header_len (0);
+}
+
+/* Takes the payload data as-is, its memory ends up in the RTP packet */
+static GstBuffer *
+fs_rtp_xdata_pay_make_packet (GstBuffer *data)
+{
+  GstBuffer *rtpbuf = gst_rtp_buffer_new_allocate (0, 0, 0);
+
+  gst_buffer_copy_into (rtpbuf, data, GST_BUFFER_COPY_TIMESTAMPS, 0, -1);
+
+  return gst_buffer_append (rtpbuf, data);
+}
+
+static void
+fs_rtp_xdata_pay_cancel_timeout (FsRTPXdataPay *self)
+{
+  GST_OBJECT_LOCK (self);
+  if (self->timeout_id)
+  {
+    gst_clock_id_unschedule (self->timeout_id);
+    gst_clock_id_unref (self->timeout_id);
+    self->timeout_id = NULL;
+  }
+  GST_OBJECT_UNLOCK (self);
+}
+
+/* Sends the data in the adapter as full packets, and the remainder too if
+ * flush is TRUE */
+static GstFlowReturn
+fs_rtp_xdata_pay_drain (FsRTPXdataPay *self, gboolean flush)
+{
+  GstRTPBasePayload *payload = GST_RTP_BASE_PAYLOAD (self);
+  GstBufferList *rtplist = NULL;
+  guint mtu = fs_rtp_xdata_pay_get_max_payload (payload);
+  gsize avail;
+
+  while ((avail = gst_adapter_available (self->adapter)) >= mtu ||
+      (flush && avail > 0))
+  {
+    GstClockTime pts = gst_adapter_prev_pts (self->adapter, NULL);
+    GstBuffer *data;
+
+    data = gst_adapter_take_buffer_fast (self->adapter, MIN (avail, mtu));
+    GST_BUFFER_PTS (data) = pts;
+
+    if (!rtplist)
+      rtplist = gst_buffer_list_new ();
+    gst_buffer_list_add (rtplist, fs_rtp_xdata_pay_make_packet (data));
+  }
+
+  if (avail == 0)
+    fs_rtp_xdata_pay_cancel_timeout (self);
+
+  if (!rtplist)
+    return GST_FLOW_OK;
+
+  return gst_rtp_base_payload_push_list (payload, rtplist);
+}
+
+/* Runs from the clock thread, the stream lock keeps the buffers out */
+static gboolean
+fs_rtp_xdata_pay_timeout (GstClock *clock, GstClockTime time, GstClockID id,
+    gpointer user_data)
+{
+  FsRTPXdataPay *self = user_data;
+  GstPad *sinkpad = GST_RTP_BASE_PAYLOAD_SINKPAD (self);
+
+  GST_PAD_STREAM_LOCK (sinkpad);
+  GST_OBJECT_LOCK (self);
+  if (self->timeout_id != id)
+  {
+    GST_OBJECT_UNLOCK (self);
+    GST_PAD_STREAM_UNLOCK (sinkpad);
+    return TRUE;
+  }
+  gst_clock_id_unref (self->timeout_id);
+  self->timeout_id = NULL;
+  GST_OBJECT_UNLOCK (self);
+
+  GST_LOG_OBJECT (self, "min-ptime expired, sending %" G_GSIZE_FORMAT
+      " queued bytes", gst_adapter_available (self->adapter));
+  fs_rtp_xdata_pay_drain (self, TRUE);
+  GST_PAD_STREAM_UNLOCK (sinkpad);
+
+  return TRUE;
+}
+
+/* Makes sure the data queued since first_pts is sent after min_ptime even if
+ * no other buffer comes */
+static void
+fs_rtp_xdata_pay_schedule_timeout (FsRTPXdataPay *self, GstClockTime first_pts,
+    gint64 min_ptime)
+{
+  GstRTPBasePayload *payload = GST_RTP_BASE_PAYLOAD (self);
+  GstClockTime running_time;
+  GstClock *clock;
+
+  running_time = gst_segment_to_running_time (&payload->segment,
+      GST_FORMAT_TIME, first_pts);
+  if (!GST_CLOCK_TIME_IS_VALID (running_time))
+    return;
+
+  clock = gst_element_get_clock (GST_ELEMENT (self));
+  if (!clock)
+    return;
+
+  GST_OBJECT_LOCK (self);
+  if (!self->timeout_id)
+  {
+    self->timeout_id = gst_clock_new_single_shot_id (clock,
+        GST_ELEMENT_CAST (self)->base_time + running_time + min_ptime);
+    gst_clock_id_wait_async (self->timeout_id, fs_rtp_xdata_pay_timeout,
+        gst_object_ref (self), gst_object_unref);
+  }
+  GST_OBJECT_UNLOCK (self);
+
+  gst_object_unref (clock);
+}
+
 static GstFlowReturn
 fs_rtp_xdata_pay_handle_buffer (GstRTPBasePayload *payload, GstBuffer *buffer)
 {
+  FsRTPXdataPay *self = FS_RTP_XDATA_PAY (payload);
   GstBuffer *rtpbuf;
   gsize size;
   guint mtu;
+  GstClockTime pts, first_pts;
+  gint64 min_ptime;
+  GstFlowReturn ret;
 
   size = gst_buffer_get_size (buffer);
-  mtu = GST_RTP_BASE_PAYLOAD_MTU(payload);
-  mtu -= gst_rtp_buffer_calc_header_len (0);
+  mtu = fs_rtp_xdata_pay_get_max_payload (payload);
+
+  GST_OBJECT_LOCK (payload);
+  min_ptime = payload->min_ptime;
+  GST_OBJECT_UNLOCK (payload);
+
+  if (min_ptime > 0 || gst_adapter_available (self->adapter) > 0)
+  {
+    pts = GST_BUFFER_PTS (buffer);
+    if (GST_BUFFER_DURATION_IS_VALID (buffer) && GST_CLOCK_TIME_IS_VALID (pts))
+      pts += GST_BUFFER_DURATION (buffer);
+
+    gst_adapter_push (self->adapter, buffer);
+
+    first_pts = gst_adapter_prev_pts (self->adapter, NULL);
+
+    /* Without timestamps, there is no way to know when to stop waiting */
+    ret = fs_rtp_xdata_pay_drain (self, min_ptime <= 0 ||
+        !GST_CLOCK_TIME_IS_VALID (pts) ||
+        !GST_CLOCK_TIME_IS_VALID (first_pts) ||
+        pts >= first_pts + min_ptime);
+
+    if (gst_adapter_available (self->adapter) > 0)
+      fs_rtp_xdata_pay_schedule_timeout (self,
+          gst_adapter_prev_pts (self->adapter, NULL), min_ptime);
+
+    return ret;
+  }
 
   if (size <= mtu) {
-    rtpbuf = gst_rtp_buffer_new_allocate (0, 0, 0);
-    rtpbuf = gst_buffer_append (rtpbuf, buffer);
+    rtpbuf = fs_rtp_xdata_pay_make_packet (buffer);
 
     return gst_rtp_base_payload_push (payload, rtpbuf);
   } else {
-    GstBufferList *rtplist = gst_buffer_list_new_sized (2);
+    GstBufferList *rtplist = gst_buffer_list_new_sized (size / mtu + 1);
     gsize offset = 0;
     gsize new_size;
 
+    /* The memory is shared between the input buffer and the packets */
     while (size > 0) {
       new_size = size > mtu ? mtu : size;
 
@@ -138,6 +329,54 @@ fs_rtp_xdata_pay_handle_buffer (GstRTPBasePayload *payload, GstBuffer *buffer)
   }
 }
 
+static gboolean
+fs_rtp_xdata_pay_sink_event (GstRTPBasePayload *payload, GstEvent *event)
+{
+  FsRTPXdataPay *self = FS_RTP_XDATA_PAY (payload);
+
+  switch (GST_EVENT_TYPE (event))
+  {
+    case GST_EVENT_EOS:
+    case GST_EVENT_GAP:
+      /* Nothing more is coming for now, so don't wait for more data */
+      fs_rtp_xdata_pay_drain (self, TRUE);
+      break;
+    case GST_EVENT_FLUSH_START:
+      fs_rtp_xdata_pay_cancel_timeout (self);
+      break;
+    case GST_EVENT_FLUSH_STOP:
+      gst_adapter_clear (self->adapter);
+      break;
+    default:
+      break;
+  }
+
+  return GST_RTP_BASE_PAYLOAD_CLASS (
+      fs_rtp_xdata_pay_parent_class)->sink_event (payload, event);
+}
+
+static GstStateChangeReturn
+fs_rtp_xdata_pay_change_state (GstElement *element, GstStateChange transition)
+{
+  FsRTPXdataPay *self = FS_RTP_XDATA_PAY (element);
+  GstStateChangeReturn ret;
+
+  ret = GST_ELEMENT_CLASS (fs_rtp_xdata_pay_parent_class)->change_state (
+      element, transition);
+
+  switch (transition)
+  {
+    case GST_STATE_CHANGE_PAUSED_TO_READY:
+      fs_rtp_xdata_pay_cancel_timeout (self);
+      gst_adapter_clear (self->adapter);
+      break;
+    default:
+      break;
+  }
+
+  return ret;
+}
+
 gboolean
 fs_rtp_xdata_pay_plugin_init (GstPlugin * plugin)
 {
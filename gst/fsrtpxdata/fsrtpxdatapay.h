@@ -24,6 +24,7 @@
 #define __FS_RTP_XDATA_PAY_H__
 
 #include <gst/gst.h>
+#include <gst/base/gstadapter.h>
 #include <gst/rtp/gstrtpbasepayload.h>
 
 G_BEGIN_DECLS
@@ -43,6 +44,13 @@ typedef struct _FsRTPXdataPayClass FsRTPXdataPayClass;
 struct _FsRTPXdataPay
 {
   GstRTPBasePayload payload;
+
+  /* Data waiting to be aggregated, only used if min-ptime is set */
+  GstAdapter *adapter;
+
+  /* Fires when the oldest data has waited for min-ptime,
+   * protected by the object lock */
+  GstClockID timeout_id;
 };
 
 struct _FsRTPXdataPayClass
@@ -26,6 +26,14 @@
  *
  * This element will remove the framerate from video caps, it is a poor man's
  * videorate for live pipelines.
+ *
+ * It can also drop frames to stay under a maximum framerate, set with the
+ * #FsVideoanyrate:max-framerate property or with a custom downstream
+ * sticky (or out-of-band) event named "farstream-max-framerate" carrying a
+ * "framerate" fraction. The lowest of the two limits applies. The frames that
+ * are kept follow a regular cadence and the frame following a request for a
+ * key unit is never dropped. Only raw video is dropped, encoded frames depend
+ * on the ones before them so they are always let through.
  */
 
 #ifdef HAVE_CONFIG_H
@@ -59,8 +67,18 @@ enum
 enum
 {
   ARG_0,
+  ARG_MAX_FRAMERATE
 };
 
+static void fs_videoanyrate_set_property (GObject *object,
+    guint prop_id,
+    const GValue *value,
+    GParamSpec *pspec);
+static void fs_videoanyrate_get_property (GObject *object,
+    guint prop_id,
+    GValue *value,
+    GParamSpec *pspec);
+
 
 static GstCaps *
 fs_videoanyrate_transform_caps (GstBaseTransform *trans,
@@ -70,6 +88,15 @@ fs_videoanyrate_transform_caps (GstBaseTransform *trans,
 static GstCaps *
 fs_videoanyrate_fixate_caps (GstBaseTransform * base,
     GstPadDirection direction, GstCaps * caps, GstCaps * othercaps);
+static gboolean fs_videoanyrate_set_caps (GstBaseTransform *trans,
+    GstCaps *incaps, GstCaps *outcaps);
+static gboolean fs_videoanyrate_start (GstBaseTransform *trans);
+static gboolean fs_videoanyrate_sink_event (GstBaseTransform *trans,
+    GstEvent *event);
+static gboolean fs_videoanyrate_src_event (GstBaseTransform *trans,
+    GstEvent *event);
+static GstFlowReturn fs_videoanyrate_transform_ip (GstBaseTransform *trans,
+    GstBuffer *buf);
 
 
 G_DEFINE_TYPE (FsVideoanyrate, fs_videoanyrate, GST_TYPE_BASE_TRANSFORM);
@@ -78,12 +105,17 @@ G_DEFINE_TYPE (FsVideoanyrate, fs_videoanyrate, GST_TYPE_BASE_TRANSFORM);
 static void
 fs_videoanyrate_class_init (FsVideoanyrateClass *klass)
 {
+  GObjectClass *gobject_class;
   GstElementClass *element_class;
   GstBaseTransformClass *gstbasetransform_class;
 
+  gobject_class = G_OBJECT_CLASS (klass);
   element_class = GST_ELEMENT_CLASS (klass);
   gstbasetransform_class = GST_BASE_TRANSFORM_CLASS (klass);
 
+  gobject_class->set_property = fs_videoanyrate_set_property;
+  gobject_class->get_property = fs_videoanyrate_get_property;
+
 
   GST_DEBUG_CATEGORY_INIT
     (videoanyrate_debug, "fsvideoanyrate", 0, "fsvideoanyrate");
@@ -103,11 +135,81 @@ fs_videoanyrate_class_init (FsVideoanyrateClass *klass)
     GST_DEBUG_FUNCPTR (fs_videoanyrate_transform_caps);
   gstbasetransform_class->fixate_caps =
     GST_DEBUG_FUNCPTR (fs_videoanyrate_fixate_caps);
+  gstbasetransform_class->set_caps =
+    GST_DEBUG_FUNCPTR (fs_videoanyrate_set_caps);
+  gstbasetransform_class->start = GST_DEBUG_FUNCPTR (fs_videoanyrate_start);
+  gstbasetransform_class->sink_event =
+    GST_DEBUG_FUNCPTR (fs_videoanyrate_sink_event);
+  gstbasetransform_class->src_event =
+    GST_DEBUG_FUNCPTR (fs_videoanyrate_src_event);
+  gstbasetransform_class->transform_ip =
+    GST_DEBUG_FUNCPTR (fs_videoanyrate_transform_ip);
+
+  g_object_class_install_property (gobject_class,
+      ARG_MAX_FRAMERATE,
+      gst_param_spec_fraction ("max-framerate",
+          "Maximum framerate",
+          "Raw frames are dropped to stay under this framerate"
+          " (0/1 to disable)",
+          0, 1, G_MAXINT, 1, 0, 1,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 }
 
 static void
 fs_videoanyrate_init (FsVideoanyrate *videoanyrate)
 {
+  videoanyrate->max_fps_n = 0;
+  videoanyrate->max_fps_d = 1;
+  videoanyrate->event_fps_n = 0;
+  videoanyrate->event_fps_d = 1;
+  videoanyrate->next_ts = GST_CLOCK_TIME_NONE;
+
+  /* The buffers are never modified, only dropped, so they are never copied
+   * even if the framerate in the caps changes */
+  gst_base_transform_set_passthrough (GST_BASE_TRANSFORM (videoanyrate), TRUE);
+}
+
+static void
+fs_videoanyrate_set_property (GObject *object,
+    guint prop_id,
+    const GValue *value,
+    GParamSpec *pspec)
+{
+  FsVideoanyrate *self = FS_VIDEOANYRATE (object);
+
+  switch (prop_id)
+  {
+    case ARG_MAX_FRAMERATE:
+      GST_OBJECT_LOCK (self);
+      self->max_fps_n = gst_value_get_fraction_numerator (value);
+      self->max_fps_d = gst_value_get_fraction_denominator (value);
+      GST_OBJECT_UNLOCK (self);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+}
+
+static void
+fs_videoanyrate_get_property (GObject *object,
+    guint prop_id,
+    GValue *value,
+    GParamSpec *pspec)
+{
+  FsVideoanyrate *self = FS_VIDEOANYRATE (object);
+
+  switch (prop_id)
+  {
+    case ARG_MAX_FRAMERATE:
+      GST_OBJECT_LOCK (self);
+      gst_value_set_fraction (value, self->max_fps_n, self->max_fps_d);
+      GST_OBJECT_UNLOCK (self);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
 }
 
 static GstCaps *
@@ -185,6 +287,153 @@ fs_videoanyrate_fixate_caps (GstBaseTransform * base,
   return gst_caps_fixate (othercaps);
 }
 
+static gboolean
+fs_videoanyrate_set_caps (GstBaseTransform *trans, GstCaps *incaps,
+    GstCaps *outcaps)
+{
+  FsVideoanyrate *self = FS_VIDEOANYRATE (trans);
+  GstStructure *s = gst_caps_get_structure (incaps, 0);
+
+  /* Only raw frames can be dropped, the frames after a dropped delta unit
+   * could not be decoded until the next key unit */
+  self->raw = gst_structure_has_name (s, "video/x-raw");
+
+  return TRUE;
+}
+
+static gboolean
+fs_videoanyrate_start (GstBaseTransform *trans)
+{
+  FsVideoanyrate *self = FS_VIDEOANYRATE (trans);
+
+  self->next_ts = GST_CLOCK_TIME_NONE;
+
+  GST_OBJECT_LOCK (self);
+  self->keyframe_requested = FALSE;
+  GST_OBJECT_UNLOCK (self);
+
+  return TRUE;
+}
+
+static gboolean
+fs_videoanyrate_sink_event (GstBaseTransform *trans, GstEvent *event)
+{
+  FsVideoanyrate *self = FS_VIDEOANYRATE (trans);
+
+  switch (GST_EVENT_TYPE (event))
+  {
+    case GST_EVENT_CUSTOM_DOWNSTREAM_STICKY:
+    case GST_EVENT_CUSTOM_DOWNSTREAM_OOB:
+      if (gst_event_has_name (event, FS_VIDEOANYRATE_MAX_FRAMERATE_EVENT))
+      {
+        const GstStructure *s = gst_event_get_structure (event);
+        gint fps_n, fps_d;
+
+        if (gst_structure_get_fraction (s, "framerate", &fps_n, &fps_d) &&
+            fps_n >= 0 && fps_d > 0)
+        {
+          GST_DEBUG_OBJECT (self, "Limiting the framerate to %d/%d",
+              fps_n, fps_d);
+          GST_OBJECT_LOCK (self);
+          self->event_fps_n = fps_n;
+          self->event_fps_d = fps_d;
+          GST_OBJECT_UNLOCK (self);
+        }
+      }
+      break;
+    case GST_EVENT_FLUSH_STOP:
+    case GST_EVENT_SEGMENT:
+      self->next_ts = GST_CLOCK_TIME_NONE;
+      break;
+    default:
+      break;
+  }
+
+  return GST_BASE_TRANSFORM_CLASS (fs_videoanyrate_parent_class)->sink_event (
+      trans, event);
+}
+
+static gboolean
+fs_videoanyrate_src_event (GstBaseTransform *trans, GstEvent *event)
+{
+  FsVideoanyrate *self = FS_VIDEOANYRATE (trans);
+
+  if (GST_EVENT_TYPE (event) == GST_EVENT_CUSTOM_UPSTREAM &&
+      gst_event_has_name (event, "GstForceKeyUnit"))
+  {
+    GST_OBJECT_LOCK (self);
+    self->keyframe_requested = TRUE;
+    GST_OBJECT_UNLOCK (self);
+  }
+
+  return GST_BASE_TRANSFORM_CLASS (fs_videoanyrate_parent_class)->src_event (
+      trans, event);
+}
+
+/* Returns the lowest of the two limits, 0 if there are none */
+static GstClockTime
+fs_videoanyrate_get_min_interval_locked (FsVideoanyrate *self)
+{
+  gint fps_n = self->max_fps_n;
+  gint fps_d = self->max_fps_d;
+
+  if (self->event_fps_n > 0 && (fps_n == 0 ||
+          (gint64) self->event_fps_n * fps_d <
+          (gint64) fps_n * self->event_fps_d))
+  {
+    fps_n = self->event_fps_n;
+    fps_d = self->event_fps_d;
+  }
+
+  if (fps_n == 0)
+    return 0;
+
+  return gst_util_uint64_scale_int (GST_SECOND, fps_d, fps_n);
+}
+
+static GstFlowReturn
+fs_videoanyrate_transform_ip (GstBaseTransform *trans, GstBuffer *buf)
+{
+  FsVideoanyrate *self = FS_VIDEOANYRATE (trans);
+  GstClockTime ts = GST_BUFFER_PTS (buf);
+  GstClockTime interval;
+  gboolean keyframe;
+  gboolean early;
+
+  if (!self->raw)
+    return GST_FLOW_OK;
+
+  GST_OBJECT_LOCK (self);
+  interval = fs_videoanyrate_get_min_interval_locked (self);
+  keyframe = self->keyframe_requested;
+  self->keyframe_requested = FALSE;
+  GST_OBJECT_UNLOCK (self);
+
+  if (interval == 0 || !GST_CLOCK_TIME_IS_VALID (ts))
+    return GST_FLOW_OK;
+
+  /* Allow for a bit of jitter on the incoming timestamps */
+  early = GST_CLOCK_TIME_IS_VALID (self->next_ts) &&
+      ts + interval / 8 < self->next_ts;
+
+  if (early && !keyframe)
+  {
+    GST_LOG_OBJECT (self, "Dropping frame with ts %" GST_TIME_FORMAT,
+        GST_TIME_ARGS (ts));
+    return GST_BASE_TRANSFORM_FLOW_DROPPED;
+  }
+
+  /* Advance by whole intervals to keep a regular cadence, but start again
+   * from this frame after a gap or an early key unit */
+  if (early || !GST_CLOCK_TIME_IS_VALID (self->next_ts) ||
+      ts >= self->next_ts + interval)
+    self->next_ts = ts + interval;
+  else
+    self->next_ts += interval;
+
+  return GST_FLOW_OK;
+}
+
 gboolean
 fs_videoanyrate_plugin_init (GstPlugin *plugin)
 {
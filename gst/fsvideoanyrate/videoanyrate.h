@@ -45,9 +45,27 @@ G_BEGIN_DECLS
 typedef struct _FsVideoanyrate FsVideoanyrate;
 typedef struct _FsVideoanyrateClass FsVideoanyrateClass;
 
+/**
+ * FS_VIDEOANYRATE_MAX_FRAMERATE_EVENT:
+ *
+ * Name of the structure of the custom downstream sticky or out-of-band event
+ * that limits the framerate, it has a "framerate" field of type
+ * %GST_TYPE_FRACTION, 0/1 removes the limit.
+ */
+#define FS_VIDEOANYRATE_MAX_FRAMERATE_EVENT "farstream-max-framerate"
+
 struct _FsVideoanyrate
 {
   GstBaseTransform parent;
+
+  /* Protected by the object lock */
+  gint max_fps_n, max_fps_d;
+  gint event_fps_n, event_fps_d;
+  gboolean keyframe_requested;
+
+  /* Only used from the streaming thread */
+  gboolean raw;
+  GstClockTime next_ts;
 };
 
 struct _FsVideoanyrateClass
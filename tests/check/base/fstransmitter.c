@@ -23,6 +23,10 @@
 # include <config.h>
 #endif
 
+#include <string.h>
+#include <unistd.h>
+
+#include <glib/gstdio.h>
 #include <gst/check/gstcheck.h>
 #include <farstream/fs-transmitter.h>
 #include <farstream/fs-conference.h>
@@ -44,6 +48,211 @@ GST_START_TEST (test_fstransmitter_new_fail)
 }
 GST_END_TEST;
 
+static gchar *index_dir = NULL;
+static gchar *orig_index_path = NULL;
+
+static gchar *
+index_path_new (const gchar *name)
+{
+  return g_build_filename (index_dir, name, NULL);
+}
+
+static void
+index_setup (void)
+{
+  gchar *index_path;
+
+  /* Never touch the index in the user's cache, even when run by hand */
+  index_dir = g_dir_make_tmp ("fs-plugin-index-XXXXXX", NULL);
+  fail_unless (index_dir != NULL);
+
+  orig_index_path = g_strdup (g_getenv ("FS_PLUGIN_INDEX"));
+  index_path = index_path_new ("default");
+  g_setenv ("FS_PLUGIN_INDEX", index_path, TRUE);
+  g_free (index_path);
+}
+
+static void
+index_teardown (void)
+{
+  GDir *dir = g_dir_open (index_dir, 0, NULL);
+  const gchar *entry;
+
+  while (dir && (entry = g_dir_read_name (dir)))
+  {
+    gchar *path = index_path_new (entry);
+    g_unlink (path);
+    g_free (path);
+  }
+  if (dir)
+    g_dir_close (dir);
+  g_rmdir (index_dir);
+  g_free (index_dir);
+  index_dir = NULL;
+
+  if (orig_index_path)
+    g_setenv ("FS_PLUGIN_INDEX", orig_index_path, TRUE);
+  else
+    g_unsetenv ("FS_PLUGIN_INDEX");
+  g_free (orig_index_path);
+  orig_index_path = NULL;
+}
+
+GST_START_TEST (test_fstransmitter_list_index)
+{
+  gchar *index_path;
+  gchar *other_index_path;
+  gchar **first;
+  gchar **second;
+  guint i;
+
+  index_path = index_path_new ("list");
+  g_setenv ("FS_PLUGIN_INDEX", index_path, TRUE);
+
+  first = fs_transmitter_list_available ();
+  fail_unless (first != NULL, "No transmitter found");
+  fail_unless (g_file_test (index_path, G_FILE_TEST_EXISTS),
+      "The plugin index was not saved");
+
+  /* The second listing comes from the index */
+  second = fs_transmitter_list_available ();
+  fail_unless (second != NULL);
+  fail_unless (g_strv_length (first) == g_strv_length (second));
+  for (i = 0; first[i]; i++)
+    fail_unless (!strcmp (first[i], second[i]));
+  g_strfreev (second);
+
+  /* Moving the index makes it start over at the new location */
+  other_index_path = index_path_new ("other");
+  g_setenv ("FS_PLUGIN_INDEX", other_index_path, TRUE);
+
+  second = fs_transmitter_list_available ();
+  fail_unless (second != NULL);
+  fail_unless (g_strv_length (first) == g_strv_length (second));
+  fail_unless (g_file_test (other_index_path, G_FILE_TEST_EXISTS),
+      "The plugin index was not saved at its new location");
+
+  g_strfreev (first);
+  g_strfreev (second);
+  g_free (index_path);
+  g_free (other_index_path);
+}
+GST_END_TEST;
+
+/*
+ * Builds an index from the current plugin directories and saves a modified
+ * copy of it under @name. Each directory keeps its real mtime, so that the
+ * copy is trusted, and its transmitter list is replaced by @transmitters.
+ */
+static gchar *
+write_modified_index (const gchar *name, const gchar * const *transmitters)
+{
+  gchar *source_path = index_path_new ("source");
+  gchar *index_path = index_path_new (name);
+  GKeyFile *keyfile = g_key_file_new ();
+  gchar **groups;
+  gchar **list;
+  gchar *data;
+  gsize length;
+  guint i;
+
+  g_setenv ("FS_PLUGIN_INDEX", source_path, TRUE);
+  list = fs_transmitter_list_available ();
+  fail_unless (list != NULL, "No transmitter found");
+  g_strfreev (list);
+
+  fail_unless (g_key_file_load_from_file (keyfile, source_path,
+          G_KEY_FILE_NONE, NULL));
+  groups = g_key_file_get_groups (keyfile, NULL);
+  fail_unless (groups[0] != NULL, "The index has no directory");
+
+  for (i = 0; groups[i]; i++)
+  {
+    GStatBuf statbuf;
+
+    fail_unless (g_stat (groups[i], &statbuf) == 0);
+    g_key_file_set_int64 (keyfile, groups[i], "mtime", statbuf.st_mtime);
+    if (transmitters)
+      g_key_file_set_string_list (keyfile, groups[i], "transmitter",
+          transmitters, g_strv_length ((gchar **) transmitters));
+    else
+      g_key_file_remove_key (keyfile, groups[i], "transmitter", NULL);
+  }
+  g_strfreev (groups);
+
+  data = g_key_file_to_data (keyfile, &length, NULL);
+  fail_unless (g_file_set_contents (index_path, data, length, NULL));
+  g_free (data);
+  g_key_file_free (keyfile);
+  g_free (source_path);
+
+  return index_path;
+}
+
+GST_START_TEST (test_fstransmitter_index_hit)
+{
+  const gchar * const indexed[] = {"indexonly", NULL};
+  gchar *index_path;
+  gchar **list;
+
+  index_path = write_modified_index ("hit", indexed);
+  g_setenv ("FS_PLUGIN_INDEX", index_path, TRUE);
+
+  /* The directories are not scanned again, so only the indexed name is
+   * listed */
+  list = fs_transmitter_list_available ();
+  fail_unless (list != NULL);
+  fail_unless (g_strv_length (list) == 1 && !strcmp (list[0], "indexonly"),
+      "The listing did not come from the index");
+
+  g_strfreev (list);
+  g_free (index_path);
+}
+GST_END_TEST;
+
+GST_START_TEST (test_fstransmitter_index_miss)
+{
+  GError *error = NULL;
+  FsTransmitter *transmitter;
+  GKeyFile *keyfile;
+  gchar **groups;
+  gboolean indexed = FALSE;
+  gchar *index_path;
+  guint i;
+
+  index_path = write_modified_index ("miss", NULL);
+  g_setenv ("FS_PLUGIN_INDEX", index_path, TRUE);
+
+  /* The index does not know about rawudp, it must still be found */
+  transmitter = fs_transmitter_new ("rawudp", 1, 0, &error);
+  fail_unless (transmitter != NULL, "Could not load rawudp: %s",
+      error ? error->message : "unknown error");
+  g_object_unref (transmitter);
+
+  /* And the index must have been corrected */
+  keyfile = g_key_file_new ();
+  fail_unless (g_key_file_load_from_file (keyfile, index_path,
+          G_KEY_FILE_NONE, NULL));
+  groups = g_key_file_get_groups (keyfile, NULL);
+  for (i = 0; groups[i]; i++)
+  {
+    gchar **names = g_key_file_get_string_list (keyfile, groups[i],
+        "transmitter", NULL, NULL);
+    guint j;
+
+    for (j = 0; names && names[j]; j++)
+      if (!strcmp (names[j], "rawudp"))
+        indexed = TRUE;
+    g_strfreev (names);
+  }
+  fail_unless (indexed, "rawudp was not added back to the index");
+
+  g_strfreev (groups);
+  g_key_file_free (keyfile);
+  g_free (index_path);
+}
+GST_END_TEST;
+
 
 static Suite *
 fstransmitter_suite (void)
@@ -51,9 +260,14 @@ fstransmitter_suite (void)
   Suite *s = suite_create ("fstransmitter");
   TCase *tc_chain = tcase_create ("fstransmitter");
 
+  tcase_add_unchecked_fixture (tc_chain, index_setup, index_teardown);
+
   suite_add_tcase (s, tc_chain);
 
   tcase_add_test (tc_chain, test_fstransmitter_new_fail);
+  tcase_add_test (tc_chain, test_fstransmitter_list_index);
+  tcase_add_test (tc_chain, test_fstransmitter_index_hit);
+  tcase_add_test (tc_chain, test_fstransmitter_index_miss);
 
   return s;
 }
@@ -0,0 +1,197 @@
+/* Farstream unit tests for the bitrate adapter and fsvideoanyrate
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <gst/check/gstcheck.h>
+
+#include "fs-rtp-bitrate-adapter.h"
+#include "videoanyrate.h"
+
+#include "check-threadsafe.h"
+
+#define WIDTH 320
+#define HEIGHT 240
+
+/* H.264 gets 25 pixels per bit, so this is 10 frames per second at 320x240 */
+#define BITRATE (WIDTH * HEIGHT * 10 / 25)
+
+static GstStaticPadTemplate srctemplate = GST_STATIC_PAD_TEMPLATE ("src",
+    GST_PAD_SRC,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS_ANY);
+
+static GstStaticPadTemplate sinktemplate = GST_STATIC_PAD_TEMPLATE ("sink",
+    GST_PAD_SINK,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS_ANY);
+
+static void
+push_events (GstPad *srcpad, const gchar *media_type)
+{
+  GstCaps *caps;
+  GstSegment segment;
+
+  ts_fail_unless (gst_pad_push_event (srcpad,
+          gst_event_new_stream_start ("test")));
+
+  caps = gst_caps_new_simple (media_type,
+      "width", G_TYPE_INT, WIDTH,
+      "height", G_TYPE_INT, HEIGHT,
+      "framerate", GST_TYPE_FRACTION, 30, 1,
+      NULL);
+  ts_fail_unless (gst_pad_push_event (srcpad, gst_event_new_caps (caps)));
+  gst_caps_unref (caps);
+
+  gst_segment_init (&segment, GST_FORMAT_TIME);
+  ts_fail_unless (gst_pad_push_event (srcpad,
+          gst_event_new_segment (&segment)));
+}
+
+/* Pushes one second of video at 30 frames per second */
+static void
+push_frames (GstPad *srcpad, gboolean delta_units)
+{
+  guint i;
+
+  for (i = 0; i < 30; i++)
+  {
+    GstBuffer *buf = gst_buffer_new_and_alloc (16);
+
+    GST_BUFFER_PTS (buf) = i * GST_SECOND / 30;
+    GST_BUFFER_DURATION (buf) = GST_SECOND / 30;
+    if (delta_units && i > 0)
+      GST_BUFFER_FLAG_SET (buf, GST_BUFFER_FLAG_DELTA_UNIT);
+
+    ts_fail_unless (gst_pad_push (srcpad, buf) == GST_FLOW_OK);
+  }
+}
+
+GST_START_TEST (test_bitrate_adapter_max_framerate)
+{
+  GstElement *adapter, *anyrate;
+  GstPad *srcpad, *sinkpad, *anyrate_sinkpad;
+  GstEvent *event;
+  const GstStructure *s;
+  gint fps_n, fps_d;
+
+  adapter = fs_rtp_bitrate_adapter_new ();
+  anyrate = gst_element_factory_make ("fsvideoanyrate", NULL);
+  ts_fail_unless (anyrate != NULL, "Could not create fsvideoanyrate");
+  ts_fail_unless (gst_element_link (adapter, anyrate));
+
+  srcpad = gst_check_setup_src_pad (adapter, &srctemplate);
+  sinkpad = gst_check_setup_sink_pad (anyrate, &sinktemplate);
+  gst_pad_set_active (srcpad, TRUE);
+  gst_pad_set_active (sinkpad, TRUE);
+
+  ts_fail_unless (gst_element_set_state (anyrate, GST_STATE_PLAYING) ==
+      GST_STATE_CHANGE_SUCCESS);
+  ts_fail_unless (gst_element_set_state (adapter, GST_STATE_PLAYING) ==
+      GST_STATE_CHANGE_SUCCESS);
+
+  push_events (srcpad, "video/x-raw");
+
+  /* The limit is only sent with the next buffer */
+  g_object_set (adapter, "bitrate", BITRATE, NULL);
+
+  push_frames (srcpad, FALSE);
+
+  anyrate_sinkpad = gst_element_get_static_pad (anyrate, "sink");
+  event = gst_pad_get_sticky_event (anyrate_sinkpad,
+      GST_EVENT_CUSTOM_DOWNSTREAM_STICKY, 0);
+  gst_object_unref (anyrate_sinkpad);
+
+  ts_fail_unless (event != NULL, "The framerate event did not reach"
+      " fsvideoanyrate");
+  ts_fail_unless (gst_event_has_name (event,
+          FS_VIDEOANYRATE_MAX_FRAMERATE_EVENT));
+  s = gst_event_get_structure (event);
+  ts_fail_unless (gst_structure_get_fraction (s, "framerate", &fps_n, &fps_d));
+  ts_fail_unless (fps_n == 10 && fps_d == 1, "Got a limit of %d/%d"
+      " instead of 10/1", fps_n, fps_d);
+  gst_event_unref (event);
+
+  /* Every third frame is kept */
+  ts_fail_unless (g_list_length (buffers) == 10, "Got %u frames instead of 10",
+      g_list_length (buffers));
+
+  gst_check_drop_buffers ();
+
+  gst_element_set_state (adapter, GST_STATE_NULL);
+  gst_element_set_state (anyrate, GST_STATE_NULL);
+  gst_check_teardown_src_pad (adapter);
+  gst_check_teardown_sink_pad (anyrate);
+  gst_object_unref (adapter);
+  gst_object_unref (anyrate);
+}
+GST_END_TEST;
+
+GST_START_TEST (test_videoanyrate_encoded_not_dropped)
+{
+  GstElement *anyrate;
+  GstPad *srcpad, *sinkpad;
+
+  anyrate = gst_check_setup_element ("fsvideoanyrate");
+  g_object_set (anyrate, "max-framerate", 10, 1, NULL);
+
+  srcpad = gst_check_setup_src_pad (anyrate, &srctemplate);
+  sinkpad = gst_check_setup_sink_pad (anyrate, &sinktemplate);
+  gst_pad_set_active (srcpad, TRUE);
+  gst_pad_set_active (sinkpad, TRUE);
+
+  ts_fail_unless (gst_element_set_state (anyrate, GST_STATE_PLAYING) ==
+      GST_STATE_CHANGE_SUCCESS);
+
+  push_events (srcpad, "video/x-h264");
+
+  /* Dropping any delta unit would break the decoding of the ones after it */
+  push_frames (srcpad, TRUE);
+
+  ts_fail_unless (g_list_length (buffers) == 30, "Got %u frames instead of 30",
+      g_list_length (buffers));
+
+  gst_check_drop_buffers ();
+
+  gst_element_set_state (anyrate, GST_STATE_NULL);
+  gst_check_teardown_src_pad (anyrate);
+  gst_check_teardown_sink_pad (anyrate);
+  gst_check_teardown_element (anyrate);
+}
+GST_END_TEST;
+
+static Suite *
+fsrtpbitrateadapter_suite (void)
+{
+  Suite *s = suite_create ("fsrtpbitrateadapter");
+  TCase *tc_chain;
+
+  tc_chain = tcase_create ("fsrtpbitrateadapter_max_framerate");
+  tcase_add_test (tc_chain, test_bitrate_adapter_max_framerate);
+  suite_add_tcase (s, tc_chain);
+
+  tc_chain = tcase_create ("fsvideoanyrate_encoded");
+  tcase_add_test (tc_chain, test_videoanyrate_encoded_not_dropped);
+  suite_add_tcase (s, tc_chain);
+
+  return s;
+}
+
+GST_CHECK_MAIN (fsrtpbitrateadapter);
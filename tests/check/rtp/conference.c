@@ -86,6 +86,10 @@ GST_START_TEST (test_rtpconference_new)
           "bob@127.0.0.1"), "Conference CNAME is wrong");
   gst_structure_free (s);
 
+  g_object_get (dat->conference, "pending-teardowns", &id, NULL);
+  ts_fail_unless (id == 0, "New conference has %u pending teardowns", id);
+  id = 999;
+
   g_object_get (st->participant, "cname", &str, NULL);
   ts_fail_unless (str == NULL);
 
@@ -929,6 +933,184 @@ GST_START_TEST (test_rtpconference_errors)
 GST_END_TEST;
 
 
+GST_START_TEST (test_rtpconference_remote_candidates_done)
+{
+  struct SimpleTestConference *dat = NULL;
+  FsParticipant *participant = NULL;
+  FsStream *stream = NULL;
+  GError *error = NULL;
+  gboolean done = TRUE;
+
+  dat = setup_simple_conference (1, "fsrtpconference", "bob@127.0.0.1");
+
+  participant = fs_conference_new_participant (FS_CONFERENCE (dat->conference),
+      NULL);
+  ts_fail_if (participant == NULL, "Could not create participant");
+
+  stream = fs_session_new_stream (dat->session, participant, FS_DIRECTION_NONE,
+      &error);
+  ts_fail_unless (stream != NULL);
+
+  /* Set before the transmitter exists, it must be passed on to it */
+  g_object_set (stream, "remote-candidates-done", TRUE, NULL);
+
+  if (!fs_stream_set_transmitter (stream, "nice", NULL, 0, &error))
+    ts_fail ("Could not set the nice transmitter: %s", error->message);
+
+  g_object_get (stream, "remote-candidates-done", &done, NULL);
+  ts_fail_unless (done == TRUE, "The flag was not passed to the transmitter");
+
+  g_object_set (stream, "remote-candidates-done", FALSE, NULL);
+  g_object_get (stream, "remote-candidates-done", &done, NULL);
+  ts_fail_unless (done == FALSE, "The flag could not be cleared");
+
+  fs_stream_destroy (stream);
+  g_object_unref (stream);
+  g_object_unref (participant);
+
+  cleanup_simple_conference (dat);
+}
+GST_END_TEST;
+
+
+static gint batched_candidates = 0;
+static gint announced_candidates = 0;
+
+static GstBusSyncReply
+candidate_batches_sync_handler (GstBus *bus, GstMessage *message,
+    gpointer data)
+{
+  FsStream *stream = data;
+  GList *candidates = NULL;
+
+  if (fs_stream_parse_new_local_candidates (stream, message, &candidates))
+  {
+    ts_fail_if (candidates == NULL, "Got an empty batch of candidates");
+    ts_fail_unless (announced_candidates == 0,
+        "Got a new batch before all the candidates of the previous one");
+    announced_candidates = g_list_length (candidates);
+    batched_candidates += announced_candidates;
+  }
+  else if (fs_stream_parse_new_local_candidate (stream, message, NULL))
+  {
+    ts_fail_unless (announced_candidates > 0,
+        "Got a candidate that was not part of a batch");
+    announced_candidates--;
+  }
+  else if (fs_stream_parse_local_candidates_prepared (stream, message))
+  {
+    g_main_loop_quit (loop);
+  }
+
+  return GST_BUS_PASS;
+}
+
+GST_START_TEST (test_rtpconference_nice_candidate_batches)
+{
+  struct SimpleTestConference *dat = NULL;
+  FsParticipant *participant = NULL;
+  FsStream *stream = NULL;
+  GError *error = NULL;
+  GstBus *bus;
+
+  batched_candidates = 0;
+  announced_candidates = 0;
+  loop = g_main_loop_new (NULL, FALSE);
+
+  dat = setup_simple_conference (1, "fsrtpconference", "bob@127.0.0.1");
+
+  participant = fs_conference_new_participant (FS_CONFERENCE (dat->conference),
+      NULL);
+  ts_fail_if (participant == NULL, "Could not create participant");
+
+  stream = fs_session_new_stream (dat->session, participant, FS_DIRECTION_NONE,
+      &error);
+  ts_fail_unless (stream != NULL);
+
+  bus = gst_pipeline_get_bus (GST_PIPELINE (dat->pipeline));
+  gst_bus_set_sync_handler (bus, candidate_batches_sync_handler, stream, NULL);
+
+  if (!fs_stream_set_transmitter (stream, "nice", NULL, 0, &error))
+    ts_fail ("Could not set the nice transmitter: %s", error->message);
+
+  g_main_loop_run (loop);
+
+  gst_bus_set_sync_handler (bus, NULL, NULL, NULL);
+  gst_object_unref (bus);
+
+  ts_fail_unless (batched_candidates > 0,
+      "The batches of local candidates were not forwarded");
+  ts_fail_unless (announced_candidates == 0,
+      "%d candidates of the last batch were not signalled",
+      announced_candidates);
+
+  fs_stream_destroy (stream);
+  g_object_unref (stream);
+  g_object_unref (participant);
+
+  cleanup_simple_conference (dat);
+  g_main_loop_unref (loop);
+}
+GST_END_TEST;
+
+
+GST_START_TEST (test_rtpconference_new_streams)
+{
+  struct SimpleTestConference *dat = NULL;
+  GList *participants = NULL;
+  GList *remote_codecs = NULL;
+  GList *streams = NULL;
+  GList *codecs = NULL;
+  GList *item;
+  GError *error = NULL;
+  gint i;
+
+  dat = setup_simple_conference (1, "fsrtpconference", "bob@127.0.0.1");
+
+  g_object_get (dat->session, "codecs", &codecs, NULL);
+  ts_fail_if (codecs == NULL, "Codecs should not be NULL");
+
+  for (i = 0; i < 5; i++)
+  {
+    FsParticipant *participant = fs_conference_new_participant (
+        FS_CONFERENCE (dat->conference), NULL);
+    ts_fail_if (participant == NULL, "Could not create participant");
+
+    participants = g_list_append (participants, participant);
+    remote_codecs = g_list_append (remote_codecs, codecs);
+  }
+
+  streams = fs_session_new_streams (dat->session, participants,
+      FS_DIRECTION_BOTH, remote_codecs, &error);
+  if (error)
+    ts_fail ("Error while creating new streams (%d): %s",
+        error->code, error->message);
+  ts_fail_unless (g_list_length (streams) == 5,
+      "Should have created 5 streams, not %u", g_list_length (streams));
+
+  for (item = streams; item; item = g_list_next (item))
+  {
+    GList *stream_codecs = NULL;
+
+    g_object_get (item->data, "remote-codecs", &stream_codecs, NULL);
+    ts_fail_unless (fs_codec_list_are_equal (stream_codecs, codecs),
+        "Remote codecs were not set on the stream");
+    fs_codec_list_destroy (stream_codecs);
+
+    fs_stream_destroy (item->data);
+    g_object_unref (item->data);
+  }
+  g_list_free (streams);
+
+  g_list_free (remote_codecs);
+  fs_codec_list_destroy (codecs);
+  g_list_free_full (participants, g_object_unref);
+
+  cleanup_simple_conference (dat);
+}
+GST_END_TEST;
+
+
 GST_START_TEST (test_rtpconference_select_send_codec)
 {
   select_last_codec = TRUE;
@@ -1522,6 +1704,18 @@ fsrtpconference_suite (void)
   tcase_add_test (tc_chain, test_rtpconference_errors);
   suite_add_tcase (s, tc_chain);
 
+  tc_chain = tcase_create ("fsrtpconference_nice_candidate_batches");
+  tcase_add_test (tc_chain, test_rtpconference_nice_candidate_batches);
+  suite_add_tcase (s, tc_chain);
+
+  tc_chain = tcase_create ("fsrtpconference_remote_candidates_done");
+  tcase_add_test (tc_chain, test_rtpconference_remote_candidates_done);
+  suite_add_tcase (s, tc_chain);
+
+  tc_chain = tcase_create ("fsrtpconference_new_streams");
+  tcase_add_test (tc_chain, test_rtpconference_new_streams);
+  suite_add_tcase (s, tc_chain);
+
   tc_chain = tcase_create ("fsrtpconference_select_send_codec");
   tcase_add_test (tc_chain, test_rtpconference_select_send_codec);
   suite_add_tcase (s, tc_chain);
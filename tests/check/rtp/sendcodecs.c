@@ -39,6 +39,7 @@ gboolean received = FALSE;
 gboolean ready_to_send = FALSE;
 gboolean change_codec = FALSE;
 gboolean filter_telephone_event = FALSE;
+gboolean changing_dtmf_pt = FALSE;
 
 struct SimpleTestConference *dat = NULL;
 FsStream *stream = NULL;
@@ -126,12 +127,17 @@ _bus_callback (GstBus *bus, GstMessage *message, gpointer user_data)
               if (codec->clock_rate == 8000 &&
                   !g_ascii_strcasecmp ("telephone-event", codec->encoding_name))
               {
-                ts_fail_unless (codec->id == dtmf_id);
-                ready_to_send = TRUE;
+                /* Messages from the previous payload type may still be
+                 * queued when it changes quickly */
+                if (!changing_dtmf_pt)
+                  ts_fail_unless (codec->id == dtmf_id);
+                if (codec->id == dtmf_id)
+                  ready_to_send = TRUE;
               }
             }
 
-            fail_unless (ready_to_send == TRUE);
+            if (!changing_dtmf_pt)
+              fail_unless (ready_to_send == TRUE);
           }
 
           fs_codec_list_destroy (secondary_codec_list);
@@ -516,6 +522,80 @@ GST_START_TEST (test_senddtmf_change_auto)
 }
 GST_END_TEST;
 
+#define DTMF_PT_CHANGES 5
+
+guint dtmf_pt_changes = 0;
+volatile gint saw_pending_teardowns = FALSE;
+
+static void
+_pending_teardowns_notify (GObject *object, GParamSpec *pspec,
+    gpointer user_data)
+{
+  guint pending;
+
+  g_object_get (object, "pending-teardowns", &pending, NULL);
+  if (pending > 0)
+    g_atomic_int_set (&saw_pending_teardowns, TRUE);
+}
+
+static gboolean
+change_dtmf_pt (gpointer data)
+{
+  GstState state;
+  GstStateChangeReturn ret;
+  guint pending;
+
+  if (!dat || !dat->pipeline || !dat->session)
+    return TRUE;
+
+  ret = gst_element_get_state (dat->pipeline, &state, NULL, 0);
+  ts_fail_if (ret == GST_STATE_CHANGE_FAILURE);
+
+  if (ret != GST_STATE_CHANGE_SUCCESS || state != GST_STATE_PLAYING)
+    return TRUE;
+
+  if (!ready_to_send)
+    return TRUE;
+
+  /* Every new telephone-event payload type stops the previous DTMF source */
+  if (dtmf_pt_changes < DTMF_PT_CHANGES)
+  {
+    if (dtmf_pt_changes == 0)
+      g_signal_connect (dat->conference, "notify::pending-teardowns",
+          G_CALLBACK (_pending_teardowns_notify), NULL);
+    dtmf_pt_changes++;
+    dtmf_id++;
+    ready_to_send = FALSE;
+    set_codecs (dat, stream);
+    return TRUE;
+  }
+
+  g_object_get (dat->conference, "pending-teardowns", &pending, NULL);
+  if (pending > 0)
+    return TRUE;
+
+  ts_fail_unless (g_atomic_int_get (&saw_pending_teardowns),
+      "The DTMF sources were never torn down");
+
+  g_main_loop_quit (loop);
+  return FALSE;
+}
+
+GST_START_TEST (test_senddtmf_teardowns)
+{
+  gint port;
+  GstElement *recv_pipeline = build_recv_pipeline (
+      send_dmtf_buffer_handler, NULL, &port);
+
+  dtmf_pt_changes = 0;
+  saw_pending_teardowns = FALSE;
+  changing_dtmf_pt = TRUE;
+  g_timeout_add (100, change_dtmf_pt, NULL);
+  one_way (recv_pipeline, port);
+  changing_dtmf_pt = FALSE;
+}
+GST_END_TEST;
+
 gboolean checked = FALSE;
 
 static GstPadProbeReturn
@@ -598,6 +678,10 @@ fsrtpsendcodecs_suite (void)
   tcase_add_test (tc_chain, test_senddtmf_change_auto);
   //suite_add_tcase (s, tc_chain);
 
+  tc_chain = tcase_create ("fsrtpsenddtmf_teardowns");
+  tcase_add_test (tc_chain, test_senddtmf_teardowns);
+  suite_add_tcase (s, tc_chain);
+
   tc_chain = tcase_create ("fsrtpchangessrc");
   tcase_add_test (tc_chain, test_change_ssrc);
   suite_add_tcase (s, tc_chain);
@@ -0,0 +1,186 @@
+/* Farstream unit tests for the x-data RTP payloader
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <gst/check/gstcheck.h>
+#include <gst/check/gsttestclock.h>
+#include <gst/rtp/gstrtpbuffer.h>
+
+#include "check-threadsafe.h"
+
+#define MIN_PTIME (100 * GST_MSECOND)
+
+static GstStaticPadTemplate srctemplate = GST_STATIC_PAD_TEMPLATE ("src",
+    GST_PAD_SRC,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS ("application/octet-stream"));
+
+static GstStaticPadTemplate sinktemplate = GST_STATIC_PAD_TEMPLATE ("sink",
+    GST_PAD_SINK,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS ("application/x-rtp"));
+
+static GstElement *pay;
+static GstPad *srcpad, *sinkpad;
+
+static void
+setup_xdatapay (GstClock *clock)
+{
+  GstCaps *caps;
+  GstSegment segment;
+
+  pay = gst_check_setup_element ("fsrtpxdatapay");
+  g_object_set (pay, "min-ptime", MIN_PTIME, NULL);
+
+  if (clock)
+  {
+    gst_element_set_clock (pay, clock);
+    gst_element_set_base_time (pay, 0);
+  }
+
+  srcpad = gst_check_setup_src_pad (pay, &srctemplate);
+  sinkpad = gst_check_setup_sink_pad (pay, &sinktemplate);
+  gst_pad_set_active (srcpad, TRUE);
+  gst_pad_set_active (sinkpad, TRUE);
+
+  ts_fail_unless (gst_element_set_state (pay, GST_STATE_PLAYING) ==
+      GST_STATE_CHANGE_SUCCESS);
+
+  ts_fail_unless (gst_pad_push_event (srcpad,
+          gst_event_new_stream_start ("test")));
+  caps = gst_caps_new_empty_simple ("application/octet-stream");
+  ts_fail_unless (gst_pad_push_event (srcpad, gst_event_new_caps (caps)));
+  gst_caps_unref (caps);
+  gst_segment_init (&segment, GST_FORMAT_TIME);
+  ts_fail_unless (gst_pad_push_event (srcpad,
+          gst_event_new_segment (&segment)));
+}
+
+static void
+teardown_xdatapay (void)
+{
+  gst_check_drop_buffers ();
+
+  gst_element_set_state (pay, GST_STATE_NULL);
+  gst_check_teardown_src_pad (pay);
+  gst_check_teardown_sink_pad (pay);
+  gst_check_teardown_element (pay);
+  pay = NULL;
+}
+
+/* Pushes a 10 byte message lasting 20ms */
+static void
+push_message (guint i)
+{
+  GstBuffer *buf = gst_buffer_new_allocate (NULL, 10, NULL);
+
+  gst_buffer_memset (buf, 0, i, 10);
+  GST_BUFFER_PTS (buf) = i * 20 * GST_MSECOND;
+  GST_BUFFER_DURATION (buf) = 20 * GST_MSECOND;
+
+  ts_fail_unless (gst_pad_push (srcpad, buf) == GST_FLOW_OK);
+}
+
+static guint
+packet_payload_size (GstBuffer *buf)
+{
+  GstRTPBuffer rtp = GST_RTP_BUFFER_INIT;
+  guint size;
+
+  ts_fail_unless (gst_rtp_buffer_map (buf, GST_MAP_READ, &rtp));
+  size = gst_rtp_buffer_get_payload_len (&rtp);
+  gst_rtp_buffer_unmap (&rtp);
+
+  return size;
+}
+
+GST_START_TEST (test_xdatapay_aggregate)
+{
+  guint i;
+
+  setup_xdatapay (NULL);
+
+  /* 4 messages only cover 80ms, so they are kept */
+  for (i = 0; i < 4; i++)
+    push_message (i);
+  ts_fail_unless (buffers == NULL, "Sent %u packets before min-ptime",
+      g_list_length (buffers));
+
+  /* The fifth one reaches 100ms, they all go in the same packet */
+  push_message (4);
+  ts_fail_unless (g_list_length (buffers) == 1, "Sent %u packets instead of 1",
+      g_list_length (buffers));
+  ts_fail_unless (packet_payload_size (buffers->data) == 50);
+  ts_fail_unless (GST_BUFFER_PTS (buffers->data) == 0);
+
+  teardown_xdatapay ();
+}
+GST_END_TEST;
+
+GST_START_TEST (test_xdatapay_timeout)
+{
+  GstClock *clock = gst_test_clock_new ();
+  GstClockID id;
+
+  setup_xdatapay (clock);
+
+  push_message (0);
+  ts_fail_unless (buffers == NULL, "Sent a packet before min-ptime");
+
+  /* Nothing else comes, the message must go out when min-ptime is over */
+  gst_test_clock_wait_for_next_pending_id (GST_TEST_CLOCK (clock), &id);
+  ts_fail_unless (gst_clock_id_get_time (id) == MIN_PTIME,
+      "Waiting until %" GST_TIME_FORMAT " instead of %" GST_TIME_FORMAT,
+      GST_TIME_ARGS (gst_clock_id_get_time (id)), GST_TIME_ARGS (MIN_PTIME));
+  gst_clock_id_unref (id);
+
+  gst_test_clock_set_time (GST_TEST_CLOCK (clock), MIN_PTIME);
+  id = gst_test_clock_process_next_clock_id (GST_TEST_CLOCK (clock));
+  ts_fail_unless (id != NULL);
+  gst_clock_id_unref (id);
+
+  ts_fail_unless (g_list_length (buffers) == 1, "Sent %u packets instead of 1",
+      g_list_length (buffers));
+  ts_fail_unless (packet_payload_size (buffers->data) == 10);
+
+  teardown_xdatapay ();
+  gst_object_unref (clock);
+}
+GST_END_TEST;
+
+static Suite *
+fsrtpxdatapay_suite (void)
+{
+  Suite *s = suite_create ("fsrtpxdatapay");
+  TCase *tc_chain;
+
+  tc_chain = tcase_create ("fsrtpxdatapay_aggregate");
+  tcase_add_test (tc_chain, test_xdatapay_aggregate);
+  suite_add_tcase (s, tc_chain);
+
+  tc_chain = tcase_create ("fsrtpxdatapay_timeout");
+  tcase_add_test (tc_chain, test_xdatapay_timeout);
+  suite_add_tcase (s, tc_chain);
+
+  return s;
+}
+
+GST_CHECK_MAIN (fsrtpxdatapay);
@@ -22,6 +22,8 @@
 # include <config.h>
 #endif
 
+#include <string.h>
+
 #include <gst/check/gstcheck.h>
 
 #include "testutils.h"
@@ -93,3 +95,52 @@ get_fullpath (const gchar *filename)
   else
     return g_strdup (filename);
 }
+
+/*
+ * Goes through the elements of @bin (not recursively) created by the
+ * @factory_name factory, returns how many there are and a ref to the first
+ * one in @first if it is not %NULL
+ */
+static guint
+iterate_elements_by_factory (GstBin *bin, const gchar *factory_name,
+    GstElement **first)
+{
+  GstIterator *iter;
+  GValue item = G_VALUE_INIT;
+  guint count = 0;
+
+  iter = gst_bin_iterate_elements (bin);
+  while (gst_iterator_next (iter, &item) == GST_ITERATOR_OK)
+  {
+    GstElement *elem = g_value_get_object (&item);
+    GstElementFactory *factory = gst_element_get_factory (elem);
+
+    if (factory && !strcmp (GST_OBJECT_NAME (factory), factory_name))
+    {
+      if (first && count == 0)
+        *first = gst_object_ref (elem);
+      count++;
+    }
+    g_value_reset (&item);
+  }
+  g_value_unset (&item);
+  gst_iterator_free (iter);
+
+  return count;
+}
+
+guint
+count_elements_by_factory (GstBin *bin, const gchar *factory_name)
+{
+  return iterate_elements_by_factory (bin, factory_name, NULL);
+}
+
+GstElement *
+find_element_by_factory (GstBin *bin, const gchar *factory_name)
+{
+  GstElement *elem = NULL;
+
+  iterate_elements_by_factory (bin, factory_name, &elem);
+
+  return elem;
+}
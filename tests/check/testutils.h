@@ -22,6 +22,7 @@
 #define __UTILS_H__
 
 #include <glib.h>
+#include <gst/gst.h>
 
 G_BEGIN_DECLS
 
@@ -29,6 +30,10 @@ gchar *find_multicast_capable_address (void);
 
 gchar *get_fullpath (const gchar *filename);
 
+guint count_elements_by_factory (GstBin *bin, const gchar *factory_name);
+
+GstElement *find_element_by_factory (GstBin *bin, const gchar *factory_name);
+
 G_END_DECLS
 
 #endif /* __UTILS_H__ */
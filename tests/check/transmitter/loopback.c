@@ -0,0 +1,425 @@
+/* Farstream unit tests for FsLoopbackTransmitter
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+*/
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <gst/check/gstcheck.h>
+#include <farstream/fs-transmitter.h>
+#include <farstream/fs-conference.h>
+
+#include "check-threadsafe.h"
+#include "generic.h"
+
+gint buffer_count[2] = {0, 0};
+gboolean got_candidates[2];
+gboolean got_prepared[2];
+GstElement *pipeline = NULL;
+guint received_known[2] = {0, 0};
+
+GMutex test_mutex;
+GCond cond;
+gboolean done = FALSE;
+guint connected_count;
+
+
+enum {
+  FLAG_NOT_SENDING = 1 << 3,
+  FLAG_LOCAL_CANDIDATES = 1 << 5
+};
+
+GST_START_TEST (test_loopbacktransmitter_new)
+{
+  gchar **transmitters;
+  gint i;
+  gboolean found_it = FALSE;
+
+  transmitters = fs_transmitter_list_available ();
+  for (i=0; transmitters[i]; i++)
+  {
+    if (!strcmp ("loopback", transmitters[i]))
+    {
+      found_it = TRUE;
+      break;
+    }
+  }
+  g_strfreev (transmitters);
+
+  ts_fail_unless (found_it, "Did not find loopback transmitter");
+
+  test_transmitter_creation ("loopback");
+  test_transmitter_creation ("loopback");
+}
+GST_END_TEST;
+
+static void
+_new_local_candidate (FsStreamTransmitter *st, FsCandidate *candidate,
+  gpointer user_data)
+{
+  GList **local_cands = user_data;
+
+  ts_fail_if (candidate == NULL, "Passed NULL candidate");
+  ts_fail_unless (candidate->ip != NULL, "Null name in candidate");
+  ts_fail_unless (candidate->type == FS_CANDIDATE_TYPE_HOST,
+      "Candidate is not host");
+  ts_fail_unless (got_candidates[candidate->component_id-1] == FALSE);
+  got_candidates[candidate->component_id-1] = TRUE;
+
+  *local_cands = g_list_append (*local_cands, fs_candidate_copy (candidate));
+
+  GST_DEBUG ("New local candidate %s for component %d",
+      candidate->ip, candidate->component_id);
+}
+
+static void
+_candidate_prepared (FsStreamTransmitter *st,gpointer user_data)
+{
+  GST_DEBUG ("Local candidates prepared");
+
+  fail_unless (got_candidates[0] == TRUE && got_candidates[1] == TRUE);
+
+  got_prepared[0] = TRUE;
+  got_prepared[1] = TRUE;
+}
+
+static void
+_state_changed (FsStreamTransmitter *st, guint component_id,
+    FsStreamState state, gpointer user_data)
+{
+  ts_fail_unless (state == FS_STREAM_STATE_READY);
+
+  g_mutex_lock (&test_mutex);
+  connected_count++;
+  g_mutex_unlock (&test_mutex);
+  g_cond_signal (&cond);
+}
+
+static void
+_handoff_handler (GstElement *element, GstBuffer *buffer, GstPad *pad,
+  gpointer user_data)
+{
+  gint component_id = GPOINTER_TO_INT (user_data);
+
+  ts_fail_unless (gst_buffer_get_size (buffer) == component_id * 10,
+    "Buffer is size %d but component_id is %d", gst_buffer_get_size (buffer),
+    component_id);
+
+  buffer_count[component_id-1]++;
+
+  ts_fail_if (buffer_count[component_id-1] > 20,
+    "Too many buffers %d > 20 for component",
+    buffer_count[component_id-1], component_id);
+
+  if (buffer_count[0] == 20 && buffer_count[1] == 20) {
+    GST_DEBUG ("Test complete, got 20 buffers twice");
+    ts_fail_unless (buffer_count[0] == received_known[0] &&
+        buffer_count[1] == received_known[1], "Some known buffers from known"
+        " sources have not been reported (%d != %u || %d != %u)",
+        buffer_count[0], received_known[0],
+        buffer_count[1], received_known[1]);
+
+    g_mutex_lock (&test_mutex);
+    done = TRUE;
+    g_mutex_unlock (&test_mutex);
+    g_cond_signal (&cond);
+  }
+}
+
+static void
+_known_source_packet_received (FsStreamTransmitter *st, guint component_id,
+    GstBuffer *buffer, gpointer user_data)
+{
+  ts_fail_unless (component_id == 1 || component_id == 2,
+      "Invalid component id %u", component_id);
+
+  ts_fail_unless (GST_IS_BUFFER (buffer), "Invalid buffer received at %p",
+      buffer);
+
+  received_known[component_id - 1]++;
+}
+
+/* The stream sends to itself, through the name it receives on */
+
+static void
+run_loopback_transmitter_test (gint flags)
+{
+  GError *error = NULL;
+  FsTransmitter *trans;
+  FsStreamTransmitter *st;
+  GstBus *bus = NULL;
+  GParameter params[1];
+  GList *local_cands = NULL;
+  GstStateChangeReturn ret;
+  int param_count = 0;
+  gint bus_source;
+
+  done = FALSE;
+  connected_count = 0;
+  g_cond_init (&cond);
+  g_mutex_init (&test_mutex);
+
+  buffer_count[0] = 0;
+  buffer_count[1] = 0;
+  received_known[0] = 0;
+  received_known[1] = 0;
+
+  got_candidates[0] = FALSE;
+  got_candidates[1] = FALSE;
+  got_prepared[0] = FALSE;
+  got_prepared[1] = FALSE;
+
+  if (flags & FLAG_LOCAL_CANDIDATES)
+  {
+    GList *cands = NULL;
+
+    cands = g_list_append (cands, fs_candidate_new (NULL, 1,
+            FS_CANDIDATE_TYPE_HOST, FS_NETWORK_PROTOCOL_UDP, "test-rtp", 0));
+    cands = g_list_append (cands, fs_candidate_new (NULL, 2,
+            FS_CANDIDATE_TYPE_HOST, FS_NETWORK_PROTOCOL_UDP, "test-rtcp", 0));
+
+    memset (params, 0, sizeof (GParameter));
+
+    params[0].name = "preferred-local-candidates";
+    g_value_init (&params[0].value, FS_TYPE_CANDIDATE_LIST);
+    g_value_take_boxed (&params[0].value, cands);
+
+    param_count = 1;
+  }
+
+  if (flags & FLAG_NOT_SENDING)
+  {
+    buffer_count[0] = 20;
+    received_known[0] = 20;
+  }
+
+  trans = fs_transmitter_new ("loopback", 2, 0, &error);
+
+  if (error)
+    ts_fail ("Error creating transmitter: (%s:%d) %s",
+      g_quark_to_string (error->domain), error->code, error->message);
+  ts_fail_if (trans == NULL, "No transmitter create, yet error is still NULL");
+  g_clear_error (&error);
+
+  pipeline = setup_pipeline (trans, G_CALLBACK (_handoff_handler));
+
+  bus = gst_element_get_bus (pipeline);
+  bus_source = gst_bus_add_watch (bus, bus_error_callback, NULL);
+  gst_object_unref (bus);
+
+  st = fs_transmitter_new_stream_transmitter (trans, NULL,
+      param_count, params, &error);
+
+  if (param_count)
+    g_value_unset (&params[0].value);
+
+  if (error)
+    ts_fail ("Error creating stream transmitter: (%s:%d) %s",
+        g_quark_to_string (error->domain), error->code, error->message);
+  ts_fail_if (st == NULL, "No stream transmitter created, yet error is NULL");
+  g_clear_error (&error);
+
+  g_object_set (st, "sending", !(flags & FLAG_NOT_SENDING), NULL);
+
+  ts_fail_unless (g_signal_connect (st, "new-local-candidate",
+      G_CALLBACK (_new_local_candidate), &local_cands),
+    "Could not connect new-local-candidate signal");
+  ts_fail_unless (g_signal_connect (st, "local-candidates-prepared",
+      G_CALLBACK (_candidate_prepared), NULL),
+    "Could not connect local-candidates-prepared signal");
+  ts_fail_unless (g_signal_connect (st, "error",
+      G_CALLBACK (stream_transmitter_error), NULL),
+    "Could not connect error signal");
+  ts_fail_unless (g_signal_connect (st, "known-source-packet-received",
+      G_CALLBACK (_known_source_packet_received), NULL),
+    "Could not connect known-source-packet-received signal");
+  ts_fail_unless (g_signal_connect (st, "state-changed",
+      G_CALLBACK (_state_changed), NULL),
+    "Could not connect state-changed signal");
+
+  ret = gst_element_set_state (pipeline, GST_STATE_PLAYING);
+  ts_fail_if (ret == GST_STATE_CHANGE_FAILURE,
+      "Could not set the pipeline to playing");
+
+  if (!fs_stream_transmitter_gather_local_candidates (st, &error))
+    ts_fail ("Could not gather local candidates (%s:%d) %s",
+        error ? g_quark_to_string (error->domain) : "",
+        error ? error->code : 0, error ? error->message : "");
+  g_clear_error (&error);
+
+  fail_unless (got_prepared[0] == TRUE);
+  fail_unless (got_prepared[1] == TRUE);
+  ts_fail_unless (g_list_length (local_cands) == 2);
+
+  if (flags & FLAG_LOCAL_CANDIDATES)
+  {
+    FsCandidate *cand = local_cands->data;
+
+    ts_fail_unless (!strcmp (cand->ip, "test-rtp"),
+        "Preferred name %s was not used", cand->ip);
+  }
+
+  if (!fs_stream_transmitter_force_remote_candidates (st, local_cands,
+          &error))
+    ts_fail ("Error while adding candidate: (%s:%d) %s",
+        error ? g_quark_to_string (error->domain) : "",
+        error ? error->code : 0, error ? error->message : "");
+  fs_candidate_list_destroy (local_cands);
+  g_clear_error (&error);
+
+  g_mutex_lock (&test_mutex);
+  while (connected_count < 2)
+    g_cond_wait (&cond, &test_mutex);
+  g_mutex_unlock (&test_mutex);
+
+  setup_fakesrc (trans, pipeline, 1);
+  setup_fakesrc (trans, pipeline, 2);
+
+  g_mutex_lock (&test_mutex);
+  while (!done)
+    g_cond_wait (&cond, &test_mutex);
+  g_mutex_unlock (&test_mutex);
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+
+  fs_stream_transmitter_stop (st);
+  g_object_unref (st);
+
+  g_object_unref (trans);
+
+  g_source_remove (bus_source);
+  gst_object_unref (pipeline);
+
+  g_cond_clear (&cond);
+  g_mutex_clear (&test_mutex);
+}
+
+GST_START_TEST (test_loopbacktransmitter_run_basic)
+{
+  run_loopback_transmitter_test (0);
+}
+GST_END_TEST;
+
+GST_START_TEST (test_loopbacktransmitter_sending_half)
+{
+  run_loopback_transmitter_test (FLAG_NOT_SENDING);
+}
+GST_END_TEST;
+
+GST_START_TEST (test_loopbacktransmitter_local_cands)
+{
+  run_loopback_transmitter_test (FLAG_LOCAL_CANDIDATES);
+}
+GST_END_TEST;
+
+GST_START_TEST (test_loopbacktransmitter_name_in_use)
+{
+  GError *error = NULL;
+  FsTransmitter *trans[2];
+  FsStreamTransmitter *st[2];
+  GParameter params[1];
+  gint i;
+
+  memset (params, 0, sizeof (GParameter));
+  params[0].name = "preferred-local-candidates";
+  g_value_init (&params[0].value, FS_TYPE_CANDIDATE_LIST);
+  g_value_take_boxed (&params[0].value,
+      g_list_append (NULL, fs_candidate_new (NULL, 1,
+              FS_CANDIDATE_TYPE_HOST, FS_NETWORK_PROTOCOL_UDP, "in-use",
+              0)));
+
+  /* The names are shared by all of the transmitters of the process */
+  for (i = 0; i < 2; i++)
+  {
+    trans[i] = fs_transmitter_new ("loopback", 2, 0, &error);
+    if (error)
+      ts_fail ("Error creating transmitter: (%s:%d) %s",
+          g_quark_to_string (error->domain), error->code, error->message);
+
+    st[i] = fs_transmitter_new_stream_transmitter (trans[i], NULL, 1, params,
+        &error);
+    if (error)
+      ts_fail ("Error creating stream transmitter: (%s:%d) %s",
+          g_quark_to_string (error->domain), error->code, error->message);
+    ts_fail_if (st[i] == NULL, "No stream transmitter created");
+  }
+
+  g_value_unset (&params[0].value);
+
+  ts_fail_unless (fs_stream_transmitter_gather_local_candidates (st[0],
+          &error), "Could not receive on an unused name: %s",
+      error ? error->message : "");
+
+  ts_fail_if (fs_stream_transmitter_gather_local_candidates (st[1], &error),
+      "Could receive on a name that is already used");
+  ts_fail_unless (g_error_matches (error, FS_ERROR,
+          FS_ERROR_INVALID_ARGUMENTS));
+  g_clear_error (&error);
+
+  /* Once the first stream is gone, the name can be used again */
+  fs_stream_transmitter_stop (st[0]);
+  g_object_unref (st[0]);
+
+  ts_fail_unless (fs_stream_transmitter_gather_local_candidates (st[1],
+          &error), "Could not receive on a freed name: %s",
+      error ? error->message : "");
+
+  fs_stream_transmitter_stop (st[1]);
+  g_object_unref (st[1]);
+
+  for (i = 0; i < 2; i++)
+    g_object_unref (trans[i]);
+}
+GST_END_TEST;
+
+
+static Suite *
+loopbacktransmitter_suite (void)
+{
+  Suite *s = suite_create ("loopbacktransmitter");
+  TCase *tc_chain;
+  GLogLevelFlags fatal_mask;
+
+  fatal_mask = g_log_set_always_fatal (G_LOG_FATAL_MASK);
+  fatal_mask |= G_LOG_LEVEL_WARNING | G_LOG_LEVEL_CRITICAL;
+  g_log_set_always_fatal (fatal_mask);
+
+  tc_chain = tcase_create ("loopbacktransmitter_new");
+  tcase_add_test (tc_chain, test_loopbacktransmitter_new);
+  suite_add_tcase (s, tc_chain);
+
+  tc_chain = tcase_create ("loopbacktransmitter_basic");
+  tcase_add_test (tc_chain, test_loopbacktransmitter_run_basic);
+  suite_add_tcase (s, tc_chain);
+
+  tc_chain = tcase_create ("loopbacktransmitter-sending-half");
+  tcase_add_test (tc_chain, test_loopbacktransmitter_sending_half);
+  suite_add_tcase (s, tc_chain);
+
+  tc_chain = tcase_create ("loopbacktransmitter-local-candidates");
+  tcase_add_test (tc_chain, test_loopbacktransmitter_local_cands);
+  suite_add_tcase (s, tc_chain);
+
+  tc_chain = tcase_create ("loopbacktransmitter-name-in-use");
+  tcase_add_test (tc_chain, test_loopbacktransmitter_name_in_use);
+  suite_add_tcase (s, tc_chain);
+
+  return s;
+}
+
+
+GST_CHECK_MAIN (loopbacktransmitter);
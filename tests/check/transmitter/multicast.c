@@ -248,6 +248,95 @@ GST_START_TEST (test_multicasttransmitter_sending_half)
 }
 GST_END_TEST;
 
+static GList *
+_ssm_candidates (const gchar *source_ip)
+{
+  GList *candidates = NULL;
+  FsCandidate *tmpcand;
+
+  tmpcand = fs_candidate_new ("L1", FS_COMPONENT_RTP,
+      FS_CANDIDATE_TYPE_MULTICAST, FS_NETWORK_PROTOCOL_UDP,
+      "232.0.0.110", 2322);
+  tmpcand->ttl = 1;
+  tmpcand->base_ip = g_strdup (source_ip);
+  candidates = g_list_prepend (candidates, tmpcand);
+
+  tmpcand = fs_candidate_new ("L2", FS_COMPONENT_RTCP,
+      FS_CANDIDATE_TYPE_MULTICAST, FS_NETWORK_PROTOCOL_UDP,
+      "232.0.0.110", 2323);
+  tmpcand->ttl = 1;
+  tmpcand->base_ip = g_strdup (source_ip);
+  candidates = g_list_prepend (candidates, tmpcand);
+
+  return candidates;
+}
+
+static guint
+count_udpsrcs (FsTransmitter *trans)
+{
+  GstElement *trans_src;
+  guint count;
+
+  g_object_get (trans, "gst-src", &trans_src, NULL);
+  count = count_elements_by_factory (GST_BIN (trans_src), "udpsrc");
+  gst_object_unref (trans_src);
+
+  return count;
+}
+
+GST_START_TEST (test_multicasttransmitter_source_specific)
+{
+  /* One socket (so one udpsrc) per component for each distinct source */
+  const guint expected_udpsrcs[3] = {2, 4, 4};
+  GError *error = NULL;
+  FsTransmitter *trans;
+  FsStreamTransmitter *st[3];
+  const gchar *sources[3] = {"10.0.0.1", "10.0.0.2", "10.0.0.1"};
+  gint i;
+
+  trans = fs_transmitter_new ("multicast", 2, 0, &error);
+  if (error)
+    ts_fail ("Error creating transmitter: (%s:%d) %s",
+      g_quark_to_string (error->domain), error->code, error->message);
+
+  /* Two sources on the same group, the third stream shares the socket of
+   * the first one */
+  for (i = 0; i < 3; i++)
+  {
+    GList *candidates = _ssm_candidates (sources[i]);
+
+    st[i] = fs_transmitter_new_stream_transmitter (trans, NULL, 0, NULL,
+        &error);
+    if (error)
+      ts_fail ("Error creating stream transmitter: (%s:%d) %s",
+          g_quark_to_string (error->domain), error->code, error->message);
+
+    if (!fs_stream_transmitter_force_remote_candidates (st[i], candidates,
+            &error))
+      ts_fail ("Could not join the group for source %s: %s", sources[i],
+          error ? error->message : "NO ERROR SET");
+    ts_fail_unless (error == NULL);
+
+    fs_candidate_list_destroy (candidates);
+
+    ts_fail_unless (count_udpsrcs (trans) == expected_udpsrcs[i],
+        "Have %u udpsrc after stream %d, expected %u", count_udpsrcs (trans),
+        i, expected_udpsrcs[i]);
+  }
+
+  for (i = 0; i < 3; i++)
+  {
+    fs_stream_transmitter_stop (st[i]);
+    g_object_unref (st[i]);
+  }
+
+  ts_fail_unless (count_udpsrcs (trans) == 0,
+      "The sockets were not released with the streams");
+
+  g_object_unref (trans);
+}
+GST_END_TEST;
+
 
 
 static Suite *
@@ -282,6 +371,10 @@ multicasttransmitter_suite (void)
   tcase_add_test (tc_chain, test_multicasttransmitter_sending_half);
   suite_add_tcase (s, tc_chain);
 
+  tc_chain = tcase_create ("multicast_transmitter_source_specific");
+  tcase_add_test (tc_chain, test_multicasttransmitter_source_specific);
+  suite_add_tcase (s, tc_chain);
+
   return s;
 }
 
@@ -28,8 +28,11 @@
 
 #include <unistd.h>
 
+#include <nice/agent.h>
+
 #include "check-threadsafe.h"
 #include "generic.h"
+#include "testutils.h"
 
 
 enum {
@@ -38,6 +41,7 @@ enum {
   FLAG_FORCE_CANDIDATES = 1 << 2,
   FLAG_NOT_SENDING = 1 << 3,
   FLAG_MUXED = 1 << 4,
+  FLAG_TRICKLE = 1 << 5,
 };
 
 
@@ -49,9 +53,39 @@ gboolean associate_on_source = TRUE;
 gboolean is_address_local = FALSE;
 gboolean force_candidates = FALSE;
 gboolean is_muxed = FALSE;
+gboolean is_trickle = FALSE;
 
 GMutex count_mutex;
 
+struct trickled_candidate {
+  FsStreamTransmitter *st;
+  FsCandidate *candidate;
+};
+
+static gboolean
+add_trickled_candidate (gpointer user_data)
+{
+  struct trickled_candidate *trickled = user_data;
+  GList *candidates = g_list_prepend (NULL, trickled->candidate);
+  GError *error = NULL;
+  gboolean ret;
+
+  ret = fs_stream_transmitter_add_remote_candidates (trickled->st, candidates,
+      &error);
+
+  if (error)
+    ts_fail ("Error while adding trickled candidate: (%s:%d) %s",
+        g_quark_to_string (error->domain), error->code, error->message);
+  ts_fail_unless (ret == TRUE, "No detailed error adding trickled candidate");
+
+  g_list_free (candidates);
+  fs_candidate_destroy (trickled->candidate);
+  g_object_unref (trickled->st);
+  g_slice_free (struct trickled_candidate, trickled);
+
+  return FALSE;
+}
+
 GST_START_TEST (test_nicetransmitter_new)
 {
   test_transmitter_creation ("nice");
@@ -96,6 +130,33 @@ _new_local_candidate (FsStreamTransmitter *st, FsCandidate *candidate,
   g_object_set_data (G_OBJECT (st), "candidates",
       g_list_append (g_object_get_data (G_OBJECT (st), "candidates"),
           fs_candidate_copy (candidate)));
+
+  if (is_trickle)
+  {
+    struct trickled_candidate *trickled;
+
+    ts_fail_unless (g_object_get_data (G_OBJECT (st), "prepared") == NULL,
+        "Got a local candidate after local-candidates-prepared");
+
+    /* Hand it to the other side right away, before gathering is done */
+    trickled = g_slice_new (struct trickled_candidate);
+    trickled->st = g_object_ref (user_data);
+    trickled->candidate = fs_candidate_copy (candidate);
+    g_idle_add (add_trickled_candidate, trickled);
+  }
+}
+
+static void
+_new_local_candidates (FsStreamTransmitter *st, GList *candidates,
+  gpointer user_data)
+{
+  guint count = GPOINTER_TO_UINT (g_object_get_data (G_OBJECT (st),
+          "batched-count"));
+
+  ts_fail_if (candidates == NULL, "Passed an empty batch of candidates");
+
+  g_object_set_data (G_OBJECT (st), "batched-count",
+      GUINT_TO_POINTER (count + g_list_length (candidates)));
 }
 
 static gboolean
@@ -180,8 +241,20 @@ _local_candidates_prepared (FsStreamTransmitter *st, gpointer user_data)
   ts_fail_if (g_list_length (candidates) < 2,
       "We don't have at least 2 candidates");
 
+  ts_fail_unless (GPOINTER_TO_UINT (g_object_get_data (G_OBJECT (st),
+              "batched-count")) == g_list_length (candidates),
+      "The batches do not contain all of the local candidates");
+
   GST_DEBUG ("Local Candidates Prepared");
 
+  if (is_trickle)
+  {
+    /* They have already been given to the other side one by one */
+    g_object_set_data (G_OBJECT (st), "prepared", "");
+    fs_candidate_list_destroy (candidates);
+    return;
+  }
+
   g_object_set_data (G_OBJECT (st2), "candidates-set", candidates);
 
   g_idle_add (set_the_candidates, st2);
@@ -422,6 +495,7 @@ run_nice_transmitter_test (gint n_parameters, GParameter *params,
   is_address_local = (flags & FLAG_IS_LOCAL);
   force_candidates = (flags & FLAG_FORCE_CANDIDATES);
   is_muxed = (flags & FLAG_MUXED);
+  is_trickle = (flags & FLAG_TRICKLE);
 
   if (flags & FLAG_NOT_SENDING)
   {
@@ -489,6 +563,9 @@ run_nice_transmitter_test (gint n_parameters, GParameter *params,
   ts_fail_unless (g_signal_connect (st, "new-local-candidate",
       G_CALLBACK (_new_local_candidate), st2),
     "Could not connect new-local-candidate signal");
+  ts_fail_unless (g_signal_connect (st, "new-local-candidates",
+      G_CALLBACK (_new_local_candidates), NULL),
+    "Could not connect new-local-candidates signal");
   ts_fail_unless (g_signal_connect (st, "local-candidates-prepared",
       G_CALLBACK (_local_candidates_prepared), st2),
     "Could not connect local-candidates-prepared signal");
@@ -508,6 +585,9 @@ run_nice_transmitter_test (gint n_parameters, GParameter *params,
   ts_fail_unless (g_signal_connect (st2, "new-local-candidate",
       G_CALLBACK (_new_local_candidate), st),
     "Could not connect new-local-candidate signal");
+  ts_fail_unless (g_signal_connect (st2, "new-local-candidates",
+      G_CALLBACK (_new_local_candidates), NULL),
+    "Could not connect new-local-candidates signal");
   ts_fail_unless (g_signal_connect (st2, "local-candidates-prepared",
       G_CALLBACK (_local_candidates_prepared), st),
     "Could not connect local-candidates-prepared signal");
@@ -872,6 +952,200 @@ GST_START_TEST (test_nicetransmitter_send_component_mux)
 }
 GST_END_TEST;
 
+GST_START_TEST (test_nicetransmitter_trickle)
+{
+  GParameter param = {NULL, {0}};
+
+  param.name = "trickle";
+  g_value_init (&param.value, G_TYPE_BOOLEAN);
+  g_value_set_boolean (&param.value, TRUE);
+
+  run_nice_transmitter_test (1, &param, FLAG_TRICKLE);
+}
+GST_END_TEST;
+
+volatile gint agent_failed = FALSE;
+volatile gint remote_done = FALSE;
+volatile gint reported_failed = FALSE;
+
+static gboolean
+quit_loop (gpointer user_data)
+{
+  g_main_loop_quit (loop);
+
+  return FALSE;
+}
+
+static NiceAgent *
+get_nice_agent (FsTransmitter *trans)
+{
+  GstElement *trans_src;
+  GstElement *nicesrc;
+  NiceAgent *agent = NULL;
+
+  g_object_get (trans, "gst-src", &trans_src, NULL);
+
+  nicesrc = find_element_by_factory (GST_BIN (trans_src), "nicesrc");
+  if (nicesrc)
+  {
+    g_object_get (nicesrc, "agent", &agent, NULL);
+    gst_object_unref (nicesrc);
+  }
+
+  gst_object_unref (trans_src);
+
+  return agent;
+}
+
+static void
+_agent_component_state_changed (NiceAgent *agent, guint stream_id,
+    guint component_id, guint state, gpointer user_data)
+{
+  if (state != NICE_COMPONENT_STATE_FAILED)
+    return;
+
+  GST_DEBUG ("Agent reports component %u as failed", component_id);
+
+  g_atomic_int_set (&agent_failed, TRUE);
+  g_idle_add (quit_loop, NULL);
+}
+
+static void
+_failed_state_changed (FsStreamTransmitter *st, guint component,
+    FsStreamState state, gpointer user_data)
+{
+  if (state != FS_STREAM_STATE_FAILED)
+    return;
+
+  ts_fail_unless (g_atomic_int_get (&remote_done),
+      "Component %u reported as failed before remote-candidates-done was set",
+      component);
+  ts_fail_unless (component == 1, "Invalid component %u", component);
+
+  g_atomic_int_set (&reported_failed, TRUE);
+  g_idle_add (quit_loop, NULL);
+}
+
+static gboolean
+add_unreachable_candidate (gpointer user_data)
+{
+  FsStreamTransmitter *st = FS_STREAM_TRANSMITTER (user_data);
+  FsCandidate *candidate;
+  GList *candidates;
+  GError *error = NULL;
+
+  /* Nothing ever answers on the discard port, so the checks can only fail */
+  candidate = fs_candidate_new ("1", 1, FS_CANDIDATE_TYPE_HOST,
+      FS_NETWORK_PROTOCOL_UDP, "127.0.0.1", 9);
+  candidate->priority = 2130706431;
+  candidate->username = g_strdup ("abcdefghijklmnop");
+  candidate->password = g_strdup ("abcdefghijklmnopqrstuvwx");
+  candidates = g_list_prepend (NULL, candidate);
+
+  ts_fail_unless (fs_stream_transmitter_add_remote_candidates (st, candidates,
+          &error), "Could not add the remote candidate: %s",
+      error ? error->message : "(no error)");
+
+  fs_candidate_list_destroy (candidates);
+
+  return FALSE;
+}
+
+static void
+_unreachable_candidates_prepared (FsStreamTransmitter *st, gpointer user_data)
+{
+  g_idle_add (add_unreachable_candidate, st);
+}
+
+GST_START_TEST (test_nicetransmitter_remote_candidates_done)
+{
+  GError *error = NULL;
+  FsTransmitter *trans;
+  FsStreamTransmitter *st;
+  FsNiceTestParticipant *p;
+  GstElement *pipeline;
+  NiceAgent *agent;
+  GParameter param = {NULL, {0}};
+
+  agent_failed = FALSE;
+  remote_done = FALSE;
+  reported_failed = FALSE;
+
+  loop = g_main_loop_new (NULL, FALSE);
+
+  trans = fs_transmitter_new ("nice", 1, 0, &error);
+  if (error)
+    ts_fail ("Error creating transmitter: (%s:%d) %s",
+        g_quark_to_string (error->domain), error->code, error->message);
+  ts_fail_if (trans == NULL, "No transmitter create, yet error is still NULL");
+
+  pipeline = setup_pipeline (trans, G_CALLBACK (_handoff_handler1));
+
+  p = g_object_new (fs_nice_test_participant_get_type (), NULL);
+
+  param.name = "trickle";
+  g_value_init (&param.value, G_TYPE_BOOLEAN);
+  g_value_set_boolean (&param.value, TRUE);
+
+  st = fs_transmitter_new_stream_transmitter (trans, FS_PARTICIPANT (p),
+      1, &param, &error);
+  if (error)
+    ts_fail ("Error creating stream transmitter: (%s:%d) %s",
+        g_quark_to_string (error->domain), error->code, error->message);
+  ts_fail_if (st == NULL, "No stream transmitter created, yet error is NULL");
+
+  agent = get_nice_agent (trans);
+  ts_fail_if (agent == NULL, "Could not find the NiceAgent of the stream");
+
+  g_signal_connect (agent, "component-state-changed",
+      G_CALLBACK (_agent_component_state_changed), NULL);
+  g_signal_connect (st, "state-changed", G_CALLBACK (_failed_state_changed),
+      NULL);
+  g_signal_connect (st, "local-candidates-prepared",
+      G_CALLBACK (_unreachable_candidates_prepared), NULL);
+  g_signal_connect (st, "error", G_CALLBACK (stream_transmitter_error), NULL);
+
+  ts_fail_if (gst_element_set_state (pipeline, GST_STATE_PLAYING) ==
+    GST_STATE_CHANGE_FAILURE, "Could not set the pipeline to playing");
+
+  ts_fail_unless (fs_stream_transmitter_gather_local_candidates (st, &error),
+      "Could not start gathering local candidates");
+
+  /* Wait for the checks to fail, this must not be reported yet since more
+   * remote candidates could still come */
+  g_main_loop_run (loop);
+
+  ts_fail_unless (g_atomic_int_get (&agent_failed));
+  ts_fail_if (g_atomic_int_get (&reported_failed));
+
+  g_atomic_int_set (&remote_done, TRUE);
+  g_object_set (st, "remote-candidates-done", TRUE, NULL);
+
+  /* Now the component that has already failed must be reported */
+  g_main_loop_run (loop);
+
+  ts_fail_unless (g_atomic_int_get (&reported_failed),
+      "The failed component was not reported after remote-candidates-done");
+
+  g_signal_handlers_disconnect_by_func (agent,
+      _agent_component_state_changed, NULL);
+  g_object_unref (agent);
+
+  fs_stream_transmitter_stop (st);
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_element_get_state (pipeline, NULL, NULL, GST_CLOCK_TIME_NONE);
+
+  g_object_unref (st);
+  g_object_unref (trans);
+  g_object_unref (p);
+  gst_object_unref (pipeline);
+
+  g_value_unset (&param.value);
+  g_main_loop_unref (loop);
+}
+GST_END_TEST;
+
 static Suite *
 nicetransmitter_suite (void)
 {
@@ -923,6 +1197,15 @@ nicetransmitter_suite (void)
   tcase_add_test (tc_chain, test_nicetransmitter_send_component_mux);
   suite_add_tcase (s, tc_chain);
 
+  tc_chain = tcase_create ("nicetransmitter-trickle");
+  tcase_add_test (tc_chain, test_nicetransmitter_trickle);
+  suite_add_tcase (s, tc_chain);
+
+  tc_chain = tcase_create ("nicetransmitter-remote-candidates-done");
+  tcase_set_timeout (tc_chain, 30);
+  tcase_add_test (tc_chain, test_nicetransmitter_remote_candidates_done);
+  suite_add_tcase (s, tc_chain);
+
   return s;
 }
 
@@ -0,0 +1,197 @@
+/* Farstream unit tests for the caches of the rawudp transmitter
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <string.h>
+
+#include <gst/check/gstcheck.h>
+
+#include "fs-rawudp-cache.h"
+
+#define NOW (1000 * G_USEC_PER_SEC)
+
+static void
+cache_setup (void)
+{
+  fs_rawudp_cache_clear ();
+}
+
+static void
+store_mapping (gint64 now)
+{
+  fs_rawudp_cache_store_stun_mapping ("192.168.1.2", 7078,
+      "10.0.0.1", 3478, "1.2.3.4", 40000, now);
+}
+
+static gboolean
+lookup_mapping (gint64 now)
+{
+  gchar *mapped_ip = NULL;
+  guint mapped_port = 0;
+
+  if (!fs_rawudp_cache_lookup_stun_mapping ("192.168.1.2", 7078,
+          "10.0.0.1", 3478, now, &mapped_ip, &mapped_port))
+    return FALSE;
+
+  fail_unless (!strcmp (mapped_ip, "1.2.3.4"), "Got mapped ip %s", mapped_ip);
+  fail_unless (mapped_port == 40000, "Got mapped port %u", mapped_port);
+  g_free (mapped_ip);
+
+  return TRUE;
+}
+
+static GList *
+ip_list_new (const gchar *first_ip, ...)
+{
+  GList *ips = NULL;
+  const gchar *ip;
+  va_list var_args;
+
+  va_start (var_args, first_ip);
+  for (ip = first_ip; ip; ip = va_arg (var_args, const gchar *))
+    ips = g_list_append (ips, g_strdup (ip));
+  va_end (var_args);
+
+  return ips;
+}
+
+static void
+ip_list_free (GList *ips)
+{
+  g_list_foreach (ips, (GFunc) g_free, NULL);
+  g_list_free (ips);
+}
+
+GST_START_TEST (test_rawudpcache_stun_hit)
+{
+  gchar *mapped_ip = NULL;
+  guint mapped_port = 0;
+
+  fail_if (lookup_mapping (NOW), "Found a mapping in an empty cache");
+
+  store_mapping (NOW);
+  fail_unless (lookup_mapping (NOW + G_USEC_PER_SEC),
+      "The mapping was not found");
+
+  /* Another local port or STUN server has its own mapping */
+  fail_if (fs_rawudp_cache_lookup_stun_mapping ("192.168.1.2", 7080,
+          "10.0.0.1", 3478, NOW, &mapped_ip, &mapped_port));
+  fail_if (fs_rawudp_cache_lookup_stun_mapping ("192.168.1.2", 7078,
+          "10.0.0.2", 3478, NOW, &mapped_ip, &mapped_port));
+  fail_unless (mapped_ip == NULL);
+}
+GST_END_TEST;
+
+GST_START_TEST (test_rawudpcache_stun_expiry)
+{
+  gint64 expiry = NOW + FS_RAWUDP_STUN_MAPPING_CACHE_TIMEOUT * G_USEC_PER_SEC;
+
+  store_mapping (NOW);
+  fail_unless (lookup_mapping (expiry - 1), "The mapping expired too early");
+  fail_if (lookup_mapping (expiry), "The mapping did not expire");
+
+  /* A new STUN reply makes it valid again */
+  store_mapping (expiry);
+  fail_unless (lookup_mapping (expiry + 1), "The mapping was not refreshed");
+}
+GST_END_TEST;
+
+GST_START_TEST (test_rawudpcache_local_ips)
+{
+  gint64 expiry = NOW + FS_RAWUDP_LOCAL_IPS_CACHE_TIMEOUT * G_USEC_PER_SEC;
+  GList *stored = ip_list_new ("192.168.1.2", "10.1.1.1", NULL);
+  GList *ips = NULL;
+
+  fail_if (fs_rawudp_cache_lookup_local_ips (FALSE, NOW, &ips));
+
+  fs_rawudp_cache_store_local_ips (FALSE, stored, NOW);
+
+  fail_unless (fs_rawudp_cache_lookup_local_ips (FALSE, expiry - 1, &ips),
+      "The interface list was not cached");
+  fail_unless (g_list_length (ips) == 2);
+  fail_unless (!strcmp (ips->data, "192.168.1.2"));
+  fail_unless (!strcmp (ips->next->data, "10.1.1.1"));
+  ip_list_free (ips);
+  ips = NULL;
+
+  /* The list with the loopback devices is separate */
+  fail_if (fs_rawudp_cache_lookup_local_ips (TRUE, NOW, &ips));
+
+  fail_if (fs_rawudp_cache_lookup_local_ips (FALSE, expiry, &ips),
+      "The interface list did not expire");
+
+  ip_list_free (stored);
+}
+GST_END_TEST;
+
+GST_START_TEST (test_rawudpcache_invalidation)
+{
+  GList *ips = ip_list_new ("192.168.1.2", NULL);
+  GList *other_ips = ip_list_new ("192.168.5.7", NULL);
+
+  fs_rawudp_cache_store_local_ips (FALSE, ips, NOW);
+  store_mapping (NOW);
+
+  /* Enumerating the same interfaces again keeps the mappings */
+  fs_rawudp_cache_store_local_ips (FALSE, ips, NOW + G_USEC_PER_SEC);
+  fail_unless (lookup_mapping (NOW + G_USEC_PER_SEC),
+      "The mapping was dropped while the interfaces did not change");
+
+  /* A network change drops them */
+  fs_rawudp_cache_store_local_ips (FALSE, other_ips, NOW + 2 * G_USEC_PER_SEC);
+  fail_if (lookup_mapping (NOW + 2 * G_USEC_PER_SEC),
+      "The mapping was kept after the interfaces changed");
+
+  ip_list_free (ips);
+  ip_list_free (other_ips);
+}
+GST_END_TEST;
+
+static Suite *
+rawudpcache_suite (void)
+{
+  Suite *s = suite_create ("rawudpcache");
+  TCase *tc_chain;
+
+  tc_chain = tcase_create ("rawudpcache_stun_hit");
+  tcase_add_checked_fixture (tc_chain, cache_setup, NULL);
+  tcase_add_test (tc_chain, test_rawudpcache_stun_hit);
+  suite_add_tcase (s, tc_chain);
+
+  tc_chain = tcase_create ("rawudpcache_stun_expiry");
+  tcase_add_checked_fixture (tc_chain, cache_setup, NULL);
+  tcase_add_test (tc_chain, test_rawudpcache_stun_expiry);
+  suite_add_tcase (s, tc_chain);
+
+  tc_chain = tcase_create ("rawudpcache_local_ips");
+  tcase_add_checked_fixture (tc_chain, cache_setup, NULL);
+  tcase_add_test (tc_chain, test_rawudpcache_local_ips);
+  suite_add_tcase (s, tc_chain);
+
+  tc_chain = tcase_create ("rawudpcache_invalidation");
+  tcase_add_checked_fixture (tc_chain, cache_setup, NULL);
+  tcase_add_test (tc_chain, test_rawudpcache_invalidation);
+  suite_add_tcase (s, tc_chain);
+
+  return s;
+}
+
+GST_CHECK_MAIN (rawudpcache);
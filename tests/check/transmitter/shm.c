@@ -34,6 +34,7 @@
 
 #include "check-threadsafe.h"
 #include "generic.h"
+#include "testutils.h"
 
 gint buffer_count[2] = {0, 0};
 gboolean got_candidates[2];
@@ -407,6 +408,186 @@ GST_START_TEST (test_shmtransmitter_local_cands)
 }
 GST_END_TEST;
 
+static void
+_fan_out_new_local_candidate (FsStreamTransmitter *st, FsCandidate *candidate,
+  gpointer user_data)
+{
+  gchar **path = user_data;
+
+  ts_fail_unless (candidate->component_id == 1);
+  ts_fail_unless (*path == NULL, "Got two local candidates");
+  *path = g_strdup (candidate->ip);
+}
+
+static void
+_fan_out_handoff (GstElement *element, GstBuffer *buffer, GstPad *pad,
+  gpointer user_data)
+{
+  guint *count = user_data;
+
+  g_mutex_lock (&test_mutex);
+  (*count)++;
+  g_mutex_unlock (&test_mutex);
+  g_cond_signal (&cond);
+}
+
+static guint
+count_shmsinks (FsTransmitter *trans)
+{
+  GstElement *trans_sink;
+  guint count;
+
+  g_object_get (trans, "gst-sink", &trans_sink, NULL);
+  count = count_elements_by_factory (GST_BIN (trans_sink), "shmsink");
+  gst_object_unref (trans_sink);
+
+  return count;
+}
+
+static GstElement *
+setup_fan_out_reader (guint *count)
+{
+  GstElement *reader;
+  GstElement *sink;
+  GError *error = NULL;
+
+  reader = gst_parse_launch ("shmsrc socket-path=/tmp/src1 is-live=TRUE !"
+      " fakesink name=sink sync=FALSE async=FALSE signal-handoffs=TRUE",
+      &error);
+  ts_fail_unless (reader != NULL, "Could not make the reader: %s",
+      error ? error->message : "");
+  g_clear_error (&error);
+
+  sink = gst_bin_get_by_name (GST_BIN (reader), "sink");
+  g_signal_connect (sink, "handoff", G_CALLBACK (_fan_out_handoff), count);
+  gst_object_unref (sink);
+
+  ts_fail_if (gst_element_set_state (reader, GST_STATE_PLAYING) ==
+      GST_STATE_CHANGE_FAILURE, "Could not start the reader");
+
+  return reader;
+}
+
+GST_START_TEST (test_shmtransmitter_fan_out)
+{
+  GError *error = NULL;
+  FsTransmitter *trans;
+  FsStreamTransmitter *st[3];
+  gchar *paths[3] = {NULL, NULL, NULL};
+  GstElement *readers[2];
+  guint received[2] = {0, 0};
+  GParameter params[1];
+  gboolean fan_out = FALSE;
+  gint64 end_time;
+  gint i;
+
+  g_cond_init (&cond);
+  g_mutex_init (&test_mutex);
+  connected_count = 0;
+
+  if (unlink ("/tmp/src1") < 0 && errno != ENOENT)
+    fail ("Could not unlink /tmp/src1: %s", strerror (errno));
+
+  trans = fs_transmitter_new ("shm", 2, 0, &error);
+  if (error)
+    ts_fail ("Error creating transmitter: (%s:%d) %s",
+      g_quark_to_string (error->domain), error->code, error->message);
+
+  g_object_set (trans, "fan-out", TRUE, NULL);
+  g_object_get (trans, "fan-out", &fan_out, NULL);
+  ts_fail_unless (fan_out, "Could not enable fan-out");
+
+  pipeline = setup_pipeline (trans, NULL);
+
+  memset (params, 0, sizeof (GParameter));
+  params[0].name = "preferred-local-candidates";
+  g_value_init (&params[0].value, FS_TYPE_CANDIDATE_LIST);
+  g_value_take_boxed (&params[0].value,
+      g_list_append (NULL, fs_candidate_new (NULL, 1,
+              FS_CANDIDATE_TYPE_HOST, FS_NETWORK_PROTOCOL_UDP, "/tmp/src1",
+              0)));
+
+  /* All of the streams send on the same socket */
+  for (i = 0; i < 3; i++)
+  {
+    st[i] = fs_transmitter_new_stream_transmitter (trans, NULL, 1, params,
+        &error);
+    if (error)
+      ts_fail ("Error creating stream transmitter: (%s:%d) %s",
+          g_quark_to_string (error->domain), error->code, error->message);
+    ts_fail_if (st[i] == NULL, "No stream transmitter created");
+
+    g_object_set (st[i], "sending", TRUE, NULL);
+    g_signal_connect (st[i], "new-local-candidate",
+        G_CALLBACK (_fan_out_new_local_candidate), &paths[i]);
+    g_signal_connect (st[i], "state-changed", G_CALLBACK (_state_changed),
+        NULL);
+
+    ts_fail_unless (fs_stream_transmitter_gather_local_candidates (st[i],
+            &error), "Could not share the send socket: %s",
+        error ? error->message : "");
+  }
+
+  g_value_unset (&params[0].value);
+
+  ts_fail_if (gst_element_set_state (pipeline, GST_STATE_PLAYING) ==
+      GST_STATE_CHANGE_FAILURE, "Could not set the pipeline to playing");
+
+  ts_fail_unless (count_shmsinks (trans) == 1,
+      "The streams do not share a single shmsink");
+
+  for (i = 0; i < 3; i++)
+  {
+    ts_fail_unless (paths[i] != NULL, "Stream %d has no local candidate", i);
+    ts_fail_unless (!strcmp (paths[i], "/tmp/src1"),
+        "Stream %d sends on %s", i, paths[i]);
+  }
+
+  /* Every stream is told about every reader of the shared socket */
+  readers[0] = setup_fan_out_reader (&received[0]);
+  readers[1] = setup_fan_out_reader (&received[1]);
+
+  g_mutex_lock (&test_mutex);
+  while (connected_count < 6)
+    g_cond_wait (&cond, &test_mutex);
+  g_mutex_unlock (&test_mutex);
+
+  setup_fakesrc (trans, pipeline, 1);
+
+  end_time = g_get_monotonic_time () + 10 * G_TIME_SPAN_SECOND;
+  g_mutex_lock (&test_mutex);
+  while (received[0] == 0 || received[1] == 0)
+    if (!g_cond_wait_until (&cond, &test_mutex, end_time))
+      break;
+  g_mutex_unlock (&test_mutex);
+
+  ts_fail_unless (received[0] > 0 && received[1] > 0,
+      "Both readers should get data from the shared segment (%u, %u)",
+      received[0], received[1]);
+
+  for (i = 0; i < 2; i++)
+  {
+    gst_element_set_state (readers[i], GST_STATE_NULL);
+    gst_object_unref (readers[i]);
+  }
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+
+  for (i = 0; i < 3; i++)
+  {
+    fs_stream_transmitter_stop (st[i]);
+    g_object_unref (st[i]);
+    g_free (paths[i]);
+  }
+
+  g_object_unref (trans);
+  gst_object_unref (pipeline);
+
+  g_cond_clear (&cond);
+  g_mutex_clear (&test_mutex);
+}
+GST_END_TEST;
+
 
 static Suite *
 shmtransmitter_suite (void)
@@ -435,6 +616,10 @@ shmtransmitter_suite (void)
   tcase_add_test (tc_chain, test_shmtransmitter_local_cands);
   suite_add_tcase (s, tc_chain);
 
+  tc_chain = tcase_create ("shmtransmitter-fan-out");
+  tcase_add_test (tc_chain, test_shmtransmitter_fan_out);
+  suite_add_tcase (s, tc_chain);
+
   return s;
 }
 
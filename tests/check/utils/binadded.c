@@ -257,6 +257,152 @@ GST_START_TEST (test_bin_keyfile)
 }
 GST_END_TEST;
 
+GST_START_TEST (test_bin_keyfile_many)
+{
+  GKeyFile *keyfile = g_key_file_new ();
+  FsElementAddedNotifier *notifier = NULL;
+  GstElement *pipeline;
+  guint i;
+
+  g_key_file_set_boolean (keyfile, "identity", "sync", TRUE);
+  g_key_file_set_integer (keyfile, "namedqueue", "max-size-buffers", 7);
+
+  notifier = fs_element_added_notifier_new ();
+  fail_if (fs_element_added_notifier_set_properties_from_keyfile (notifier,
+          keyfile) == 0);
+
+  pipeline = gst_pipeline_new (NULL);
+  fs_element_added_notifier_add (notifier, GST_BIN (pipeline));
+
+  /* The second elements of each type re-use the resolved properties */
+  for (i = 0; i < 2; i++)
+  {
+    GstElement *identity = gst_element_factory_make ("identity", NULL);
+    GstElement *queue = gst_element_factory_make ("queue", NULL);
+    GstElement *namedqueue = gst_element_factory_make ("queue", "namedqueue");
+    gboolean sync;
+    guint buffers;
+
+    fail_unless (gst_bin_add (GST_BIN (pipeline), identity));
+    fail_unless (gst_bin_add (GST_BIN (pipeline), queue));
+    fail_unless (gst_bin_add (GST_BIN (pipeline), namedqueue));
+
+    g_object_get (identity, "sync", &sync, NULL);
+    fail_unless (sync == TRUE, "sync prop on identity %u not set", i);
+
+    g_object_get (namedqueue, "max-size-buffers", &buffers, NULL);
+    fail_unless (buffers == 7, "max-size-buffers on named queue %u not set",
+        i);
+
+    g_object_get (queue, "max-size-buffers", &buffers, NULL);
+    fail_if (buffers == 7, "max-size-buffers set on unnamed queue %u", i);
+
+    gst_bin_remove (GST_BIN (pipeline), identity);
+    gst_bin_remove (GST_BIN (pipeline), queue);
+    gst_bin_remove (GST_BIN (pipeline), namedqueue);
+  }
+
+  g_object_unref (notifier);
+  gst_object_unref (pipeline);
+}
+GST_END_TEST;
+
+#define NESTED_BINS 1000
+
+static void
+_count_added_cb (FsElementAddedNotifier *notifier, GstBin *bin,
+    GstElement *element, gpointer user_data)
+{
+  guint *count = user_data;
+
+  (*count)++;
+}
+
+static GstElement *
+build_nested_bins (guint depth, GstElement **innermost)
+{
+  GstElement *top = NULL;
+  GstElement *parent = NULL;
+  guint i;
+
+  for (i = 0; i < depth; i++)
+  {
+    GstElement *bin = gst_bin_new (NULL);
+
+    fail_unless (gst_bin_add (GST_BIN (bin),
+            gst_element_factory_make ("identity", NULL)));
+
+    if (parent)
+      fail_unless (gst_bin_add (GST_BIN (parent), bin));
+    else
+      top = bin;
+    parent = bin;
+  }
+
+  *innermost = parent;
+  return top;
+}
+
+GST_START_TEST (test_bin_added_nested_benchmark)
+{
+  FsElementAddedNotifier *notifier = NULL;
+  GstElement *pipeline;
+  GstElement *top;
+  GstElement *innermost;
+  guint count = 0;
+  gint64 start;
+
+  notifier = fs_element_added_notifier_new ();
+  g_signal_connect (notifier, "element-added", G_CALLBACK (_count_added_cb),
+      &count);
+
+  pipeline = gst_pipeline_new (NULL);
+  fs_element_added_notifier_add (notifier, GST_BIN (pipeline));
+
+  /* Adding a pre-built tree announces every element exactly once */
+  top = build_nested_bins (NESTED_BINS, &innermost);
+  start = g_get_monotonic_time ();
+  fail_unless (gst_bin_add (GST_BIN (pipeline), top));
+  GST_INFO ("Added %u nested bins in %" G_GINT64_FORMAT " us", NESTED_BINS,
+      g_get_monotonic_time () - start);
+  fail_unless (count == 2 * NESTED_BINS, "Got %u elements, expected %u",
+      count, 2 * NESTED_BINS);
+
+  /* The innermost bin is tracked too */
+  count = 0;
+  fail_unless (gst_bin_add (GST_BIN (innermost),
+          gst_element_factory_make ("identity", NULL)));
+  fail_unless (count == 1);
+
+  /* Once removed, nothing in the tree is tracked anymore */
+  gst_object_ref (top);
+  start = g_get_monotonic_time ();
+  fail_unless (gst_bin_remove (GST_BIN (pipeline), top));
+  GST_INFO ("Removed %u nested bins in %" G_GINT64_FORMAT " us", NESTED_BINS,
+      g_get_monotonic_time () - start);
+  count = 0;
+  fail_unless (gst_bin_add (GST_BIN (innermost),
+          gst_element_factory_make ("identity", NULL)));
+  fail_unless (count == 0);
+
+  /* Watching a bin that already contains the tree */
+  fail_unless (fs_element_added_notifier_remove (notifier,
+          GST_BIN (pipeline)));
+  fail_unless (gst_bin_add (GST_BIN (pipeline), top));
+  gst_object_unref (top);
+  count = 0;
+  start = g_get_monotonic_time ();
+  fs_element_added_notifier_add (notifier, GST_BIN (pipeline));
+  GST_INFO ("Walked %u nested bins in %" G_GINT64_FORMAT " us", NESTED_BINS,
+      g_get_monotonic_time () - start);
+  fail_unless (count == 2 * NESTED_BINS + 2,
+      "Got %u elements, expected %u", count, 2 * NESTED_BINS + 2);
+
+  g_object_unref (notifier);
+  gst_object_unref (pipeline);
+}
+GST_END_TEST;
+
 GST_START_TEST (test_bin_file)
 {
   FsElementAddedNotifier *notifier = NULL;
@@ -315,6 +461,8 @@ binadded_suite (void)
   tcase_add_test (tc_chain, test_bin_added_simple);
   tcase_add_test (tc_chain, test_bin_added_recursive);
   tcase_add_test (tc_chain, test_bin_keyfile);
+  tcase_add_test (tc_chain, test_bin_keyfile_many);
+  tcase_add_test (tc_chain, test_bin_added_nested_benchmark);
   tcase_add_test (tc_chain, test_bin_file);
   tcase_add_test (tc_chain, test_bin_errors);
 
@@ -0,0 +1,149 @@
+/* Farstream unit tests for the default preferences
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <string.h>
+
+#include <glib/gstdio.h>
+#include <gst/check/gstcheck.h>
+#include <farstream/fs-utils.h>
+
+static gchar *data_home = NULL;
+
+static gchar *
+properties_path (void)
+{
+  return g_build_filename (data_home, PACKAGE, FS_APIVERSION, "identity",
+      "default-element-properties", NULL);
+}
+
+static void
+write_properties (const gchar *value)
+{
+  gchar *path = properties_path ();
+  gchar *dir = g_path_get_dirname (path);
+  gchar *contents = g_strdup_printf ("[identity]\nsilent=%s\n", value);
+
+  fail_unless (g_mkdir_with_parents (dir, 0700) == 0);
+  fail_unless (g_file_set_contents (path, contents, -1, NULL));
+
+  g_free (contents);
+  g_free (dir);
+  g_free (path);
+}
+
+static gboolean
+get_silent (GstElement *element)
+{
+  GKeyFile *keyfile = fs_utils_get_default_element_properties (element);
+  GError *error = NULL;
+  gboolean silent;
+
+  fail_unless (keyfile != NULL, "No default element properties found");
+  silent = g_key_file_get_boolean (keyfile, "identity", "silent", &error);
+  fail_unless (error == NULL);
+  g_key_file_free (keyfile);
+
+  return silent;
+}
+
+GST_START_TEST (test_default_prefs_invalidate_cache)
+{
+  GstElement *identity = gst_element_factory_make ("identity", NULL);
+  gchar *path;
+
+  fail_unless (identity != NULL);
+
+  fs_utils_invalidate_default_preferences_cache ();
+
+  write_properties ("true");
+  fail_unless (get_silent (identity) == TRUE);
+
+  /* The file is only read once */
+  write_properties ("false");
+  fail_unless (get_silent (identity) == TRUE,
+      "The cached default properties were not used");
+
+  fs_utils_invalidate_default_preferences_cache ();
+  fail_unless (get_silent (identity) == FALSE,
+      "The default properties were not read again after invalidating");
+
+  path = properties_path ();
+  g_unlink (path);
+  g_free (path);
+
+  gst_object_unref (identity);
+}
+GST_END_TEST;
+
+
+static Suite *
+defaultprefs_suite (void)
+{
+  Suite *s = suite_create ("defaultprefs");
+  TCase *tc_chain = tcase_create ("defaultprefs");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_default_prefs_invalidate_cache);
+
+  return s;
+}
+
+/*
+ * GLib reads XDG_DATA_HOME only once, so it has to point to the temporary
+ * directory before gst_check_init()
+ */
+
+int
+main (int argc, char **argv)
+{
+  Suite *s;
+  SRunner *sr;
+  int nf;
+
+  data_home = g_dir_make_tmp ("fs-defaultprefs-XXXXXX", NULL);
+  g_assert (data_home != NULL);
+  g_setenv ("XDG_DATA_HOME", data_home, TRUE);
+
+  gst_check_init (&argc, &argv);
+
+  s = defaultprefs_suite ();
+  sr = srunner_create (s);
+  srunner_run_all (sr, CK_NORMAL);
+  nf = srunner_ntests_failed (sr);
+  srunner_free (sr);
+
+  {
+    gchar *dir = g_build_filename (data_home, PACKAGE, FS_APIVERSION,
+        "identity", NULL);
+
+    while (g_rmdir (dir) == 0 && strcmp (dir, data_home))
+    {
+      gchar *parent = g_path_get_dirname (dir);
+      g_free (dir);
+      dir = parent;
+    }
+    g_free (dir);
+  }
+  g_free (data_home);
+
+  return nf == 0 ? 0 : -1;
+}
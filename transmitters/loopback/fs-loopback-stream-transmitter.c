@@ -0,0 +1,493 @@
+/*
+ * Farstream - Farstream Loopback Stream Transmitter
+ *
+ * fs-loopback-stream-transmitter.c - A Farstream in-process loopback
+ *                                    stream transmitter
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+
+/**
+ * SECTION:fs-loopback-stream-transmitter
+ * @short_description: A stream transmitter object for conferences of the
+ * same process
+ *
+ * The name of this transmitter is "loopback".
+ *
+ * This transmitter is meant to connect two conferences running in the
+ * same process, for example to build a mixer or to run benchmarks without
+ * any network noise. The buffers are handed to the other conference by
+ * reference, nothing is copied and no socket is used.
+ *
+ * Each stream receives on a symbolic name, which is the "ip" field of its
+ * local #FsCandidate. The name can be chosen by setting the
+ * #FsStreamTransmitter:preferred-local-candidates property, otherwise a
+ * unique one is generated. The names are shared by all of the loopback
+ * transmitters in the process, so the same name can not be used by two
+ * streams for the same component.
+ *
+ * To send to another stream, give the name of its local candidate in the
+ * "ip" field of the remote #FsCandidate passed to
+ * fs_stream_transmitter_force_remote_candidates(). The stream on the other
+ * side does not need to exist yet, the buffers are dropped until it does.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "fs-loopback-stream-transmitter.h"
+#include "fs-loopback-transmitter.h"
+
+#include <farstream/fs-candidate.h>
+#include <farstream/fs-conference.h>
+
+#include <gst/gst.h>
+
+#include <string.h>
+
+GST_DEBUG_CATEGORY_EXTERN (fs_loopback_transmitter_debug);
+#define GST_CAT_DEFAULT fs_loopback_transmitter_debug
+
+/* Signals */
+enum
+{
+  LAST_SIGNAL
+};
+
+/* props */
+enum
+{
+  PROP_0,
+  PROP_SENDING,
+  PROP_PREFERRED_LOCAL_CANDIDATES
+};
+
+struct _FsLoopbackStreamTransmitterPrivate
+{
+  /* We don't actually hold a ref to this,
+   * But since our parent FsStream can not exist without its parent
+   * FsSession, we should be safe
+   */
+  FsLoopbackTransmitter *transmitter;
+
+  GList *preferred_local_candidates;
+
+  GMutex mutex;
+
+  /* Protected by the mutex */
+  gboolean sending;
+
+  LoopbackSrc **src;
+  LoopbackSink **sink;
+};
+
+#define FS_LOOPBACK_STREAM_TRANSMITTER_GET_PRIVATE(o)  \
+  (G_TYPE_INSTANCE_GET_PRIVATE ((o), FS_TYPE_LOOPBACK_STREAM_TRANSMITTER, \
+                                FsLoopbackStreamTransmitterPrivate))
+
+#define FS_LOOPBACK_STREAM_TRANSMITTER_LOCK(s) \
+  g_mutex_lock (&(s)->priv->mutex)
+#define FS_LOOPBACK_STREAM_TRANSMITTER_UNLOCK(s) \
+  g_mutex_unlock (&(s)->priv->mutex)
+
+static void fs_loopback_stream_transmitter_class_init (
+    FsLoopbackStreamTransmitterClass *klass);
+static void fs_loopback_stream_transmitter_init (
+    FsLoopbackStreamTransmitter *self);
+static void fs_loopback_stream_transmitter_dispose (GObject *object);
+static void fs_loopback_stream_transmitter_finalize (GObject *object);
+
+static void fs_loopback_stream_transmitter_get_property (GObject *object,
+                                                guint prop_id,
+                                                GValue *value,
+                                                GParamSpec *pspec);
+static void fs_loopback_stream_transmitter_set_property (GObject *object,
+                                                guint prop_id,
+                                                const GValue *value,
+                                                GParamSpec *pspec);
+
+static gboolean fs_loopback_stream_transmitter_force_remote_candidates (
+    FsStreamTransmitter *streamtransmitter, GList *candidates,
+    GError **error);
+static gboolean fs_loopback_stream_transmitter_gather_local_candidates (
+    FsStreamTransmitter *streamtransmitter,
+    GError **error);
+
+
+static GObjectClass *parent_class = NULL;
+// static guint signals[LAST_SIGNAL] = { 0 };
+
+static GType type = 0;
+
+GType
+fs_loopback_stream_transmitter_get_type (void)
+{
+  return type;
+}
+
+GType
+fs_loopback_stream_transmitter_register_type (FsPlugin *module G_GNUC_UNUSED)
+{
+  static const GTypeInfo info = {
+    sizeof (FsLoopbackStreamTransmitterClass),
+    NULL,
+    NULL,
+    (GClassInitFunc) fs_loopback_stream_transmitter_class_init,
+    NULL,
+    NULL,
+    sizeof (FsLoopbackStreamTransmitter),
+    0,
+    (GInstanceInitFunc) fs_loopback_stream_transmitter_init
+  };
+
+  type = g_type_register_static (FS_TYPE_STREAM_TRANSMITTER,
+      "FsLoopbackStreamTransmitter", &info, 0);
+
+  return type;
+}
+
+static void
+fs_loopback_stream_transmitter_class_init (
+    FsLoopbackStreamTransmitterClass *klass)
+{
+  GObjectClass *gobject_class = (GObjectClass *) klass;
+  FsStreamTransmitterClass *streamtransmitterclass =
+    FS_STREAM_TRANSMITTER_CLASS (klass);
+
+  parent_class = g_type_class_peek_parent (klass);
+
+  gobject_class->set_property = fs_loopback_stream_transmitter_set_property;
+  gobject_class->get_property = fs_loopback_stream_transmitter_get_property;
+
+  streamtransmitterclass->force_remote_candidates =
+    fs_loopback_stream_transmitter_force_remote_candidates;
+  streamtransmitterclass->gather_local_candidates =
+    fs_loopback_stream_transmitter_gather_local_candidates;
+
+  g_object_class_override_property (gobject_class, PROP_SENDING, "sending");
+  g_object_class_override_property (gobject_class,
+      PROP_PREFERRED_LOCAL_CANDIDATES, "preferred-local-candidates");
+
+  gobject_class->dispose = fs_loopback_stream_transmitter_dispose;
+  gobject_class->finalize = fs_loopback_stream_transmitter_finalize;
+
+  g_type_class_add_private (klass,
+      sizeof (FsLoopbackStreamTransmitterPrivate));
+}
+
+static void
+fs_loopback_stream_transmitter_init (FsLoopbackStreamTransmitter *self)
+{
+  /* member init */
+  self->priv = FS_LOOPBACK_STREAM_TRANSMITTER_GET_PRIVATE (self);
+
+  self->priv->sending = TRUE;
+
+  g_mutex_init (&self->priv->mutex);
+}
+
+static void
+fs_loopback_stream_transmitter_dispose (GObject *object)
+{
+  FsLoopbackStreamTransmitter *self = FS_LOOPBACK_STREAM_TRANSMITTER (object);
+  gint c; /* component_id */
+
+  for (c = 1; c <= self->priv->transmitter->components; c++)
+  {
+    if (self->priv->src[c])
+      fs_loopback_transmitter_check_src (self->priv->transmitter,
+          self->priv->src[c], NULL);
+    self->priv->src[c] = NULL;
+
+    if (self->priv->sink[c])
+      fs_loopback_transmitter_check_sink (self->priv->transmitter,
+          self->priv->sink[c], NULL);
+    self->priv->sink[c] = NULL;
+  }
+
+  parent_class->dispose (object);
+}
+
+static void
+fs_loopback_stream_transmitter_finalize (GObject *object)
+{
+  FsLoopbackStreamTransmitter *self = FS_LOOPBACK_STREAM_TRANSMITTER (object);
+
+  fs_candidate_list_destroy (self->priv->preferred_local_candidates);
+
+  g_free (self->priv->src);
+  g_free (self->priv->sink);
+  g_mutex_clear (&self->priv->mutex);
+
+  parent_class->finalize (object);
+}
+
+static void
+fs_loopback_stream_transmitter_get_property (GObject *object,
+                                           guint prop_id,
+                                           GValue *value,
+                                           GParamSpec *pspec)
+{
+  FsLoopbackStreamTransmitter *self = FS_LOOPBACK_STREAM_TRANSMITTER (object);
+
+  switch (prop_id)
+  {
+    case PROP_SENDING:
+      FS_LOOPBACK_STREAM_TRANSMITTER_LOCK (self);
+      g_value_set_boolean (value, self->priv->sending);
+      FS_LOOPBACK_STREAM_TRANSMITTER_UNLOCK (self);
+      break;
+    case PROP_PREFERRED_LOCAL_CANDIDATES:
+      g_value_set_boxed (value, self->priv->preferred_local_candidates);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+}
+
+static void
+fs_loopback_stream_transmitter_set_property (GObject *object,
+                                           guint prop_id,
+                                           const GValue *value,
+                                           GParamSpec *pspec)
+{
+  FsLoopbackStreamTransmitter *self = FS_LOOPBACK_STREAM_TRANSMITTER (object);
+
+  switch (prop_id) {
+    case PROP_SENDING:
+      FS_LOOPBACK_STREAM_TRANSMITTER_LOCK (self);
+      self->priv->sending = g_value_get_boolean (value);
+      if (self->priv->sink && self->priv->sink[1])
+        fs_loopback_transmitter_sink_set_sending (self->priv->transmitter,
+            self->priv->sink[1], self->priv->sending);
+      FS_LOOPBACK_STREAM_TRANSMITTER_UNLOCK (self);
+      break;
+    case PROP_PREFERRED_LOCAL_CANDIDATES:
+      self->priv->preferred_local_candidates = g_value_dup_boxed (value);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+}
+
+static gboolean
+fs_loopback_stream_transmitter_build (FsLoopbackStreamTransmitter *self,
+  GError **error)
+{
+  self->priv->src = g_new0 (LoopbackSrc *,
+      self->priv->transmitter->components + 1);
+  self->priv->sink = g_new0 (LoopbackSink *,
+      self->priv->transmitter->components + 1);
+
+  return TRUE;
+}
+
+static void
+got_buffer_func (GstBuffer *buffer, guint component, gpointer data)
+{
+  FsLoopbackStreamTransmitter *self =
+    FS_LOOPBACK_STREAM_TRANSMITTER_CAST (data);
+
+  g_signal_emit_by_name (self, "known-source-packet-received", component,
+      buffer);
+}
+
+static gboolean
+fs_loopback_stream_transmitter_force_remote_candidate (
+    FsLoopbackStreamTransmitter *self, FsCandidate *candidate,
+    GError **error)
+{
+  guint c = candidate->component_id;
+
+  if (self->priv->sink[c])
+  {
+    if (fs_loopback_transmitter_check_sink (self->priv->transmitter,
+            self->priv->sink[c], candidate->ip))
+      return TRUE;
+    self->priv->sink[c] = NULL;
+  }
+
+  self->priv->sink[c] = fs_loopback_transmitter_get_sink (
+      self->priv->transmitter, c, candidate->ip, error);
+
+  if (self->priv->sink[c] == NULL)
+    return FALSE;
+
+  if (c == 1)
+  {
+    FS_LOOPBACK_STREAM_TRANSMITTER_LOCK (self);
+    fs_loopback_transmitter_sink_set_sending (self->priv->transmitter,
+        self->priv->sink[c], self->priv->sending);
+    FS_LOOPBACK_STREAM_TRANSMITTER_UNLOCK (self);
+  }
+
+  /* There is no connection to establish */
+  g_signal_emit_by_name (self, "state-changed", c, FS_STREAM_STATE_READY);
+
+  return TRUE;
+}
+
+/**
+ * fs_loopback_stream_transmitter_force_remote_candidates
+ */
+
+static gboolean
+fs_loopback_stream_transmitter_force_remote_candidates (
+    FsStreamTransmitter *streamtransmitter, GList *candidates,
+    GError **error)
+{
+  GList *item = NULL;
+  FsLoopbackStreamTransmitter *self =
+    FS_LOOPBACK_STREAM_TRANSMITTER (streamtransmitter);
+
+  for (item = candidates; item; item = g_list_next (item))
+  {
+    FsCandidate *candidate = item->data;
+
+    if (candidate->component_id == 0 ||
+        candidate->component_id > self->priv->transmitter->components) {
+      g_set_error (error, FS_ERROR, FS_ERROR_INVALID_ARGUMENTS,
+          "The candidate passed has an invalid component id %u (not in [1,%u])",
+          candidate->component_id, self->priv->transmitter->components);
+      return FALSE;
+    }
+
+    if (!candidate->ip || !candidate->ip[0])
+    {
+      g_set_error (error, FS_ERROR, FS_ERROR_INVALID_ARGUMENTS,
+          "The candidate does not have the name of the remote stream"
+          " in its ip");
+      return FALSE;
+    }
+  }
+
+  for (item = candidates; item; item = g_list_next (item))
+    if (!fs_loopback_stream_transmitter_force_remote_candidate (self,
+            item->data, error))
+      return FALSE;
+
+
+  return TRUE;
+}
+
+
+FsLoopbackStreamTransmitter *
+fs_loopback_stream_transmitter_newv (FsLoopbackTransmitter *transmitter,
+  guint n_parameters, GParameter *parameters, GError **error)
+{
+  FsLoopbackStreamTransmitter *streamtransmitter = NULL;
+
+  streamtransmitter = g_object_newv (FS_TYPE_LOOPBACK_STREAM_TRANSMITTER,
+    n_parameters, parameters);
+
+  if (!streamtransmitter) {
+    g_set_error (error, FS_ERROR, FS_ERROR_CONSTRUCTION,
+      "Could not build the stream transmitter");
+    return NULL;
+  }
+
+  streamtransmitter->priv->transmitter = transmitter;
+
+  if (!fs_loopback_stream_transmitter_build (streamtransmitter, error)) {
+    g_object_unref (streamtransmitter);
+    return NULL;
+  }
+
+  return streamtransmitter;
+}
+
+
+static gboolean
+fs_loopback_stream_transmitter_gather_local_candidates (
+    FsStreamTransmitter *streamtransmitter,
+    GError **error)
+{
+  static gint name_count = 0;
+  FsLoopbackStreamTransmitter *self =
+    FS_LOOPBACK_STREAM_TRANSMITTER (streamtransmitter);
+  GList *candidates = NULL;
+  GList *item;
+  gchar *default_name = NULL;
+  gboolean ret = TRUE;
+  guint c;
+
+  for (c = 1; c <= self->priv->transmitter->components; c++)
+  {
+    const gchar *name = NULL;
+
+    for (item = self->priv->preferred_local_candidates;
+         item;
+         item = g_list_next (item))
+    {
+      FsCandidate *candidate = item->data;
+
+      if (candidate->component_id == c && candidate->ip && candidate->ip[0])
+      {
+        name = candidate->ip;
+        break;
+      }
+    }
+
+    if (!name)
+    {
+      if (!default_name)
+        default_name = g_strdup_printf ("loopback-%d",
+            g_atomic_int_add (&name_count, 1));
+      name = default_name;
+    }
+
+    if (self->priv->src[c])
+    {
+      if (fs_loopback_transmitter_check_src (self->priv->transmitter,
+              self->priv->src[c], name))
+        goto add_candidate;
+      self->priv->src[c] = NULL;
+    }
+
+    self->priv->src[c] = fs_loopback_transmitter_get_src (
+        self->priv->transmitter, c, name, got_buffer_func, self, error);
+
+    if (self->priv->src[c] == NULL)
+    {
+      ret = FALSE;
+      goto out;
+    }
+
+  add_candidate:
+    candidates = g_list_append (candidates, fs_candidate_new (NULL, c,
+            FS_CANDIDATE_TYPE_HOST, FS_NETWORK_PROTOCOL_UDP, name, 0));
+  }
+
+  for (item = candidates; item; item = g_list_next (item))
+  {
+    FsCandidate *candidate = item->data;
+
+    GST_DEBUG ("Emitting new local candidate with name %s for component %u",
+        candidate->ip, candidate->component_id);
+    g_signal_emit_by_name (self, "new-local-candidate", candidate);
+  }
+
+  g_signal_emit_by_name (self, "local-candidates-prepared");
+
+ out:
+  fs_candidate_list_destroy (candidates);
+  g_free (default_name);
+
+  return ret;
+}
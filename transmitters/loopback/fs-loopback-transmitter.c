@@ -0,0 +1,882 @@
+/*
+ * Farstream - Farstream Loopback Transmitter
+ *
+ * fs-loopback-transmitter.c - A Farstream in-process loopback transmitter
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+/**
+ * SECTION:fs-loopback-transmitter
+ * @short_description: A transmitter between conferences of the same process
+ *
+ * This transmitter passes the buffers sent by one conference directly to
+ * another conference running in the same process. Each buffer is handed
+ * over by reference, its content is never copied.
+ *
+ * The streams receive on symbolic names that are shared by all of the
+ * loopback transmitters of the process.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "fs-loopback-transmitter.h"
+#include "fs-loopback-stream-transmitter.h"
+
+#include <farstream/fs-conference.h>
+#include <farstream/fs-plugin.h>
+
+#include <gst/app/gstappsrc.h>
+
+#include <string.h>
+
+GST_DEBUG_CATEGORY (fs_loopback_transmitter_debug);
+#define GST_CAT_DEFAULT fs_loopback_transmitter_debug
+
+/* Signals */
+enum
+{
+  LAST_SIGNAL
+};
+
+/* props */
+enum
+{
+  PROP_0,
+  PROP_GST_SINK,
+  PROP_GST_SRC,
+  PROP_COMPONENTS,
+  PROP_DO_TIMESTAMP
+};
+
+struct _FsLoopbackTransmitterPrivate
+{
+  /* We hold references to this element */
+  GstElement *gst_sink;
+  GstElement *gst_src;
+
+  /* We don't hold a reference to these elements, they are owned
+     by the bins */
+  /* They are tables of pointers, one per component */
+  GstElement **funnels;
+  GstElement **tees;
+
+  gboolean do_timestamp;
+};
+
+#define FS_LOOPBACK_TRANSMITTER_GET_PRIVATE(o)  \
+  (G_TYPE_INSTANCE_GET_PRIVATE ((o), FS_TYPE_LOOPBACK_TRANSMITTER,   \
+      FsLoopbackTransmitterPrivate))
+
+static void fs_loopback_transmitter_class_init (
+    FsLoopbackTransmitterClass *klass);
+static void fs_loopback_transmitter_init (FsLoopbackTransmitter *self);
+static void fs_loopback_transmitter_constructed (GObject *object);
+static void fs_loopback_transmitter_dispose (GObject *object);
+static void fs_loopback_transmitter_finalize (GObject *object);
+
+static void fs_loopback_transmitter_get_property (GObject *object,
+                                                guint prop_id,
+                                                GValue *value,
+                                                GParamSpec *pspec);
+static void fs_loopback_transmitter_set_property (GObject *object,
+                                                guint prop_id,
+                                                const GValue *value,
+                                                GParamSpec *pspec);
+
+static FsStreamTransmitter *fs_loopback_transmitter_new_stream_transmitter (
+    FsTransmitter *transmitter, FsParticipant *participant,
+    guint n_parameters, GParameter *parameters, GError **error);
+static GType fs_loopback_transmitter_get_stream_transmitter_type (
+    FsTransmitter *transmitter);
+
+
+static GObjectClass *parent_class = NULL;
+//static guint signals[LAST_SIGNAL] = { 0 };
+
+/*
+ * The names the streams receive on, shared by all of the loopback
+ * transmitters of the process.
+ * "component:name" -> appsrc, the table holds a reference to the appsrc
+ */
+
+G_LOCK_DEFINE_STATIC (registry);
+static GHashTable *registry = NULL;
+
+static gchar *
+registry_key (guint component, const gchar *name)
+{
+  return g_strdup_printf ("%u:%s", component, name);
+}
+
+static gboolean
+registry_add (guint component, const gchar *name, GstElement *appsrc)
+{
+  gchar *key = registry_key (component, name);
+  gboolean ret = FALSE;
+
+  G_LOCK (registry);
+  if (!registry)
+    registry = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+        gst_object_unref);
+
+  if (!g_hash_table_lookup (registry, key))
+  {
+    g_hash_table_insert (registry, key, gst_object_ref (appsrc));
+    key = NULL;
+    ret = TRUE;
+  }
+  G_UNLOCK (registry);
+
+  g_free (key);
+
+  return ret;
+}
+
+static void
+registry_remove (guint component, const gchar *name, GstElement *appsrc)
+{
+  gchar *key = registry_key (component, name);
+
+  G_LOCK (registry);
+  if (registry && g_hash_table_lookup (registry, key) == appsrc)
+    g_hash_table_remove (registry, key);
+  G_UNLOCK (registry);
+
+  g_free (key);
+}
+
+/* Returns a reference to the appsrc receiving on this name, if any */
+
+static GstElement *
+registry_lookup (guint component, const gchar *name)
+{
+  gchar *key = registry_key (component, name);
+  GstElement *appsrc = NULL;
+
+  G_LOCK (registry);
+  if (registry)
+    appsrc = g_hash_table_lookup (registry, key);
+  if (appsrc)
+    gst_object_ref (appsrc);
+  G_UNLOCK (registry);
+
+  g_free (key);
+
+  return appsrc;
+}
+
+/*
+ * Lets register the plugin
+ */
+
+static GType type = 0;
+
+GType
+fs_loopback_transmitter_get_type (void)
+{
+  g_assert (type);
+  return type;
+}
+
+static GType
+fs_loopback_transmitter_register_type (FsPlugin *module)
+{
+  static const GTypeInfo info = {
+    sizeof (FsLoopbackTransmitterClass),
+    NULL,
+    NULL,
+    (GClassInitFunc) fs_loopback_transmitter_class_init,
+    NULL,
+    NULL,
+    sizeof (FsLoopbackTransmitter),
+    0,
+    (GInstanceInitFunc) fs_loopback_transmitter_init
+  };
+
+  GST_DEBUG_CATEGORY_INIT (fs_loopback_transmitter_debug,
+      "fsloopbacktransmitter", 0,
+      "Farstream in-process loopback transmitter");
+
+  fs_loopback_stream_transmitter_register_type (module);
+
+  type = g_type_register_static (FS_TYPE_TRANSMITTER, "FsLoopbackTransmitter",
+      &info, 0);
+
+  return type;
+}
+
+FS_INIT_PLUGIN (loopback, transmitter)
+
+static void
+fs_loopback_transmitter_class_init (FsLoopbackTransmitterClass *klass)
+{
+  GObjectClass *gobject_class = (GObjectClass *) klass;
+  FsTransmitterClass *transmitter_class = FS_TRANSMITTER_CLASS (klass);
+
+  parent_class = g_type_class_peek_parent (klass);
+
+  gobject_class->set_property = fs_loopback_transmitter_set_property;
+  gobject_class->get_property = fs_loopback_transmitter_get_property;
+
+  gobject_class->constructed = fs_loopback_transmitter_constructed;
+
+  g_object_class_override_property (gobject_class, PROP_GST_SRC, "gst-src");
+  g_object_class_override_property (gobject_class, PROP_GST_SINK, "gst-sink");
+  g_object_class_override_property (gobject_class, PROP_COMPONENTS,
+    "components");
+  g_object_class_override_property (gobject_class, PROP_DO_TIMESTAMP,
+    "do-timestamp");
+
+  transmitter_class->new_stream_transmitter =
+    fs_loopback_transmitter_new_stream_transmitter;
+  transmitter_class->get_stream_transmitter_type =
+    fs_loopback_transmitter_get_stream_transmitter_type;
+
+  gobject_class->dispose = fs_loopback_transmitter_dispose;
+  gobject_class->finalize = fs_loopback_transmitter_finalize;
+
+  g_type_class_add_private (klass, sizeof (FsLoopbackTransmitterPrivate));
+}
+
+static void
+fs_loopback_transmitter_init (FsLoopbackTransmitter *self)
+{
+
+  /* member init */
+  self->priv = FS_LOOPBACK_TRANSMITTER_GET_PRIVATE (self);
+
+  self->components = 2;
+  self->priv->do_timestamp = TRUE;
+}
+
+static void
+fs_loopback_transmitter_constructed (GObject *object)
+{
+  FsLoopbackTransmitter *self = FS_LOOPBACK_TRANSMITTER_CAST (object);
+  FsTransmitter *trans = FS_TRANSMITTER_CAST (self);
+  GstPad *pad = NULL, *pad2 = NULL;
+  GstPad *ghostpad = NULL;
+  gchar *padname;
+  GstPadLinkReturn ret;
+  int c; /* component_id */
+
+
+  /* We waste one space in order to have the index be the component_id */
+  self->priv->funnels = g_new0 (GstElement *, self->components+1);
+  self->priv->tees = g_new0 (GstElement *, self->components+1);
+
+  /* First we need the src elemnet */
+
+  self->priv->gst_src = gst_bin_new (NULL);
+
+  if (!self->priv->gst_src) {
+    trans->construction_error = g_error_new (FS_ERROR,
+      FS_ERROR_CONSTRUCTION,
+      "Could not build the transmitter src bin");
+    return;
+  }
+
+  gst_object_ref (self->priv->gst_src);
+
+
+  /* Second, we do the sink element */
+
+  self->priv->gst_sink = gst_bin_new (NULL);
+
+  if (!self->priv->gst_sink) {
+    trans->construction_error = g_error_new (FS_ERROR,
+      FS_ERROR_CONSTRUCTION,
+      "Could not build the transmitter sink bin");
+    return;
+  }
+
+  g_object_set (G_OBJECT (self->priv->gst_sink),
+      "async-handling", TRUE,
+      NULL);
+
+  gst_object_ref (self->priv->gst_sink);
+
+  for (c = 1; c <= self->components; c++) {
+    GstElement *fakesink = NULL;
+
+    /* Lets create the RTP source funnel */
+
+    self->priv->funnels[c] = gst_element_factory_make ("funnel", NULL);
+
+    if (!self->priv->funnels[c]) {
+      trans->construction_error = g_error_new (FS_ERROR,
+        FS_ERROR_CONSTRUCTION,
+        "Could not make the funnel element");
+      return;
+    }
+
+    if (!gst_bin_add (GST_BIN (self->priv->gst_src),
+        self->priv->funnels[c])) {
+      trans->construction_error = g_error_new (FS_ERROR,
+        FS_ERROR_CONSTRUCTION,
+        "Could not add the funnel element to the transmitter src bin");
+    }
+
+    pad = gst_element_get_static_pad (self->priv->funnels[c], "src");
+    padname = g_strdup_printf ("src_%u", c);
+    ghostpad = gst_ghost_pad_new (padname, pad);
+    g_free (padname);
+    gst_object_unref (pad);
+
+    gst_pad_set_active (ghostpad, TRUE);
+    gst_element_add_pad (self->priv->gst_src, ghostpad);
+
+
+    /* Lets create the RTP sink tee */
+
+    self->priv->tees[c] = gst_element_factory_make ("tee", NULL);
+
+    if (!self->priv->tees[c]) {
+      trans->construction_error = g_error_new (FS_ERROR,
+        FS_ERROR_CONSTRUCTION,
+        "Could not make the tee element");
+      return;
+    }
+
+    if (!gst_bin_add (GST_BIN (self->priv->gst_sink),
+        self->priv->tees[c])) {
+      trans->construction_error = g_error_new (FS_ERROR,
+        FS_ERROR_CONSTRUCTION,
+        "Could not add the tee element to the transmitter sink bin");
+    }
+
+    pad = gst_element_get_static_pad (self->priv->tees[c], "sink");
+    padname = g_strdup_printf ("sink_%u", c);
+    ghostpad = gst_ghost_pad_new (padname, pad);
+    g_free (padname);
+    gst_object_unref (pad);
+
+    gst_pad_set_active (ghostpad, TRUE);
+    gst_element_add_pad (self->priv->gst_sink, ghostpad);
+
+    fakesink = gst_element_factory_make ("fakesink", NULL);
+
+    if (!fakesink) {
+      trans->construction_error = g_error_new (FS_ERROR,
+        FS_ERROR_CONSTRUCTION,
+        "Could not make the fakesink element");
+      return;
+    }
+
+    g_object_set (fakesink,
+        "async", FALSE,
+        "sync" , FALSE,
+        NULL);
+
+    if (!gst_bin_add (GST_BIN (self->priv->gst_sink), fakesink))
+    {
+      gst_object_unref (fakesink);
+      trans->construction_error = g_error_new (FS_ERROR,
+          FS_ERROR_CONSTRUCTION,
+          "Could not add the fakesink element to the transmitter sink bin");
+      return;
+    }
+
+    pad = gst_element_get_request_pad (self->priv->tees[c], "src_%u");
+    pad2 = gst_element_get_static_pad (fakesink, "sink");
+
+    ret = gst_pad_link (pad, pad2);
+
+    gst_object_unref (pad2);
+    gst_object_unref (pad);
+
+    if (GST_PAD_LINK_FAILED(ret)) {
+      trans->construction_error = g_error_new (FS_ERROR,
+          FS_ERROR_CONSTRUCTION,
+          "Could not link the tee to the fakesink");
+      return;
+    }
+  }
+
+  GST_CALL_PARENT (G_OBJECT_CLASS, constructed, (object));
+}
+
+static void
+fs_loopback_transmitter_dispose (GObject *object)
+{
+  FsLoopbackTransmitter *self = FS_LOOPBACK_TRANSMITTER (object);
+
+  if (self->priv->gst_src) {
+    gst_object_unref (self->priv->gst_src);
+    self->priv->gst_src = NULL;
+  }
+
+  if (self->priv->gst_sink) {
+    gst_object_unref (self->priv->gst_sink);
+    self->priv->gst_sink = NULL;
+  }
+
+  parent_class->dispose (object);
+}
+
+static void
+fs_loopback_transmitter_finalize (GObject *object)
+{
+  FsLoopbackTransmitter *self = FS_LOOPBACK_TRANSMITTER (object);
+
+  if (self->priv->funnels) {
+    g_free (self->priv->funnels);
+    self->priv->funnels = NULL;
+  }
+
+  if (self->priv->tees) {
+    g_free (self->priv->tees);
+    self->priv->tees = NULL;
+  }
+
+  parent_class->finalize (object);
+}
+
+static void
+fs_loopback_transmitter_get_property (GObject *object,
+                             guint prop_id,
+                             GValue *value,
+                             GParamSpec *pspec)
+{
+  FsLoopbackTransmitter *self = FS_LOOPBACK_TRANSMITTER (object);
+
+  switch (prop_id) {
+    case PROP_GST_SINK:
+      g_value_set_object (value, self->priv->gst_sink);
+      break;
+    case PROP_GST_SRC:
+      g_value_set_object (value, self->priv->gst_src);
+      break;
+    case PROP_COMPONENTS:
+      g_value_set_uint (value, self->components);
+      break;
+    case PROP_DO_TIMESTAMP:
+      g_value_set_boolean (value, self->priv->do_timestamp);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+}
+
+static void
+fs_loopback_transmitter_set_property (GObject *object,
+                                    guint prop_id,
+                                    const GValue *value,
+                                    GParamSpec *pspec)
+{
+  FsLoopbackTransmitter *self = FS_LOOPBACK_TRANSMITTER (object);
+
+  switch (prop_id) {
+    case PROP_COMPONENTS:
+      self->components = g_value_get_uint (value);
+      break;
+    case PROP_DO_TIMESTAMP:
+      self->priv->do_timestamp = g_value_get_boolean (value);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+}
+
+
+/**
+ * fs_loopback_transmitter_new_stream_loopback_transmitter:
+ * @transmitter: a #FsTranmitter
+ * @participant: the #FsParticipant for which the #FsStream using this
+ * new #FsStreamTransmitter is created
+ *
+ * This function will create a new #FsStreamTransmitter element for a
+ * specific participant for this #FsLoopbackTransmitter
+ *
+ * Returns: a new #FsStreamTransmitter
+ */
+
+static FsStreamTransmitter *
+fs_loopback_transmitter_new_stream_transmitter (FsTransmitter *transmitter,
+  FsParticipant *participant, guint n_parameters, GParameter *parameters,
+  GError **error)
+{
+  FsLoopbackTransmitter *self = FS_LOOPBACK_TRANSMITTER (transmitter);
+
+  return FS_STREAM_TRANSMITTER (fs_loopback_stream_transmitter_newv (
+        self, n_parameters, parameters, error));
+}
+
+static GType
+fs_loopback_transmitter_get_stream_transmitter_type (
+    FsTransmitter *transmitter)
+{
+  return FS_TYPE_LOOPBACK_STREAM_TRANSMITTER;
+}
+
+
+/*
+ * The receiving end: an appsrc in our src bin that the senders of the
+ * other transmitters push their buffers into.
+ */
+
+struct _LoopbackSrc {
+  guint component;
+  gchar *name;
+  GstElement *src;
+  GstPad *funnelpad;
+  gboolean registered;
+
+  loopback_got_buffer got_buffer_func;
+  gpointer cb_data;
+  gulong buffer_probe;
+};
+
+
+static GstPadProbeReturn
+src_buffer_probe_cb (GstPad *pad, GstPadProbeInfo *info, gpointer user_data)
+{
+  LoopbackSrc *src = user_data;
+  GstBuffer *buffer = GST_PAD_PROBE_INFO_BUFFER (info);
+
+  src->got_buffer_func (buffer, src->component, src->cb_data);
+
+  return GST_PAD_PROBE_OK;
+}
+
+
+LoopbackSrc *
+fs_loopback_transmitter_get_src (FsLoopbackTransmitter *self,
+    guint component,
+    const gchar *name,
+    loopback_got_buffer got_buffer_func,
+    gpointer cb_data,
+    GError **error)
+{
+  LoopbackSrc *src = g_slice_new0 (LoopbackSrc);
+  GstElement *elem;
+  GstPad *pad;
+
+  src->component = component;
+  src->got_buffer_func = got_buffer_func;
+  src->cb_data = cb_data;
+
+  src->name = g_strdup (name);
+
+  elem = gst_element_factory_make ("appsrc", NULL);
+  if (!elem)
+  {
+    g_set_error (error, FS_ERROR, FS_ERROR_CONSTRUCTION,
+        "Could not make appsrc");
+    goto error;
+  }
+
+  g_object_set (elem,
+      "format", GST_FORMAT_TIME,
+      "do-timestamp", self->priv->do_timestamp,
+      "is-live", TRUE,
+      NULL);
+
+  if (!gst_bin_add (GST_BIN (self->priv->gst_src), elem))
+  {
+    g_set_error (error, FS_ERROR, FS_ERROR_CONSTRUCTION,
+        "Could not add appsrc to bin");
+    gst_object_unref (elem);
+    goto error;
+  }
+
+  src->src = elem;
+
+  src->funnelpad = gst_element_get_request_pad (self->priv->funnels[component],
+      "sink_%u");
+
+  if (!src->funnelpad)
+  {
+    g_set_error (error, FS_ERROR, FS_ERROR_CONSTRUCTION,
+        "Could not get funnelpad");
+    goto error;
+  }
+
+  pad = gst_element_get_static_pad (src->src, "src");
+  if (GST_PAD_LINK_FAILED (gst_pad_link (pad, src->funnelpad)))
+  {
+    g_set_error (error, FS_ERROR, FS_ERROR_CONSTRUCTION,
+        "Could not link appsrc and funnel");
+    gst_object_unref (pad);
+    goto error;
+  }
+
+  gst_object_unref (pad);
+
+  if (got_buffer_func)
+    src->buffer_probe = gst_pad_add_probe (src->funnelpad,
+        GST_PAD_PROBE_TYPE_BUFFER,
+        src_buffer_probe_cb, src, NULL);
+
+  if (!gst_element_sync_state_with_parent (src->src))
+  {
+    g_set_error (error, FS_ERROR, FS_ERROR_CONSTRUCTION,
+        "Could not sync the state of the new appsrc with its parent");
+    goto error;
+  }
+
+  if (!registry_add (component, name, src->src))
+  {
+    g_set_error (error, FS_ERROR, FS_ERROR_INVALID_ARGUMENTS,
+        "The name %s is already used by another stream for component %u",
+        name, component);
+    goto error;
+  }
+  src->registered = TRUE;
+
+  return src;
+
+ error:
+  fs_loopback_transmitter_check_src (self, src, NULL);
+  return NULL;
+}
+
+/*
+ * Returns: %TRUE if the name is the same, other %FALSE and frees the
+ * LoopbackSrc
+ */
+
+gboolean
+fs_loopback_transmitter_check_src (FsLoopbackTransmitter *self,
+    LoopbackSrc *src, const gchar *name)
+{
+  if (name && !strcmp (name, src->name))
+    return TRUE;
+
+  /* Senders that still hold the appsrc will get FLUSHING once it is stopped
+   * and will look the name up again */
+  if (src->registered)
+    registry_remove (src->component, src->name, src->src);
+  src->registered = FALSE;
+
+  if (src->buffer_probe)
+    gst_pad_remove_probe (src->funnelpad, src->buffer_probe);
+  src->buffer_probe = 0;
+
+  if (src->funnelpad) {
+    gst_element_release_request_pad (self->priv->funnels[src->component],
+        src->funnelpad);
+    gst_object_unref (src->funnelpad);
+  }
+  src->funnelpad = NULL;
+
+  if (src->src)
+  {
+    gst_element_set_locked_state (src->src, TRUE);
+    gst_element_set_state (src->src, GST_STATE_NULL);
+    gst_bin_remove (GST_BIN (self->priv->gst_src), src->src);
+  }
+  src->src = NULL;
+
+  g_free (src->name);
+  g_slice_free (LoopbackSrc, src);
+
+  return FALSE;
+}
+
+
+/*
+ * The sending end: a fakesink on our tee whose buffers are pushed by
+ * reference into the appsrc registered under the name.
+ */
+
+struct _LoopbackSink {
+  guint component;
+  gchar *name;
+  GstElement *sink;
+  GstPad *teepad;
+  gulong buffer_probe;
+  gboolean do_timestamp;
+
+  /* Set atomically */
+  gint sending;
+
+  /* Only touched from the streaming thread of the fakesink, or once it
+   * has been stopped */
+  GstElement *peer;
+};
+
+
+static GstPadProbeReturn
+sink_buffer_probe_cb (GstPad *pad, GstPadProbeInfo *info, gpointer user_data)
+{
+  LoopbackSink *sink = user_data;
+  GstBuffer *buffer = GST_PAD_PROBE_INFO_BUFFER (info);
+  GstFlowReturn ret;
+
+  if (!g_atomic_int_get (&sink->sending))
+    return GST_PAD_PROBE_OK;
+
+  if (!sink->peer)
+    sink->peer = registry_lookup (sink->component, sink->name);
+  if (!sink->peer)
+    return GST_PAD_PROBE_OK;
+
+  if (sink->do_timestamp)
+  {
+    /* Only the metadata is copied, the memory is shared, the timestamps
+     * are from the other pipeline so let the appsrc put its own */
+    buffer = gst_buffer_copy (buffer);
+    GST_BUFFER_PTS (buffer) = GST_CLOCK_TIME_NONE;
+    GST_BUFFER_DTS (buffer) = GST_CLOCK_TIME_NONE;
+  }
+  else
+  {
+    buffer = gst_buffer_ref (buffer);
+  }
+
+  ret = gst_app_src_push_buffer (GST_APP_SRC (sink->peer), buffer);
+
+  if (ret == GST_FLOW_FLUSHING)
+  {
+    /* The receiver has gone away or is stopped, look it up again next time */
+    gst_object_unref (sink->peer);
+    sink->peer = NULL;
+  }
+
+  return GST_PAD_PROBE_OK;
+}
+
+
+LoopbackSink *
+fs_loopback_transmitter_get_sink (FsLoopbackTransmitter *self,
+    guint component,
+    const gchar *name,
+    GError **error)
+{
+  LoopbackSink *sink = g_slice_new0 (LoopbackSink);
+  GstElement *elem;
+  GstPad *pad;
+
+  GST_DEBUG ("Trying to add loopback sink for c:%u name %s", component, name);
+
+  sink->component = component;
+  sink->name = g_strdup (name);
+  sink->do_timestamp = self->priv->do_timestamp;
+  sink->sending = TRUE;
+
+  elem = gst_element_factory_make ("fakesink", NULL);
+  if (!elem)
+  {
+    g_set_error (error, FS_ERROR, FS_ERROR_CONSTRUCTION,
+        "Could not make fakesink");
+    goto error;
+  }
+
+  g_object_set (elem,
+      "async", FALSE,
+      "sync" , FALSE,
+      NULL);
+
+  if (!gst_bin_add (GST_BIN (self->priv->gst_sink), elem))
+  {
+    g_set_error (error, FS_ERROR, FS_ERROR_CONSTRUCTION,
+        "Could not add fakesink to bin");
+    gst_object_unref (elem);
+    goto error;
+  }
+
+  sink->sink = elem;
+
+  pad = gst_element_get_static_pad (sink->sink, "sink");
+  sink->buffer_probe = gst_pad_add_probe (pad, GST_PAD_PROBE_TYPE_BUFFER,
+      sink_buffer_probe_cb, sink, NULL);
+  gst_object_unref (pad);
+
+  if (!gst_element_sync_state_with_parent (sink->sink))
+  {
+    g_set_error (error, FS_ERROR, FS_ERROR_CONSTRUCTION,
+        "Could not sync the state of the new fakesink with its parent");
+    goto error;
+  }
+
+  sink->teepad = gst_element_get_request_pad (self->priv->tees[component],
+      "src_%u");
+
+  if (!sink->teepad)
+  {
+    g_set_error (error, FS_ERROR, FS_ERROR_CONSTRUCTION,
+        "Could not create a tee pad");
+    goto error;
+  }
+
+  pad = gst_element_get_static_pad (sink->sink, "sink");
+  if (GST_PAD_LINK_FAILED (gst_pad_link (sink->teepad, pad)))
+  {
+    g_set_error (error, FS_ERROR, FS_ERROR_CONSTRUCTION,
+        "Could not link tee and fakesink");
+    gst_object_unref (pad);
+    goto error;
+  }
+
+  gst_object_unref (pad);
+
+  return sink;
+
+ error:
+  fs_loopback_transmitter_check_sink (self, sink, NULL);
+  return NULL;
+}
+
+/*
+ * Returns: %TRUE if the name is the same, other %FALSE and frees the
+ * LoopbackSink
+ */
+
+gboolean
+fs_loopback_transmitter_check_sink (FsLoopbackTransmitter *self,
+    LoopbackSink *sink, const gchar *name)
+{
+  if (name && !strcmp (name, sink->name))
+    return TRUE;
+
+  if (sink->teepad)
+  {
+    gst_element_release_request_pad (self->priv->tees[sink->component],
+        sink->teepad);
+    gst_object_unref (sink->teepad);
+  }
+  sink->teepad = NULL;
+
+  if (sink->sink)
+  {
+    gst_element_set_locked_state (sink->sink, TRUE);
+    gst_element_set_state (sink->sink, GST_STATE_NULL);
+    gst_bin_remove (GST_BIN (self->priv->gst_sink), sink->sink);
+  }
+  sink->sink = NULL;
+
+  if (sink->peer)
+    gst_object_unref (sink->peer);
+  sink->peer = NULL;
+
+  g_free (sink->name);
+  g_slice_free (LoopbackSink, sink);
+
+  return FALSE;
+}
+
+
+void
+fs_loopback_transmitter_sink_set_sending (FsLoopbackTransmitter *self,
+    LoopbackSink *sink, gboolean sending)
+{
+  g_atomic_int_set (&sink->sending, sending);
+}
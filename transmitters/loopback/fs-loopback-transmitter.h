@@ -0,0 +1,114 @@
+/*
+ * Farstream - Farstream Loopback Transmitter
+ *
+ * fs-loopback-transmitter.h - A Farstream in-process loopback transmitter
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#ifndef __FS_LOOPBACK_TRANSMITTER_H__
+#define __FS_LOOPBACK_TRANSMITTER_H__
+
+#include <farstream/fs-transmitter.h>
+
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+
+/* TYPE MACROS */
+#define FS_TYPE_LOOPBACK_TRANSMITTER \
+  (fs_loopback_transmitter_get_type ())
+#define FS_LOOPBACK_TRANSMITTER(obj) \
+  (G_TYPE_CHECK_INSTANCE_CAST((obj), FS_TYPE_LOOPBACK_TRANSMITTER, \
+    FsLoopbackTransmitter))
+#define FS_LOOPBACK_TRANSMITTER_CLASS(klass) \
+  (G_TYPE_CHECK_CLASS_CAST((klass), FS_TYPE_LOOPBACK_TRANSMITTER, \
+    FsLoopbackTransmitterClass))
+#define FS_IS_LOOPBACK_TRANSMITTER(obj) \
+  (G_TYPE_CHECK_INSTANCE_TYPE((obj), FS_TYPE_LOOPBACK_TRANSMITTER))
+#define FS_IS_LOOPBACK_TRANSMITTER_CLASS(klass) \
+  (G_TYPE_CHECK_CLASS_TYPE((klass), FS_TYPE_LOOPBACK_TRANSMITTER))
+#define FS_LOOPBACK_TRANSMITTER_GET_CLASS(obj) \
+  (G_TYPE_INSTANCE_GET_CLASS ((obj), FS_TYPE_LOOPBACK_TRANSMITTER, \
+    FsLoopbackTransmitterClass))
+#define FS_LOOPBACK_TRANSMITTER_CAST(obj) ((FsLoopbackTransmitter *) (obj))
+
+typedef struct _FsLoopbackTransmitter FsLoopbackTransmitter;
+typedef struct _FsLoopbackTransmitterClass FsLoopbackTransmitterClass;
+typedef struct _FsLoopbackTransmitterPrivate FsLoopbackTransmitterPrivate;
+
+/**
+ * FsLoopbackTransmitterClass:
+ * @parent_class: Our parent
+ *
+ * The in-process loopback transmitter class
+ */
+
+struct _FsLoopbackTransmitterClass
+{
+  FsTransmitterClass parent_class;
+};
+
+/**
+ * FsLoopbackTransmitter:
+ * @parent: Parent object
+ *
+ * All members are private, access them using methods and properties
+ */
+struct _FsLoopbackTransmitter
+{
+  FsTransmitter parent;
+
+  /* The number of components (READONLY) */
+  gint components;
+
+  /*< private >*/
+  FsLoopbackTransmitterPrivate *priv;
+};
+
+GType fs_loopback_transmitter_get_type (void);
+
+typedef struct _LoopbackSrc LoopbackSrc;
+typedef struct _LoopbackSink LoopbackSink;
+
+typedef void (*loopback_got_buffer) (GstBuffer *buffer, guint component,
+    gpointer data);
+
+LoopbackSrc *fs_loopback_transmitter_get_src (FsLoopbackTransmitter *self,
+    guint component,
+    const gchar *name,
+    loopback_got_buffer got_buffer_func,
+    gpointer cb_data,
+    GError **error);
+
+gboolean fs_loopback_transmitter_check_src (FsLoopbackTransmitter *self,
+    LoopbackSrc *src,
+    const gchar *name);
+
+LoopbackSink *fs_loopback_transmitter_get_sink (FsLoopbackTransmitter *self,
+    guint component,
+    const gchar *name,
+    GError **error);
+
+gboolean fs_loopback_transmitter_check_sink (FsLoopbackTransmitter *self,
+    LoopbackSink *sink,
+    const gchar *name);
+
+void fs_loopback_transmitter_sink_set_sending (FsLoopbackTransmitter *self,
+    LoopbackSink *sink, gboolean sending);
+
+G_END_DECLS
+
+#endif /* __FS_LOOPBACK_TRANSMITTER_H__ */
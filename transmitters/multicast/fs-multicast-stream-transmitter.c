@@ -50,6 +50,13 @@
  * Packets sent will be looped back (so that other clients on the same session
  * can be on the same machine.
  *
+ * If the "base-ip" of the remote candidate is set, the stream will only
+ * receive the packets sent by that address to the group, using
+ * source-specific multicast (IGMPv3). The filtering is done by the kernel
+ * and the network, so the packets from other senders never reach the
+ * application. Streams with different sources for the same group and port
+ * use different sockets.
+ *
  * The name of this transmitter is "multicast".
  */
 
@@ -227,6 +234,7 @@ static void
 fs_multicast_stream_transmitter_dispose (GObject *object)
 {
   FsMulticastStreamTransmitter *self = FS_MULTICAST_STREAM_TRANSMITTER (object);
+  gint c; /* component_id */
 
   if (self->priv->disposed)
     /* If dispose did already run, return. */
@@ -234,14 +242,18 @@ fs_multicast_stream_transmitter_dispose (GObject *object)
 
   if (self->priv->udpsocks)
   {
-    if (self->priv->udpsocks[1])
+    for (c = 1; c <= self->priv->transmitter->components; c++)
     {
-      if (self->priv->sending)
+      if (!self->priv->udpsocks[c])
+        continue;
+
+      /* The RTCP sockets are always sending */
+      if (c != 1 || self->priv->sending)
         fs_multicast_transmitter_udpsock_dec_sending (
-            self->priv->udpsocks[1]);
+            self->priv->udpsocks[c]);
       fs_multicast_transmitter_put_udpsock (self->priv->transmitter,
-          self->priv->udpsocks[1], self->priv->remote_candidate[1]->ttl);
-      self->priv->udpsocks[1] = NULL;
+          self->priv->udpsocks[c], self->priv->remote_candidate[c]->ttl);
+      self->priv->udpsocks[c] = NULL;
     }
   }
 
@@ -460,7 +472,8 @@ fs_multicast_stream_transmitter_add_remote_candidate (
       self->priv->remote_candidate[candidate->component_id];
     if (old_candidate->port == candidate->port &&
         old_candidate->ttl == candidate->ttl &&
-        !strcmp (old_candidate->ip, candidate->ip))
+        !strcmp (old_candidate->ip, candidate->ip) &&
+        !g_strcmp0 (old_candidate->base_ip, candidate->base_ip))
     {
       GST_DEBUG ("Re-set the same candidate, ignoring");
       FS_MULTICAST_STREAM_TRANSMITTER_UNLOCK (self);
@@ -481,6 +494,7 @@ fs_multicast_stream_transmitter_add_remote_candidate (
       candidate->component_id,
       self->priv->local_candidate[candidate->component_id]->ip,
       candidate->ip,
+      candidate->base_ip,
       candidate->port,
       candidate->ttl,
       candidate->component_id == 1 ? self->priv->sending : TRUE,
@@ -491,10 +505,9 @@ fs_multicast_stream_transmitter_add_remote_candidate (
 
   FS_MULTICAST_STREAM_TRANSMITTER_LOCK (self);
 
-  if (self->priv->udpsocks[candidate->component_id] &&
-      candidate->component_id == 1)
+  if (self->priv->udpsocks[candidate->component_id])
   {
-    if (self->priv->sending)
+    if (candidate->component_id != 1 || self->priv->sending)
       fs_multicast_transmitter_udpsock_dec_sending (
           self->priv->udpsocks[candidate->component_id]);
     fs_multicast_transmitter_put_udpsock (self->priv->transmitter,
@@ -91,7 +91,8 @@ struct _FsMulticastTransmitterPrivate
   GstElement **udpsink_tees;
 
   GMutex mutex;
-  GList **udpsocks;
+  /* One table per component, udpsock key -> UdpSock */
+  GHashTable **udpsocks;
 
   gint type_of_service;
   gboolean do_timestamp;
@@ -242,7 +243,7 @@ fs_multicast_transmitter_constructed (GObject *object)
   /* We waste one space in order to have the index be the component_id */
   self->priv->udpsrc_funnels = g_new0 (GstElement *, self->components+1);
   self->priv->udpsink_tees = g_new0 (GstElement *, self->components+1);
-  self->priv->udpsocks = g_new0 (GList *, self->components+1);
+  self->priv->udpsocks = g_new0 (GHashTable *, self->components+1);
 
   /* First we need the src elemnet */
 
@@ -278,6 +279,8 @@ fs_multicast_transmitter_constructed (GObject *object)
   for (c = 1; c <= self->components; c++) {
     GstElement *fakesink = NULL;
 
+    self->priv->udpsocks[c] = g_hash_table_new (g_str_hash, g_str_equal);
+
     /* Lets create the RTP source funnel */
 
     self->priv->udpsrc_funnels[c] = gst_element_factory_make ("funnel", NULL);
@@ -417,6 +420,11 @@ fs_multicast_transmitter_finalize (GObject *object)
   }
 
   if (self->priv->udpsocks) {
+    gint c;
+
+    for (c = 1; c <= self->components; c++)
+      if (self->priv->udpsocks[c])
+        g_hash_table_unref (self->priv->udpsocks[c]);
     g_free (self->priv->udpsocks);
     self->priv->udpsocks = NULL;
   }
@@ -525,7 +533,11 @@ struct _UdpSock {
 
   gchar *local_ip;
   gchar *multicast_ip;
+  gchar *source_ip;
   guint16 port;
+
+  /* The key in the table of the transmitter */
+  gchar *key;
   /* Protected by the transmitter mutex */
   guint8 current_ttl;
 
@@ -578,10 +590,17 @@ _ip_string_into_sockaddr_in (const gchar *ip_as_string,
   return ret;
 }
 
+/*
+ * If @source_ip is set, the socket only joins the group for that source
+ * (IGMPv3 source-specific multicast), the kernel then drops the packets of
+ * every other sender
+ */
+
 static gint
 _bind_port (
     const gchar *local_ip,
     const gchar *multicast_ip,
+    const gchar *source_ip,
     guint16 port,
     guchar ttl,
     int type_of_service,
@@ -597,6 +616,9 @@ _bind_port (
 #else
   struct ip_mreq mreq;
 #endif
+#ifdef IP_ADD_SOURCE_MEMBERSHIP
+  struct ip_mreq_source mreq_source;
+#endif
 
   address.sin_family = AF_INET;
   address.sin_addr.s_addr = INADDR_ANY;
@@ -632,6 +654,33 @@ _bind_port (
   mreq.imr_ifindex = 0;
 #endif
 
+  if (source_ip)
+  {
+#ifdef IP_ADD_SOURCE_MEMBERSHIP
+    struct sockaddr_in tmpaddr;
+
+    if (!_ip_string_into_sockaddr_in (source_ip, &tmpaddr, error))
+      goto error;
+
+    memset (&mreq_source, 0, sizeof (mreq_source));
+    memcpy (&mreq_source.imr_multiaddr, &mreq.imr_multiaddr,
+        sizeof (mreq_source.imr_multiaddr));
+    memcpy (&mreq_source.imr_sourceaddr, &tmpaddr.sin_addr,
+        sizeof (mreq_source.imr_sourceaddr));
+#ifdef HAVE_IP_MREQN
+    memcpy (&mreq_source.imr_interface, &mreq.imr_address,
+        sizeof (mreq_source.imr_interface));
+#else
+    memcpy (&mreq_source.imr_interface, &mreq.imr_interface,
+        sizeof (mreq_source.imr_interface));
+#endif
+#else
+    g_set_error (error, FS_ERROR, FS_ERROR_INVALID_ARGUMENTS,
+        "Source-specific multicast is not supported on this platform");
+    goto error;
+#endif
+  }
+
   if ((sock = socket (AF_INET, SOCK_DGRAM, IPPROTO_UDP)) <= 0) {
     g_set_error (error, FS_ERROR, FS_ERROR_NETWORK,
       "Error creating socket: %s", g_strerror (errno));
@@ -676,6 +725,20 @@ _bind_port (
   }
 #endif
 
+#ifdef IP_ADD_SOURCE_MEMBERSHIP
+  if (source_ip)
+  {
+    if (setsockopt (sock, IPPROTO_IP, IP_ADD_SOURCE_MEMBERSHIP,
+            (const void *)&mreq_source, sizeof (mreq_source)) < 0)
+    {
+      g_set_error (error, FS_ERROR, FS_ERROR_INVALID_ARGUMENTS,
+          "Could not join the socket to the multicast group %s"
+          " for source %s: %s", multicast_ip, source_ip, g_strerror (errno));
+      goto error;
+    }
+  }
+  else
+#endif
   if (setsockopt (sock, IPPROTO_IP, IP_ADD_MEMBERSHIP,
           (const void *)&mreq, sizeof (mreq)) < 0)
   {
@@ -810,50 +873,48 @@ _create_sinksource (gchar *elementname, GstBin *bin,
   return NULL;
 }
 
+/*
+ * The TTL is not part of the key, a socket is shared between streams with
+ * different TTLs and uses the highest one
+ */
+
+static gchar *
+_udpsock_key (const gchar *local_ip, const gchar *multicast_ip,
+    const gchar *source_ip, guint16 port)
+{
+  return g_strdup_printf ("%s/%s/%s/%u", local_ip ? local_ip : "",
+      multicast_ip, source_ip ? source_ip : "", port);
+}
+
 static UdpSock *
 fs_multicast_transmitter_get_udpsock_locked (FsMulticastTransmitter *trans,
     guint component_id,
-    const gchar *local_ip,
-    const gchar *multicast_ip,
-    guint16 port,
+    const gchar *key,
     guint8 ttl,
-    gboolean sending,
     GError **error)
 {
   UdpSock *udpsock;
-  GList *udpsock_e;
 
-  for (udpsock_e = g_list_first (trans->priv->udpsocks[component_id]);
-       udpsock_e;
-       udpsock_e = g_list_next (udpsock_e))
+  udpsock = g_hash_table_lookup (trans->priv->udpsocks[component_id], key);
+  if (!udpsock)
+    return NULL;
+
+  if (ttl > udpsock->current_ttl)
   {
-    udpsock = udpsock_e->data;
 
-    if (port == udpsock->port &&
-        !strcmp (multicast_ip, udpsock->multicast_ip) &&
-        ((local_ip == NULL && udpsock->local_ip == NULL) ||
-            (local_ip && udpsock->local_ip &&
-                !strcmp (local_ip, udpsock->local_ip))))
+    if (setsockopt (udpsock->fd, IPPROTO_IP, IP_MULTICAST_TTL,
+            (const void *)&ttl, sizeof (ttl)) < 0)
     {
-      if (ttl > udpsock->current_ttl)
-      {
-
-        if (setsockopt (udpsock->fd, IPPROTO_IP, IP_MULTICAST_TTL,
-                (const void *)&ttl, sizeof (ttl)) < 0)
-        {
-          g_set_error (error, FS_ERROR, FS_ERROR_INVALID_ARGUMENTS,
-              "Error setting the multicast TTL: %s",
-              g_strerror (errno));
-          return NULL;
-        }
-        udpsock->current_ttl = ttl;
-      }
-      g_byte_array_append (udpsock->ttls, &ttl, 1);
-
-      return udpsock;
+      g_set_error (error, FS_ERROR, FS_ERROR_INVALID_ARGUMENTS,
+          "Error setting the multicast TTL: %s",
+          g_strerror (errno));
+      return NULL;
     }
+    udpsock->current_ttl = ttl;
   }
-  return NULL;
+  g_byte_array_append (udpsock->ttls, &ttl, 1);
+
+  return udpsock;
 }
 
 UdpSock *
@@ -861,6 +922,7 @@ fs_multicast_transmitter_get_udpsock (FsMulticastTransmitter *trans,
     guint component_id,
     const gchar *local_ip,
     const gchar *multicast_ip,
+    const gchar *source_ip,
     guint16 port,
     guint8 ttl,
     gboolean sending,
@@ -869,6 +931,7 @@ fs_multicast_transmitter_get_udpsock (FsMulticastTransmitter *trans,
   UdpSock *udpsock;
   UdpSock *tmpudpsock;
   GError *local_error = NULL;
+  gchar *key;
   int tos;
 
   /* First lets check if we already have one */
@@ -879,20 +942,24 @@ fs_multicast_transmitter_get_udpsock (FsMulticastTransmitter *trans,
     return NULL;
   }
 
+  key = _udpsock_key (local_ip, multicast_ip, source_ip, port);
+
   FS_MULTICAST_TRANSMITTER_LOCK (trans);
   udpsock = fs_multicast_transmitter_get_udpsock_locked (trans, component_id,
-      local_ip, multicast_ip, port, ttl, sending, &local_error);
+      key, ttl, &local_error);
   tos = trans->priv->type_of_service;
   FS_MULTICAST_TRANSMITTER_UNLOCK (trans);
 
   if (local_error)
   {
     g_propagate_error (error, local_error);
+    g_free (key);
     return NULL;
   }
 
   if (udpsock)
   {
+    g_free (key);
     if (sending)
       fs_multicast_transmitter_udpsock_inc_sending (udpsock);
     return udpsock;
@@ -902,6 +969,8 @@ fs_multicast_transmitter_get_udpsock (FsMulticastTransmitter *trans,
 
   udpsock->local_ip = g_strdup (local_ip);
   udpsock->multicast_ip = g_strdup (multicast_ip);
+  udpsock->source_ip = g_strdup (source_ip);
+  udpsock->key = key;
   udpsock->fd = -1;
   udpsock->component_id = component_id;
   udpsock->port = port;
@@ -911,7 +980,8 @@ fs_multicast_transmitter_get_udpsock (FsMulticastTransmitter *trans,
 
   /* Now lets bind both ports */
 
-  udpsock->fd = _bind_port (local_ip, multicast_ip, port, ttl, tos, error);
+  udpsock->fd = _bind_port (local_ip, multicast_ip, source_ip, port, ttl, tos,
+      error);
   if (udpsock->fd < 0)
     goto error;
 
@@ -944,7 +1014,7 @@ fs_multicast_transmitter_get_udpsock (FsMulticastTransmitter *trans,
   FS_MULTICAST_TRANSMITTER_LOCK (trans);
   /* Check if someone else has added the same thing at the same time */
   tmpudpsock = fs_multicast_transmitter_get_udpsock_locked (trans, component_id,
-      local_ip, multicast_ip, port, ttl, sending, &local_error);
+      udpsock->key, ttl, &local_error);
 
   if (tmpudpsock || local_error)
   {
@@ -960,8 +1030,8 @@ fs_multicast_transmitter_get_udpsock (FsMulticastTransmitter *trans,
     return tmpudpsock;
   }
 
-  trans->priv->udpsocks[component_id] =
-    g_list_prepend (trans->priv->udpsocks[component_id], udpsock);
+  g_hash_table_insert (trans->priv->udpsocks[component_id], udpsock->key,
+      udpsock);
   FS_MULTICAST_TRANSMITTER_UNLOCK (trans);
 
   if (sending)
@@ -1026,8 +1096,10 @@ fs_multicast_transmitter_put_udpsock (FsMulticastTransmitter *trans,
     return;
   }
 
-  trans->priv->udpsocks[udpsock->component_id] =
-    g_list_remove (trans->priv->udpsocks[udpsock->component_id], udpsock);
+  if (g_hash_table_lookup (trans->priv->udpsocks[udpsock->component_id],
+          udpsock->key) == udpsock)
+    g_hash_table_remove (trans->priv->udpsocks[udpsock->component_id],
+        udpsock->key);
 
   FS_MULTICAST_TRANSMITTER_UNLOCK (trans);
 
@@ -1077,7 +1149,9 @@ fs_multicast_transmitter_put_udpsock (FsMulticastTransmitter *trans,
 
   g_byte_array_free (udpsock->ttls, TRUE);
   g_free (udpsock->multicast_ip);
+  g_free (udpsock->source_ip);
   g_free (udpsock->local_ip);
+  g_free (udpsock->key);
   g_slice_free (UdpSock, udpsock);
 }
 
@@ -1136,14 +1210,14 @@ fs_multicast_transmitter_set_type_of_service (FsMulticastTransmitter *self,
 
   self->priv->type_of_service = tos;
 
-  for (i = 0; i < self->components; i++)
+  for (i = 1; i <= self->components; i++)
   {
-    GList *item;
+    GHashTableIter iter;
+    UdpSock *udpsock;
 
-    for (item = self->priv->udpsocks[i]; item; item = item->next)
+    g_hash_table_iter_init (&iter, self->priv->udpsocks[i]);
+    while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &udpsock))
     {
-      UdpSock *udpsock = item->data;
-
       if (setsockopt (udpsock->fd, IPPROTO_IP, IP_TOS,
               &tos, sizeof (tos)) < 0)
         GST_WARNING ( "could not set socket tos: %s", g_strerror (errno));
@@ -91,6 +91,7 @@ UdpSock *fs_multicast_transmitter_get_udpsock (FsMulticastTransmitter *trans,
     guint component_id,
     const gchar *local_ip,
     const gchar *multicast_ip,
+    const gchar *source_ip,
     guint16 port,
     guint8 ttl,
     gboolean sending,
@@ -41,6 +41,7 @@
 
 #include <string.h>
 #include <sys/types.h>
+#include <unistd.h>
 
 #define GST_CAT_DEFAULT fs_nice_transmitter_debug
 
@@ -58,20 +59,40 @@ enum
   PROP_PREFERRED_LOCAL_CANDIDATES,
 };
 
-struct _FsNiceAgentPrivate
-{
+/*
+ * The agents are spread over a fixed pool of threads, each running its own
+ * main context. All of the callbacks of an agent run in the same thread.
+ */
+
+#define FS_NICE_AGENT_MAX_WORKERS 16
+
+typedef struct {
   GMainContext *main_context;
   GMainLoop *main_loop;
+  GThread *thread;
+  guint agents;
+} FsNiceAgentWorker;
 
-  guint compatibility_mode;
+G_LOCK_DEFINE_STATIC (workers);
+static FsNiceAgentWorker *workers = NULL;
+static guint n_workers = 0;
 
-  GList *preferred_local_candidates;
+/* Enumerating the interfaces is slow, so the list is shared for a while */
 
-  GMutex mutex;
+#define LOCAL_IPS_CACHE_TIMEOUT (5)
 
-  /* Everything below is protected by the mutex */
+G_LOCK_DEFINE_STATIC (local_ips);
+static GList *local_ips = NULL;
+static gint64 local_ips_expiry = 0;
 
-  GThread *thread;
+struct _FsNiceAgentPrivate
+{
+  FsNiceAgentWorker *worker;
+  GMainContext *main_context;
+
+  guint compatibility_mode;
+
+  GList *preferred_local_candidates;
 };
 
 #define FS_NICE_AGENT_GET_PRIVATE(o)  \
@@ -79,15 +100,12 @@ struct _FsNiceAgentPrivate
     FsNiceAgentPrivate))
 
 
-#define FS_NICE_AGENT_LOCK(o)   g_mutex_lock (&(o)->priv->mutex)
-#define FS_NICE_AGENT_UNLOCK(o) g_mutex_unlock (&(o)->priv->mutex)
-
 static void fs_nice_agent_class_init (
     FsNiceAgentClass *klass);
 static void fs_nice_agent_init (FsNiceAgent *self);
 static void fs_nice_agent_dispose (GObject *object);
 static void fs_nice_agent_finalize (GObject *object);
-static void fs_nice_agent_stop_thread (FsNiceAgent *self);
+static void fs_nice_agent_release_worker (FsNiceAgent *self);
 
 static void fs_nice_agent_set_property (GObject *object,
     guint prop_id,
@@ -174,11 +192,6 @@ fs_nice_agent_init (FsNiceAgent *self)
   /* member init */
   self->priv = FS_NICE_AGENT_GET_PRIVATE (self);
 
-  g_mutex_init (&self->priv->mutex);
-
-  self->priv->main_context = g_main_context_new ();
-  self->priv->main_loop = g_main_loop_new (self->priv->main_context, FALSE);
-
   self->priv->compatibility_mode = NICE_COMPATIBILITY_DRAFT19;
 }
 
@@ -188,11 +201,7 @@ fs_nice_agent_dispose (GObject *object)
 {
   FsNiceAgent *self = FS_NICE_AGENT (object);
 
-  fs_nice_agent_stop_thread (self);
-
-  if (self->agent)
-    g_object_unref (self->agent);
-  self->agent = NULL;
+  fs_nice_agent_release_worker (self);
 
   parent_class->dispose (object);
 }
@@ -201,19 +210,9 @@ fs_nice_agent_finalize (GObject *object)
 {
   FsNiceAgent *self = FS_NICE_AGENT (object);
 
-  if (self->priv->main_context)
-    g_main_context_unref (self->priv->main_context);
-  self->priv->main_context = NULL;
-
-  if (self->priv->main_loop)
-    g_main_loop_unref (self->priv->main_loop);
-  self->priv->main_loop = NULL;
-
   fs_candidate_list_destroy (self->priv->preferred_local_candidates);
   self->priv->preferred_local_candidates = NULL;
 
-  g_mutex_clear (&self->priv->mutex);
-
   parent_class->finalize (object);
 }
 
@@ -263,56 +262,178 @@ fs_nice_agent_get_property (GObject *object,
 }
 
 
-static gboolean
-thread_unlock_idler (gpointer data)
+static gpointer
+fs_nice_agent_worker_thread (gpointer data)
 {
-  FsNiceAgent *self = FS_NICE_AGENT (data);
+  FsNiceAgentWorker *worker = data;
 
-  g_main_loop_quit (self->priv->main_loop);
+  g_main_loop_run (worker->main_loop);
 
-  return TRUE;
+  return NULL;
 }
 
-static void
-fs_nice_agent_stop_thread (FsNiceAgent *self)
+static guint
+fs_nice_agent_worker_count (void)
 {
-  GSource *idle_source;
+  glong n = 1;
+
+#ifdef _SC_NPROCESSORS_ONLN
+  n = sysconf (_SC_NPROCESSORS_ONLN);
+#endif
+
+  return CLAMP (n, 1, FS_NICE_AGENT_MAX_WORKERS);
+}
 
-  g_main_loop_quit (self->priv->main_loop);
+/* Picks the least loaded worker, starting its thread if needed */
 
-  FS_NICE_AGENT_LOCK(self);
+static FsNiceAgentWorker *
+fs_nice_agent_acquire_worker (GError **error)
+{
+  FsNiceAgentWorker *worker = NULL;
+  guint i;
+
+  G_LOCK (workers);
 
-  if (self->priv->thread == NULL ||
-      self->priv->thread == g_thread_self ())
+  if (!workers)
   {
-    FS_NICE_AGENT_UNLOCK (self);
-    return;
+    n_workers = fs_nice_agent_worker_count ();
+    workers = g_new0 (FsNiceAgentWorker, n_workers);
   }
-  FS_NICE_AGENT_UNLOCK (self);
 
-  idle_source = g_idle_source_new ();
-  g_source_set_priority (idle_source, G_PRIORITY_HIGH);
-  g_source_set_callback (idle_source, thread_unlock_idler, self, NULL);
-  g_source_attach (idle_source, self->priv->main_context);
+  for (i = 0; i < n_workers; i++)
+    if (!worker || workers[i].agents < worker->agents)
+      worker = &workers[i];
+
+  if (!worker->thread)
+  {
+    GMainContext *main_context = g_main_context_new ();
+    GMainLoop *main_loop = g_main_loop_new (main_context, FALSE);
+
+    worker->main_context = main_context;
+    worker->main_loop = main_loop;
+    worker->thread = g_thread_try_new ("libnice agent thread",
+        fs_nice_agent_worker_thread, worker, error);
+
+    if (!worker->thread)
+    {
+      worker->main_context = NULL;
+      worker->main_loop = NULL;
+      g_main_loop_unref (main_loop);
+      g_main_context_unref (main_context);
+      G_UNLOCK (workers);
+      return NULL;
+    }
+  }
 
-  g_thread_join (self->priv->thread);
+  worker->agents++;
 
-  g_source_destroy (idle_source);
-  g_source_unref (idle_source);
+  G_UNLOCK (workers);
 
-  FS_NICE_AGENT_LOCK (self);
-  self->priv->thread = NULL;
-  FS_NICE_AGENT_UNLOCK (self);
+  return worker;
 }
 
-static gpointer
-fs_nice_agent_main_thread (gpointer data)
+struct unref_agent_data {
+  NiceAgent *agent;
+  GMutex mutex;
+  GCond cond;
+  gboolean done;
+};
+
+static gboolean
+unref_agent_idler (gpointer user_data)
 {
-  FsNiceAgent *self = FS_NICE_AGENT (data);
+  struct unref_agent_data *data = user_data;
 
-  g_main_loop_run (self->priv->main_loop);
+  g_object_unref (data->agent);
 
-  return NULL;
+  g_mutex_lock (&data->mutex);
+  data->done = TRUE;
+  g_cond_signal (&data->cond);
+  g_mutex_unlock (&data->mutex);
+
+  return FALSE;
+}
+
+/*
+ * The nice agent is destroyed from its worker thread so that none of its
+ * callbacks can be running concurrently
+ */
+
+static void
+fs_nice_agent_release_worker (FsNiceAgent *self)
+{
+  FsNiceAgentWorker *worker = self->priv->worker;
+  GMainContext *main_context = self->priv->main_context;
+  NiceAgent *agent = self->agent;
+
+  self->priv->worker = NULL;
+  self->priv->main_context = NULL;
+  self->agent = NULL;
+
+  if (agent)
+  {
+    if (g_main_context_is_owner (main_context))
+    {
+      g_object_unref (agent);
+    }
+    else
+    {
+      struct unref_agent_data data;
+      GSource *idle_source;
+
+      data.agent = agent;
+      data.done = FALSE;
+      g_mutex_init (&data.mutex);
+      g_cond_init (&data.cond);
+
+      idle_source = g_idle_source_new ();
+      g_source_set_priority (idle_source, G_PRIORITY_HIGH);
+      g_source_set_callback (idle_source, unref_agent_idler, &data, NULL);
+      g_source_attach (idle_source, main_context);
+      g_source_unref (idle_source);
+
+      g_mutex_lock (&data.mutex);
+      while (!data.done)
+        g_cond_wait (&data.cond, &data.mutex);
+      g_mutex_unlock (&data.mutex);
+
+      g_mutex_clear (&data.mutex);
+      g_cond_clear (&data.cond);
+    }
+  }
+
+  if (main_context)
+    g_main_context_unref (main_context);
+
+  if (worker)
+  {
+    G_LOCK (workers);
+    worker->agents--;
+    G_UNLOCK (workers);
+  }
+}
+
+static GList *
+fs_nice_agent_get_local_ips (void)
+{
+  gint64 now = g_get_monotonic_time ();
+  GList *ips = NULL;
+  GList *item;
+
+  G_LOCK (local_ips);
+  if (local_ips_expiry <= now)
+  {
+    g_list_foreach (local_ips, (GFunc) g_free, NULL);
+    g_list_free (local_ips);
+    local_ips = nice_interfaces_get_local_ips (FALSE);
+    local_ips_expiry = now + LOCAL_IPS_CACHE_TIMEOUT * G_USEC_PER_SEC;
+  }
+
+  for (item = local_ips; item; item = g_list_next (item))
+    ips = g_list_prepend (ips, g_strdup (item->data));
+  G_UNLOCK (local_ips);
+
+  return g_list_reverse (ips);
 }
 
 static gboolean
@@ -350,7 +471,7 @@ fs_nice_agent_init_agent (FsNiceAgent *self, GError **error)
 
   if (!set)
   {
-    GList *addresses = nice_interfaces_get_local_ips (FALSE);
+    GList *addresses = fs_nice_agent_get_local_ips ();
 
     for (item = addresses;
          item;
@@ -398,6 +519,15 @@ fs_nice_agent_new (guint compatibility_mode,
       "preferred-local-candidates", preferred_local_candidates,
       NULL);
 
+  self->priv->worker = fs_nice_agent_acquire_worker (error);
+  if (!self->priv->worker)
+  {
+    g_object_unref (self);
+    return NULL;
+  }
+  self->priv->main_context =
+    g_main_context_ref (self->priv->worker->main_context);
+
   if (reliable)
     self->agent = nice_agent_new_reliable (self->priv->main_context,
         self->priv->compatibility_mode);
@@ -419,19 +549,6 @@ fs_nice_agent_new (guint compatibility_mode,
     return NULL;
   }
 
-  FS_NICE_AGENT_LOCK (self);
-
-  self->priv->thread = g_thread_try_new ("libnice agent thread",
-      fs_nice_agent_main_thread, self, error);
-
-  if (!self->priv->thread)
-  {
-    FS_NICE_AGENT_UNLOCK (self);
-    g_object_unref (self);
-    return NULL;
-  }
-  FS_NICE_AGENT_UNLOCK (self);
-
   return self;
 }
 
@@ -50,6 +50,7 @@
 /* Signals */
 enum
 {
+  NEW_LOCAL_CANDIDATES,
   LAST_SIGNAL
 };
 
@@ -72,7 +73,9 @@ enum
   PROP_ICE_UDP,
   PROP_RELIABLE,
   PROP_DEBUG,
-  PROP_SEND_COMPONENT_MUX
+  PROP_SEND_COMPONENT_MUX,
+  PROP_TRICKLE,
+  PROP_REMOTE_CANDIDATES_DONE
 };
 
 struct _FsNiceStreamTransmitterPrivate
@@ -94,6 +97,7 @@ struct _FsNiceStreamTransmitterPrivate
   gboolean ice_tcp;
   gboolean reliable;
   gboolean send_component_mux;
+  gboolean trickle;
 
   guint compatibility_mode;
 
@@ -113,6 +117,8 @@ struct _FsNiceStreamTransmitterPrivate
   volatile gint associate_on_source;
 
   gboolean *component_has_been_ready; /* only from NiceAgent main thread */
+  guint *component_state; /* only from NiceAgent main thread */
+  gboolean *component_failed_reported; /* only from NiceAgent main thread */
 
   /* Everything below is protected by the mutex */
 
@@ -127,8 +133,13 @@ struct _FsNiceStreamTransmitterPrivate
   gchar *password;
 
   gboolean gathered;
+  gboolean remote_candidates_done;
 
   NiceGstStream *gststream;
+
+  /* Events from the agent thread waiting to be signalled */
+  GQueue pending_events;
+  gboolean flush_scheduled;
 };
 
 #define FS_NICE_STREAM_TRANSMITTER_GET_PRIVATE(o)  \
@@ -185,13 +196,18 @@ static void agent_new_candidate (NiceAgent *agent,
     const gchar *foundation,
     gpointer user_data);
 
+struct pending_event;
+static void free_pending_event (struct pending_event *event);
+
+static gboolean remote_candidates_done_idle (gpointer userdata);
+
 static GstPadProbeReturn known_buffer_have_buffer_handler (GstPad *pad,
     GstPadProbeInfo *info,
     gpointer user_data);
 
 
 static GObjectClass *parent_class = NULL;
-// static guint signals[LAST_SIGNAL] = { 0 };
+static guint signals[LAST_SIGNAL] = { 0 };
 
 static GType type = 0;
 
@@ -427,6 +443,60 @@ fs_nice_stream_transmitter_class_init (FsNiceStreamTransmitterClass *klass)
           FALSE,
           G_PARAM_WRITABLE | G_PARAM_STATIC_STRINGS));
 
+  /**
+   * FsNiceStreamTransmitter:trickle:
+   *
+   * In trickle mode, each local candidate is signalled as soon as it is
+   * found instead of waiting for the end of the gathering, and the remote
+   * candidates are handed to the agent right away so that the connectivity
+   * checks can start on the first pair.
+   * The #FsStreamTransmitter::local-candidates-prepared signal then
+   * marks the end of the local candidates.
+   */
+  g_object_class_install_property (gobject_class, PROP_TRICKLE,
+      g_param_spec_boolean (
+          "trickle",
+          "Trickle candidates",
+          "Whether the candidates are signalled and used as they are found",
+          FALSE,
+          G_PARAM_READWRITE | G_PARAM_CONSTRUCT_ONLY | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * FsNiceStreamTransmitter:remote-candidates-done:
+   *
+   * Set this to %TRUE once the remote peer has signalled that it has sent
+   * all of its candidates. Until then, a component that fails its
+   * connectivity checks is not reported as failed, since more candidates
+   * could still arrive. It is reset by an ICE restart.
+   */
+  g_object_class_install_property (gobject_class, PROP_REMOTE_CANDIDATES_DONE,
+      g_param_spec_boolean (
+          "remote-candidates-done",
+          "Remote candidates done",
+          "Whether the remote side has sent all of its candidates",
+          FALSE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * FsNiceStreamTransmitter::new-local-candidates:
+   * @self: #FsNiceStreamTransmitter that emitted the signal
+   * @local_candidates: (type GLib.List) (element-type FsCandidate):
+   *   #GList of the new local #FsCandidate
+   *
+   * This signal is emitted once for each batch of local candidates
+   * discovered during the same main loop iteration of the agent, before the
+   * #FsStreamTransmitter::new-local-candidate signal is emitted for
+   * each of them.
+   */
+  signals[NEW_LOCAL_CANDIDATES] = g_signal_new
+    ("new-local-candidates",
+      G_TYPE_FROM_CLASS (klass),
+      G_SIGNAL_RUN_LAST,
+      0,
+      NULL,
+      NULL,
+      g_cclosure_marshal_VOID__BOXED,
+      G_TYPE_NONE, 1, FS_TYPE_CANDIDATE_LIST);
 }
 
 static void
@@ -528,6 +598,10 @@ fs_nice_stream_transmitter_finalize (GObject *object)
   fs_candidate_list_destroy (self->priv->remote_candidates);
   fs_candidate_list_destroy (self->priv->local_candidates);
 
+  g_queue_foreach (&self->priv->pending_events, (GFunc) free_pending_event,
+      NULL);
+  g_queue_clear (&self->priv->pending_events);
+
   if (self->priv->relay_info)
     g_ptr_array_unref (self->priv->relay_info);
 
@@ -539,6 +613,8 @@ fs_nice_stream_transmitter_finalize (GObject *object)
   g_free (self->priv->password);
 
   g_free (self->priv->component_has_been_ready);
+  g_free (self->priv->component_state);
+  g_free (self->priv->component_failed_reported);
 
   parent_class->finalize (object);
 }
@@ -618,6 +694,14 @@ fs_nice_stream_transmitter_get_property (GObject *object,
     case PROP_SEND_COMPONENT_MUX:
       g_value_set_boolean (value, self->priv->send_component_mux);
       break;
+    case PROP_TRICKLE:
+      g_value_set_boolean (value, self->priv->trickle);
+      break;
+    case PROP_REMOTE_CANDIDATES_DONE:
+      FS_NICE_STREAM_TRANSMITTER_LOCK (self);
+      g_value_set_boolean (value, self->priv->remote_candidates_done);
+      FS_NICE_STREAM_TRANSMITTER_UNLOCK (self);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -701,6 +785,17 @@ fs_nice_stream_transmitter_set_property (GObject *object,
         fs_nice_transmitter_set_send_component_mux (self->priv->transmitter,
             self->priv->gststream, self->priv->send_component_mux);
       break;
+    case PROP_TRICKLE:
+      self->priv->trickle = g_value_get_boolean (value);
+      break;
+    case PROP_REMOTE_CANDIDATES_DONE:
+      FS_NICE_STREAM_TRANSMITTER_LOCK (self);
+      self->priv->remote_candidates_done = g_value_get_boolean (value);
+      FS_NICE_STREAM_TRANSMITTER_UNLOCK (self);
+      if (self->priv->agent && g_value_get_boolean (value))
+        fs_nice_agent_add_idle (self->priv->agent,
+            remote_candidates_done_idle, g_object_ref (self), g_object_unref);
+      break;
 
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
@@ -814,6 +909,7 @@ fs_nice_stream_transmitter_add_remote_candidates (
     g_free (self->priv->password);
     self->priv->username = NULL;
     self->priv->password = NULL;
+    self->priv->remote_candidates_done = FALSE;
     FS_NICE_STREAM_TRANSMITTER_UNLOCK (self);
     nice_agent_restart (self->priv->agent->agent);
     return TRUE;
@@ -919,7 +1015,9 @@ fs_nice_stream_transmitter_add_remote_candidates (
     return FALSE;
   }
 
-  if (!self->priv->gathered)
+  /* In trickle mode, the candidates are added to the agent as they come,
+   * it pairs them with the local candidates found so far */
+  if (!self->priv->gathered && !self->priv->trickle)
   {
     self->priv->remote_candidates = g_list_concat (
         self->priv->remote_candidates,
@@ -1464,6 +1562,10 @@ fs_nice_stream_transmitter_build (FsNiceStreamTransmitter *self,
 
   self->priv->component_has_been_ready = g_new0 (gboolean,
       self->priv->transmitter->components);
+  self->priv->component_state = g_new0 (guint,
+      self->priv->transmitter->components);
+  self->priv->component_failed_reported = g_new0 (gboolean,
+      self->priv->transmitter->components);
 
   self->priv->stream_id = nice_agent_add_stream (
       self->priv->agent->agent,
@@ -1595,28 +1697,136 @@ nice_component_state_to_fs_stream_state (NiceComponentState state)
   }
 }
 
-struct state_changed_signal_data
+/*
+ * The events from the agent are queued and signalled in batches, from a
+ * single idle per stream scheduled when the queue stops being empty
+ */
+
+typedef enum {
+  PENDING_STATE_CHANGED,
+  PENDING_NEW_LOCAL_CANDIDATE,
+  PENDING_NEW_ACTIVE_CANDIDATE_PAIR
+} PendingEventType;
+
+struct pending_event
 {
-  FsNiceStreamTransmitter *self;
+  PendingEventType type;
   guint component_id;
   FsStreamState fs_state;
+  FsCandidate *candidate1;
+  FsCandidate *candidate2;
 };
 
 static void
-free_state_changed_signal_data (gpointer user_data)
+free_pending_event (struct pending_event *event)
+{
+  if (event->candidate1)
+    fs_candidate_destroy (event->candidate1);
+  if (event->candidate2)
+    fs_candidate_destroy (event->candidate2);
+  g_slice_free (struct pending_event, event);
+}
+
+static gboolean
+pending_events_idle (gpointer userdata)
+{
+  FsNiceStreamTransmitter *self = userdata;
+  GList *events, *item;
+  GList *local_candidates = NULL;
+
+  FS_NICE_STREAM_TRANSMITTER_LOCK (self);
+  events = self->priv->pending_events.head;
+  g_queue_init (&self->priv->pending_events);
+  self->priv->flush_scheduled = FALSE;
+  FS_NICE_STREAM_TRANSMITTER_UNLOCK (self);
+
+  for (item = events; item; item = g_list_next (item))
+  {
+    struct pending_event *event = item->data;
+
+    if (event->type == PENDING_NEW_LOCAL_CANDIDATE)
+      local_candidates = g_list_prepend (local_candidates, event->candidate1);
+  }
+
+  if (local_candidates)
+  {
+    local_candidates = g_list_reverse (local_candidates);
+    g_signal_emit (self, signals[NEW_LOCAL_CANDIDATES], 0, local_candidates);
+    g_list_free (local_candidates);
+  }
+
+  for (item = events; item; item = g_list_next (item))
+  {
+    struct pending_event *event = item->data;
+
+    switch (event->type)
+    {
+      case PENDING_STATE_CHANGED:
+        g_signal_emit_by_name (self, "state-changed", event->component_id,
+            event->fs_state);
+        break;
+      case PENDING_NEW_LOCAL_CANDIDATE:
+        g_signal_emit_by_name (self, "new-local-candidate", event->candidate1);
+        break;
+      case PENDING_NEW_ACTIVE_CANDIDATE_PAIR:
+        g_signal_emit_by_name (self, "new-active-candidate-pair",
+            event->candidate1, event->candidate2);
+        break;
+    }
+
+    free_pending_event (event);
+  }
+  g_list_free (events);
+
+  return FALSE;
+}
+
+static void
+queue_pending_event (FsNiceStreamTransmitter *self, PendingEventType type,
+    guint component_id, FsStreamState fs_state,
+    FsCandidate *candidate1, FsCandidate *candidate2)
 {
-  struct state_changed_signal_data *data = user_data;
-  g_object_unref (data->self);
-  g_slice_free (struct state_changed_signal_data, data);
+  struct pending_event *event = g_slice_new (struct pending_event);
+  gboolean schedule;
+
+  event->type = type;
+  event->component_id = component_id;
+  event->fs_state = fs_state;
+  event->candidate1 = candidate1;
+  event->candidate2 = candidate2;
+
+  FS_NICE_STREAM_TRANSMITTER_LOCK (self);
+  g_queue_push_tail (&self->priv->pending_events, event);
+  schedule = !self->priv->flush_scheduled;
+  self->priv->flush_scheduled = TRUE;
+  FS_NICE_STREAM_TRANSMITTER_UNLOCK (self);
+
+  if (schedule)
+    fs_nice_agent_add_idle (self->priv->agent, pending_events_idle,
+        g_object_ref (self), g_object_unref);
 }
 
+/* Report the components that failed before we knew no candidates would come */
+
 static gboolean
-state_changed_signal_idle (gpointer userdata)
+remote_candidates_done_idle (gpointer userdata)
 {
-  struct state_changed_signal_data *data = userdata;
+  FsNiceStreamTransmitter *self = userdata;
+  guint c;
+
+  for (c = 1; c <= self->priv->transmitter->components; c++)
+  {
+    /* agent_state_changed () may have reported it since the flag was set */
+    if (self->priv->component_state[c - 1] == NICE_COMPONENT_STATE_FAILED &&
+        !self->priv->component_has_been_ready[c - 1] &&
+        !self->priv->component_failed_reported[c - 1])
+    {
+      self->priv->component_failed_reported[c - 1] = TRUE;
+      queue_pending_event (self, PENDING_STATE_CHANGED, c,
+          FS_STREAM_STATE_FAILED, NULL, NULL);
+    }
+  }
 
-  g_signal_emit_by_name (data->self, "state-changed", data->component_id,
-      data->fs_state);
   return FALSE;
 }
 
@@ -1629,7 +1839,7 @@ agent_state_changed (NiceAgent *agent,
 {
   FsNiceStreamTransmitter *self = FS_NICE_STREAM_TRANSMITTER (user_data);
   FsStreamState fs_state;
-  struct state_changed_signal_data *data;
+  gboolean remote_candidates_done;
 
   if (stream_id != self->priv->stream_id)
     return;
@@ -1637,26 +1847,33 @@ agent_state_changed (NiceAgent *agent,
   g_return_if_fail (component_id > 0 &&
       component_id <= self->priv->transmitter->components);
 
+  self->priv->component_state[component_id - 1] = state;
+
+  FS_NICE_STREAM_TRANSMITTER_LOCK (self);
+  remote_candidates_done = self->priv->remote_candidates_done;
+  FS_NICE_STREAM_TRANSMITTER_UNLOCK (self);
+
   /* Ignore failed until we've connected, never time out because
-   * of the dribbling case, more candidates could come later
+   * of the dribbling case, more candidates could come later, unless
+   * the other side told us it has sent all of them
    */
   if (state == NICE_COMPONENT_STATE_FAILED &&
-      !self->priv->component_has_been_ready[component_id - 1])
+      !self->priv->component_has_been_ready[component_id - 1] &&
+      !remote_candidates_done)
     return;
   else if (state == NICE_COMPONENT_STATE_READY)
     self->priv->component_has_been_ready[component_id - 1] = TRUE;
 
+  self->priv->component_failed_reported[component_id - 1] =
+      (state == NICE_COMPONENT_STATE_FAILED);
+
   fs_state = nice_component_state_to_fs_stream_state (state);
-  data = g_slice_new (struct state_changed_signal_data);
 
   GST_DEBUG ("Stream: %u Component %u has state %u",
       self->priv->stream_id, component_id, state);
 
-  data->self = g_object_ref (self);
-  data->component_id = component_id;
-  data->fs_state = fs_state;
-  fs_nice_agent_add_idle (self->priv->agent, state_changed_signal_idle,
-      data, free_state_changed_signal_data);
+  queue_pending_event (self, PENDING_STATE_CHANGED, component_id, fs_state,
+      NULL, NULL);
 
   if (fs_state >= FS_STREAM_STATE_CONNECTED)
   {
@@ -1669,35 +1886,6 @@ agent_state_changed (NiceAgent *agent,
 }
 
 
-struct candidate_signal_data
-{
-  FsNiceStreamTransmitter *self;
-  const gchar *signal_name;
-  FsCandidate *candidate1;
-  FsCandidate *candidate2;
-};
-
-static void
-free_candidate_signal_data (gpointer user_data)
-{
-  struct candidate_signal_data *data = user_data;
-  fs_candidate_destroy (data->candidate1);
-  if (data->candidate2)
-    fs_candidate_destroy (data->candidate2);
-  g_object_unref (data->self);
-  g_slice_free (struct candidate_signal_data, data);
-}
-
-static gboolean
-agent_candidate_signal_idle (gpointer userdata)
-{
-  struct candidate_signal_data *data = userdata;
-
-  g_signal_emit_by_name (data->self, data->signal_name, data->candidate1,
-                         data->candidate2);
-  return FALSE;
-}
-
 
 static void
 agent_new_selected_pair (NiceAgent *agent,
@@ -1750,14 +1938,8 @@ agent_new_selected_pair (NiceAgent *agent,
 
   if (local && remote)
   {
-    struct candidate_signal_data *data =
-      g_slice_new (struct candidate_signal_data);
-    data->self = g_object_ref (self);
-    data->signal_name = "new-active-candidate-pair";
-    data->candidate1 = local;
-    data->candidate2 = remote;
-    fs_nice_agent_add_idle (self->priv->agent, agent_candidate_signal_idle,
-        data, free_candidate_signal_data);
+    queue_pending_event (self, PENDING_NEW_ACTIVE_CANDIDATE_PAIR,
+        component_id, 0, local, remote);
   }
   else
   {
@@ -1803,7 +1985,7 @@ agent_new_candidate (NiceAgent *agent,
   if (fscandidate)
   {
     FS_NICE_STREAM_TRANSMITTER_LOCK (self);
-    if (!self->priv->gathered)
+    if (!self->priv->gathered && !self->priv->trickle)
     {
       /* Nice doesn't do connchecks while gathering, so don't tell the upper
        * layers about the candidates untill gathering is finished.
@@ -1821,17 +2003,10 @@ agent_new_candidate (NiceAgent *agent,
     }
     else
     {
-      struct candidate_signal_data *data =
-        g_slice_new (struct candidate_signal_data);
-
       FS_NICE_STREAM_TRANSMITTER_UNLOCK (self);
 
-      data->self = g_object_ref (self);
-      data->signal_name = "new-local-candidate";
-      data->candidate1 = fscandidate;
-      data->candidate2 = NULL;
-      fs_nice_agent_add_idle (self->priv->agent, agent_candidate_signal_idle,
-        data, free_candidate_signal_data);
+      queue_pending_event (self, PENDING_NEW_LOCAL_CANDIDATE, component_id, 0,
+          fscandidate, NULL);
     }
   }
   else
@@ -1872,6 +2047,8 @@ agent_gathering_done_idle (gpointer data)
   {
     GList *l;
 
+    g_signal_emit (self, signals[NEW_LOCAL_CANDIDATES], 0, local_candidates);
+
     for (l = local_candidates ; l != NULL; l = g_list_next (l))
       g_signal_emit_by_name (self, "new-local-candidate", l->data);
     fs_candidate_list_destroy (local_candidates);
@@ -0,0 +1,271 @@
+/*
+ * Farstream - Farstream RAW UDP with STUN Transmitter
+ *
+ * fs-rawudp-cache.c - Process-wide cache of STUN mappings and interfaces
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "fs-rawudp-cache.h"
+
+#include <string.h>
+
+/*
+ * The NAT mapping depends on the local address and port the packets are sent
+ * from, not on the transmitter or socket that sends them, and the interfaces
+ * belong to the host, so both caches are shared by the whole process, like
+ * the interface list of the nice transmitter. The transmitter plugin is never
+ * unloaded, so they can outlive every transmitter.
+ *
+ * All the times are monotonic times in microseconds, passed in by the caller.
+ */
+
+typedef struct {
+  gchar *ip;
+  guint port;
+  gint64 expiry;
+} StunMapping;
+
+G_LOCK_DEFINE_STATIC (cache);
+static GHashTable *stun_mappings = NULL;
+static GList *local_ips[2] = {NULL, NULL};
+static gint64 local_ips_expiry[2] = {0, 0};
+
+static void
+stun_mapping_free (gpointer data)
+{
+  StunMapping *mapping = data;
+
+  g_free (mapping->ip);
+  g_slice_free (StunMapping, mapping);
+}
+
+static gboolean
+stun_mapping_is_expired (gpointer key, gpointer value, gpointer user_data)
+{
+  StunMapping *mapping = value;
+  gint64 *now = user_data;
+
+  return mapping->expiry <= *now;
+}
+
+static gchar *
+stun_mapping_key (const gchar *local_ip, guint local_port,
+    const gchar *stun_ip, guint stun_port)
+{
+  return g_strdup_printf ("%s:%u/%s:%u", local_ip ? local_ip : "*",
+      local_port, stun_ip, stun_port);
+}
+
+static void
+free_ip_list (GList *ips)
+{
+  g_list_foreach (ips, (GFunc) g_free, NULL);
+  g_list_free (ips);
+}
+
+static GList *
+copy_ip_list (GList *ips)
+{
+  GList *copy = NULL;
+  GList *item;
+
+  for (item = ips; item; item = g_list_next (item))
+    copy = g_list_prepend (copy, g_strdup (item->data));
+
+  return g_list_reverse (copy);
+}
+
+static gboolean
+ip_lists_equal (GList *a, GList *b)
+{
+  for (; a && b; a = g_list_next (a), b = g_list_next (b))
+    if (strcmp (a->data, b->data))
+      return FALSE;
+
+  return a == NULL && b == NULL;
+}
+
+/**
+ * fs_rawudp_cache_lookup_stun_mapping:
+ * @local_ip: the local address the STUN request would be sent from, or
+ *   %NULL for any address
+ * @local_port: the local port the STUN request would be sent from
+ * @stun_ip: the IP address of the STUN server
+ * @stun_port: the port of the STUN server
+ * @now: the current monotonic time
+ * @mapped_ip: (out): location for the external IP address
+ * @mapped_port: (out): location for the external port
+ *
+ * Looks for a server-reflexive address found less than
+ * %FS_RAWUDP_STUN_MAPPING_CACHE_TIMEOUT seconds ago for the same local
+ * address and port by anything in the process.
+ *
+ * Returns: %TRUE if a mapping was found, @mapped_ip must then be freed
+ */
+
+gboolean
+fs_rawudp_cache_lookup_stun_mapping (const gchar *local_ip,
+    guint local_port,
+    const gchar *stun_ip,
+    guint stun_port,
+    gint64 now,
+    gchar **mapped_ip,
+    guint *mapped_port)
+{
+  gchar *key = stun_mapping_key (local_ip, local_port, stun_ip, stun_port);
+  StunMapping *mapping;
+  gboolean found = FALSE;
+
+  G_LOCK (cache);
+  mapping = stun_mappings ? g_hash_table_lookup (stun_mappings, key) : NULL;
+  if (mapping)
+  {
+    if (mapping->expiry > now)
+    {
+      *mapped_ip = g_strdup (mapping->ip);
+      *mapped_port = mapping->port;
+      found = TRUE;
+    }
+    else
+    {
+      g_hash_table_remove (stun_mappings, key);
+    }
+  }
+  G_UNLOCK (cache);
+
+  g_free (key);
+
+  return found;
+}
+
+void
+fs_rawudp_cache_store_stun_mapping (const gchar *local_ip,
+    guint local_port,
+    const gchar *stun_ip,
+    guint stun_port,
+    const gchar *mapped_ip,
+    guint mapped_port,
+    gint64 now)
+{
+  StunMapping *mapping = g_slice_new (StunMapping);
+
+  mapping->ip = g_strdup (mapped_ip);
+  mapping->port = mapped_port;
+  mapping->expiry = now + FS_RAWUDP_STUN_MAPPING_CACHE_TIMEOUT *
+    G_USEC_PER_SEC;
+
+  G_LOCK (cache);
+  if (stun_mappings)
+    /* Nothing else ever looks at the mappings of ports that went away */
+    g_hash_table_foreach_remove (stun_mappings, stun_mapping_is_expired,
+        &now);
+  else
+    stun_mappings = g_hash_table_new_full (g_str_hash, g_str_equal,
+        g_free, stun_mapping_free);
+  g_hash_table_insert (stun_mappings,
+      stun_mapping_key (local_ip, local_port, stun_ip, stun_port), mapping);
+  G_UNLOCK (cache);
+}
+
+/**
+ * fs_rawudp_cache_lookup_local_ips:
+ * @include_loopback: Include any loopback devices
+ * @now: the current monotonic time
+ * @ips: (out) (transfer full): location for a copy of the list
+ *
+ * Looks for a list of local interfaces stored less than
+ * %FS_RAWUDP_LOCAL_IPS_CACHE_TIMEOUT seconds ago.
+ *
+ * Returns: %TRUE if the list is still valid, otherwise the interfaces
+ *   should be enumerated and stored again
+ */
+
+gboolean
+fs_rawudp_cache_lookup_local_ips (gboolean include_loopback,
+    gint64 now,
+    GList **ips)
+{
+  guint i = include_loopback ? 1 : 0;
+  gboolean found = FALSE;
+
+  G_LOCK (cache);
+  if (local_ips_expiry[i] > now)
+  {
+    *ips = copy_ip_list (local_ips[i]);
+    found = TRUE;
+  }
+  G_UNLOCK (cache);
+
+  return found;
+}
+
+/**
+ * fs_rawudp_cache_store_local_ips:
+ * @include_loopback: Whether @ips includes the loopback devices
+ * @ips: the list of local addresses, it is copied
+ * @now: the current monotonic time
+ *
+ * Stores a newly enumerated list of local interfaces. If it differs from
+ * the previous one, the host moved to another network and the STUN
+ * mappings found before can not be trusted anymore, so they are all
+ * dropped.
+ */
+
+void
+fs_rawudp_cache_store_local_ips (gboolean include_loopback,
+    GList *ips,
+    gint64 now)
+{
+  guint i = include_loopback ? 1 : 0;
+
+  G_LOCK (cache);
+  if (local_ips_expiry[i] != 0 && !ip_lists_equal (local_ips[i], ips) &&
+      stun_mappings)
+    g_hash_table_remove_all (stun_mappings);
+
+  free_ip_list (local_ips[i]);
+  local_ips[i] = copy_ip_list (ips);
+  local_ips_expiry[i] = now + FS_RAWUDP_LOCAL_IPS_CACHE_TIMEOUT *
+    G_USEC_PER_SEC;
+  G_UNLOCK (cache);
+}
+
+/**
+ * fs_rawudp_cache_clear:
+ *
+ * Forgets everything that was cached
+ */
+
+void
+fs_rawudp_cache_clear (void)
+{
+  guint i;
+
+  G_LOCK (cache);
+  if (stun_mappings)
+    g_hash_table_remove_all (stun_mappings);
+  for (i = 0; i < 2; i++)
+  {
+    free_ip_list (local_ips[i]);
+    local_ips[i] = NULL;
+    local_ips_expiry[i] = 0;
+  }
+  G_UNLOCK (cache);
+}
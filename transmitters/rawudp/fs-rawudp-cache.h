@@ -0,0 +1,64 @@
+/*
+ * Farstream - Farstream RAW UDP with STUN Transmitter
+ *
+ * fs-rawudp-cache.h - Process-wide cache of STUN mappings and interfaces
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#ifndef __FS_RAWUDP_CACHE_H__
+#define __FS_RAWUDP_CACHE_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/*
+ * STUN mappings are re-used for this long (in seconds) by anything in the
+ * process sending from the same local address and port to the same STUN
+ * server, the list of interfaces is kept shorter
+ */
+#define FS_RAWUDP_STUN_MAPPING_CACHE_TIMEOUT (60)
+#define FS_RAWUDP_LOCAL_IPS_CACHE_TIMEOUT (5)
+
+gboolean fs_rawudp_cache_lookup_stun_mapping (const gchar *local_ip,
+    guint local_port,
+    const gchar *stun_ip,
+    guint stun_port,
+    gint64 now,
+    gchar **mapped_ip,
+    guint *mapped_port);
+
+void fs_rawudp_cache_store_stun_mapping (const gchar *local_ip,
+    guint local_port,
+    const gchar *stun_ip,
+    guint stun_port,
+    const gchar *mapped_ip,
+    guint mapped_port,
+    gint64 now);
+
+gboolean fs_rawudp_cache_lookup_local_ips (gboolean include_loopback,
+    gint64 now,
+    GList **ips);
+
+void fs_rawudp_cache_store_local_ips (gboolean include_loopback,
+    GList *ips,
+    gint64 now);
+
+void fs_rawudp_cache_clear (void);
+
+G_END_DECLS
+
+#endif /* __FS_RAWUDP_CACHE_H__ */
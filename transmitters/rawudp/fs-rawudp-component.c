@@ -1158,7 +1158,7 @@ fs_rawudp_component_gather_local_candidates (FsRawUdpComponent *self,
 
     port = fs_rawudp_transmitter_udpport_get_port (self->priv->udpport);
 
-    ips = nice_interfaces_get_local_ips (FALSE);
+    ips = fs_rawudp_transmitter_get_local_ips (FALSE);
     ips = filter_ips (ips, TRUE, FALSE);
 
     if (ips)
@@ -1251,6 +1251,37 @@ fs_rawudp_component_start_stun (FsRawUdpComponent *self, GError **error)
 {
   NiceAddress niceaddr;
   gboolean res = TRUE;
+  gchar *mapped_ip = NULL;
+  guint mapped_port = 0;
+
+  if (fs_rawudp_transmitter_udpport_lookup_stun_mapping (self->priv->udpport,
+          self->priv->stun_ip, self->priv->stun_port,
+          &mapped_ip, &mapped_port))
+  {
+    FsCandidate *candidate = fs_candidate_new ("L1",
+        self->priv->component,
+        FS_CANDIDATE_TYPE_SRFLX,
+        FS_NETWORK_PROTOCOL_UDP,
+        mapped_ip,
+        mapped_port);
+
+    g_free (mapped_ip);
+
+    FS_RAWUDP_COMPONENT_LOCK (self);
+#ifdef HAVE_GUPNP
+    fs_rawudp_component_stop_upnp_discovery_locked (self);
+#endif
+    self->priv->local_active_candidate = fs_candidate_copy (candidate);
+    FS_RAWUDP_COMPONENT_UNLOCK (self);
+
+    GST_DEBUG ("C:%d Emitting cached STUN candidate: %s:%u",
+        self->priv->component, candidate->ip, candidate->port);
+    fs_rawudp_component_emit_candidate (self, candidate);
+
+    fs_candidate_destroy (candidate);
+
+    return TRUE;
+  }
 
   GST_DEBUG ("C:%d starting the STUN process with server %s:%u",
       self->priv->component, self->priv->stun_ip, self->priv->stun_port);
@@ -1427,6 +1458,11 @@ stun_recv_cb (GstPad *pad, GstPadProbeInfo *info, gpointer user_data)
 
   self->priv->local_active_candidate = fs_candidate_copy (candidate);
 
+  if (self->priv->udpport)
+    fs_rawudp_transmitter_udpport_store_stun_mapping (self->priv->udpport,
+        self->priv->stun_ip, self->priv->stun_port,
+        candidate->ip, candidate->port);
+
   FS_RAWUDP_COMPONENT_UNLOCK(self);
 
   GST_DEBUG ("C:%d Emitting STUN discovered candidate: %s:%u",
@@ -1607,7 +1643,7 @@ fs_rawudp_component_emit_local_candidates (FsRawUdpComponent *self,
 
   port = fs_rawudp_transmitter_udpport_get_port (self->priv->udpport);
 
-  ips = nice_interfaces_get_local_ips (TRUE);
+  ips = fs_rawudp_transmitter_get_local_ips (TRUE);
   ips = filter_ips (ips, TRUE, FALSE);
 
   for (current = g_list_first (ips);
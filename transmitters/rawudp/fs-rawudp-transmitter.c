@@ -36,12 +36,15 @@
 
 #include "fs-rawudp-transmitter.h"
 #include "fs-rawudp-stream-transmitter.h"
+#include "fs-rawudp-cache.h"
 
 #include <farstream/fs-conference.h>
 #include <farstream/fs-plugin.h>
 
 #include <gio/gio.h>
 
+#include <nice/interfaces.h>
+
 #include <string.h>
 #include <sys/types.h>
 
@@ -1084,6 +1087,69 @@ fs_rawudp_transmitter_udpport_get_port (UdpPort *udpport)
   return udpport->port;
 }
 
+/**
+ * fs_rawudp_transmitter_udpport_lookup_stun_mapping:
+ * @udpport: the #UdpPort the STUN request would be sent from
+ * @stun_ip: the IP address of the STUN server
+ * @stun_port: the port of the STUN server
+ * @mapped_ip: (out): location for the external IP address
+ * @mapped_port: (out): location for the external port
+ *
+ * Looks for a recent server-reflexive address found for the same local
+ * address and port by any component in the process.
+ *
+ * Returns: %TRUE if a mapping was found, @mapped_ip must then be freed
+ */
+
+gboolean
+fs_rawudp_transmitter_udpport_lookup_stun_mapping (UdpPort *udpport,
+    const gchar *stun_ip,
+    guint stun_port,
+    gchar **mapped_ip,
+    guint *mapped_port)
+{
+  return fs_rawudp_cache_lookup_stun_mapping (udpport->requested_ip,
+      udpport->port, stun_ip, stun_port, g_get_monotonic_time (),
+      mapped_ip, mapped_port);
+}
+
+void
+fs_rawudp_transmitter_udpport_store_stun_mapping (UdpPort *udpport,
+    const gchar *stun_ip,
+    guint stun_port,
+    const gchar *mapped_ip,
+    guint mapped_port)
+{
+  fs_rawudp_cache_store_stun_mapping (udpport->requested_ip, udpport->port,
+      stun_ip, stun_port, mapped_ip, mapped_port, g_get_monotonic_time ());
+}
+
+/**
+ * fs_rawudp_transmitter_get_local_ips:
+ * @include_loopback: Include any loopback devices
+ *
+ * Same as nice_interfaces_get_local_ips(), but the list is only
+ * enumerated again if the previous one is more than a few seconds old.
+ * The list is shared by the whole process.
+ *
+ * Returns: a newly-allocated #GList of strings
+ */
+
+GList *
+fs_rawudp_transmitter_get_local_ips (gboolean include_loopback)
+{
+  gint64 now = g_get_monotonic_time ();
+  GList *ips = NULL;
+
+  if (!fs_rawudp_cache_lookup_local_ips (include_loopback, now, &ips))
+  {
+    ips = nice_interfaces_get_local_ips (include_loopback);
+    fs_rawudp_cache_store_local_ips (include_loopback, ips, now);
+  }
+
+  return ips;
+}
+
 
 static GType
 fs_rawudp_transmitter_get_stream_transmitter_type (FsTransmitter *transmitter)
@@ -134,6 +134,22 @@ gboolean fs_rawudp_transmitter_udpport_is_pad (UdpPort *udpport,
 
 gint fs_rawudp_transmitter_udpport_get_port (UdpPort *udpport);
 
+gboolean fs_rawudp_transmitter_udpport_lookup_stun_mapping (
+    UdpPort *udpport,
+    const gchar *stun_ip,
+    guint stun_port,
+    gchar **mapped_ip,
+    guint *mapped_port);
+
+void fs_rawudp_transmitter_udpport_store_stun_mapping (
+    UdpPort *udpport,
+    const gchar *stun_ip,
+    guint stun_port,
+    const gchar *mapped_ip,
+    guint mapped_port);
+
+GList *fs_rawudp_transmitter_get_local_ips (gboolean include_loopback);
+
 
 gboolean fs_rawudp_transmitter_udpport_add_known_address (UdpPort *udpport,
     GSocketAddress *address,
@@ -28,6 +28,10 @@
  *
  * This transmitter provides shm udp
  *
+ * If the #FsShmTransmitter:fan-out property is %TRUE, all of the streams that
+ * send on the same socket path share a single shmsink. Each buffer is then
+ * written once into one shared memory segment, and every process connected
+ * to that socket reads it from there with its own read position.
  */
 
 #ifdef HAVE_CONFIG_H
@@ -59,6 +63,8 @@ enum
   PROP_GST_SRC,
   PROP_COMPONENTS,
   PROP_DO_TIMESTAMP,
+  PROP_FAN_OUT,
+  PROP_SHM_SIZE
 };
 
 struct _FsShmTransmitterPrivate
@@ -74,6 +80,14 @@ struct _FsShmTransmitterPrivate
   GstElement **tees;
 
   gboolean do_timestamp;
+
+  gboolean fan_out;
+  guint shm_size;
+
+  /* Protects the list of users of each sink and shared_sinks */
+  GRecMutex mutex;
+  /* "component:path" -> SharedShmSink, only used in fan-out mode */
+  GHashTable *shared_sinks;
 };
 
 #define FS_SHM_TRANSMITTER_GET_PRIVATE(o)  \
@@ -272,6 +286,23 @@ fs_shm_transmitter_class_init (FsShmTransmitterClass *klass)
   g_object_class_override_property (gobject_class, PROP_DO_TIMESTAMP,
     "do-timestamp");
 
+  g_object_class_install_property (gobject_class, PROP_FAN_OUT,
+      g_param_spec_boolean ("fan-out",
+          "Share send sockets between streams",
+          "If TRUE, streams sending on the same socket path share a single"
+          " shared memory segment that any number of receivers can read from,"
+          " instead of failing to create a second socket",
+          FALSE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_SHM_SIZE,
+      g_param_spec_uint ("shm-size",
+          "Size of the shared memory segments",
+          "Size in bytes of the shared memory segment of new send sockets,"
+          " 0 means the default of shmsink",
+          0, G_MAXUINT, 0,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   transmitter_class->new_stream_transmitter =
     fs_shm_transmitter_new_stream_transmitter;
   transmitter_class->get_stream_transmitter_type =
@@ -292,6 +323,10 @@ fs_shm_transmitter_init (FsShmTransmitter *self)
 
   self->components = 2;
   self->priv->do_timestamp = TRUE;
+
+  g_rec_mutex_init (&self->priv->mutex);
+  self->priv->shared_sinks = g_hash_table_new_full (g_str_hash, g_str_equal,
+      g_free, NULL);
 }
 
 static void
@@ -474,6 +509,9 @@ fs_shm_transmitter_finalize (GObject *object)
     self->priv->tees = NULL;
   }
 
+  g_hash_table_unref (self->priv->shared_sinks);
+  g_rec_mutex_clear (&self->priv->mutex);
+
   parent_class->finalize (object);
 }
 
@@ -498,6 +536,12 @@ fs_shm_transmitter_get_property (GObject *object,
     case PROP_DO_TIMESTAMP:
       g_value_set_boolean (value, self->priv->do_timestamp);
       break;
+    case PROP_FAN_OUT:
+      g_value_set_boolean (value, self->priv->fan_out);
+      break;
+    case PROP_SHM_SIZE:
+      g_value_set_uint (value, self->priv->shm_size);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -519,6 +563,14 @@ fs_shm_transmitter_set_property (GObject *object,
     case PROP_DO_TIMESTAMP:
       self->priv->do_timestamp = g_value_get_boolean (value);
       break;
+    case PROP_FAN_OUT:
+      g_rec_mutex_lock (&self->priv->mutex);
+      self->priv->fan_out = g_value_get_boolean (value);
+      g_rec_mutex_unlock (&self->priv->mutex);
+      break;
+    case PROP_SHM_SIZE:
+      self->priv->shm_size = g_value_get_uint (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -718,61 +770,151 @@ fs_shm_transmitter_check_shm_src (FsShmTransmitter *self, ShmSrc *shm,
 
 
 
-struct _ShmSink {
+/*
+ * The shmsink and its valve, shared by all of the ShmSink using the same
+ * socket path in fan-out mode. A single shmsink writes each buffer once
+ * into its segment and any number of shmsrc can read from it.
+ */
+
+typedef struct {
+  FsShmTransmitter *self;
   guint component;
   gchar *path;
   GstElement *sink;
   GstElement *recvonly_filter;
   GstPad *teepad;
 
+  /* Protected by the transmitter mutex */
+  GList *users;
+  gboolean ready;
+} SharedShmSink;
+
+static void shared_shm_sink_update_drop (FsShmTransmitter *self,
+    SharedShmSink *shared);
+
+struct _ShmSink {
+  SharedShmSink *shared;
+
   ready ready_func;
   connection connected_func;
   gpointer cb_data;
+
+  /* Protected by the transmitter mutex */
+  gboolean sending;
 };
 
 
 static void
-ready_cb (GstBin *bin, GstElement *elem, ShmSink *shm)
+ready_cb (GstBin *bin, GstElement *elem, SharedShmSink *shared)
 {
+  FsShmTransmitter *self = shared->self;
   gchar *path = NULL;
+  GList *users = NULL;
+  GList *item;
 
-  if (elem != shm->sink)
+  if (elem != shared->sink)
     return;
 
   g_object_get (elem, "socket-path", &path, NULL);
-  shm->ready_func (shm->component, path, shm->cb_data);
+
+  g_rec_mutex_lock (&self->priv->mutex);
+  shared->ready = TRUE;
+  for (item = shared->users; item; item = g_list_next (item))
+  {
+    ShmSink *shm = item->data;
+
+    if (shm->ready_func)
+      users = g_list_prepend (users, shm);
+  }
+  g_rec_mutex_unlock (&self->priv->mutex);
+
+  for (item = users; item; item = g_list_next (item))
+  {
+    ShmSink *shm = item->data;
+
+    shm->ready_func (shared->component, path, shm->cb_data);
+  }
+
+  g_list_free (users);
   g_free (path);
 }
 
 
 static void
-connected_cb (GstBin *bin, gint id, ShmSink *shm)
+connected_cb (GstBin *bin, gint id, SharedShmSink *shared)
+{
+  FsShmTransmitter *self = shared->self;
+  GList *users = NULL;
+  GList *item;
+
+  g_rec_mutex_lock (&self->priv->mutex);
+  for (item = shared->users; item; item = g_list_next (item))
+  {
+    ShmSink *shm = item->data;
+
+    if (shm->connected_func)
+      users = g_list_prepend (users, shm);
+  }
+  g_rec_mutex_unlock (&self->priv->mutex);
+
+  for (item = users; item; item = g_list_next (item))
+  {
+    ShmSink *shm = item->data;
+
+    shm->connected_func (shared->component, id, shm->cb_data);
+  }
+
+  g_list_free (users);
+}
+
+static void
+shared_shm_sink_destroy (FsShmTransmitter *self, SharedShmSink *shared)
 {
-  shm->connected_func (shm->component, id, shm->cb_data);
+  GST_DEBUG ("Freeing shm socket %s", shared->path);
+
+  g_signal_handlers_disconnect_by_data (self->priv->gst_sink, shared);
+
+  if (shared->teepad)
+  {
+    gst_element_release_request_pad (self->priv->tees[shared->component],
+        shared->teepad);
+    gst_object_unref (shared->teepad);
+  }
+  shared->teepad = NULL;
+
+  if (shared->sink)
+  {
+    gst_element_set_locked_state (shared->sink, TRUE);
+    gst_element_set_state (shared->sink, GST_STATE_NULL);
+    gst_bin_remove (GST_BIN (self->priv->gst_sink), shared->sink);
+  }
+  shared->sink = NULL;
+
+  if (shared->recvonly_filter)
+  {
+    gst_element_set_locked_state (shared->recvonly_filter, TRUE);
+    gst_element_set_state (shared->recvonly_filter, GST_STATE_NULL);
+    gst_bin_remove (GST_BIN (self->priv->gst_sink), shared->recvonly_filter);
+  }
+  shared->recvonly_filter = NULL;
+
+  g_free (shared->path);
+  g_slice_free (SharedShmSink, shared);
 }
 
-ShmSink *
-fs_shm_transmitter_get_shm_sink (FsShmTransmitter *self,
+static SharedShmSink *
+shared_shm_sink_new (FsShmTransmitter *self,
     guint component,
     const gchar *path,
-    ready ready_func,
-    connection connected_func,
-    gpointer cb_data,
     GError **error)
 {
-  ShmSink *shm = g_slice_new0 (ShmSink);
+  SharedShmSink *shared = g_slice_new0 (SharedShmSink);
   GstElement *elem;
   GstPad *pad;
 
-  GST_DEBUG ("Trying to add shm sink for c:%u path %s", component, path);
-
-  shm->component = component;
-
-  shm->path = g_strdup (path);
-
-  shm->ready_func = ready_func;
-  shm->connected_func = connected_func;
-  shm->cb_data = cb_data;
+  shared->self = self;
+  shared->component = component;
+  shared->path = g_strdup (path);
 
   /* First add the sink */
 
@@ -790,12 +932,14 @@ fs_shm_transmitter_get_shm_sink (FsShmTransmitter *self,
       "sync" , FALSE,
       NULL);
 
-  if (ready_func)
-    g_signal_connect (self->priv->gst_sink, "ready", G_CALLBACK (ready_cb),
-        shm);
+  if (self->priv->shm_size)
+    g_object_set (elem, "shm-size", self->priv->shm_size, NULL);
+
+  g_signal_connect (self->priv->gst_sink, "ready", G_CALLBACK (ready_cb),
+      shared);
 
-  if (connected_func)
-    g_signal_connect (elem, "client-connected", G_CALLBACK (connected_cb), shm);
+  g_signal_connect (elem, "client-connected", G_CALLBACK (connected_cb),
+      shared);
 
   if (!gst_bin_add (GST_BIN (self->priv->gst_sink), elem))
   {
@@ -805,7 +949,7 @@ fs_shm_transmitter_get_shm_sink (FsShmTransmitter *self,
     goto error;
   }
 
-  shm->sink = elem;
+  shared->sink = elem;
 
   /* Second add the recvonly filter */
 
@@ -825,43 +969,43 @@ fs_shm_transmitter_get_shm_sink (FsShmTransmitter *self,
     goto error;
   }
 
-  shm->recvonly_filter = elem;
+  shared->recvonly_filter = elem;
 
   /* Third connect these */
 
-  if (!gst_element_link (shm->recvonly_filter, shm->sink))
+  if (!gst_element_link (shared->recvonly_filter, shared->sink))
   {
     g_set_error (error, FS_ERROR, FS_ERROR_CONSTRUCTION,
         "Could not link recvonly filter and shmsink");
     goto error;
   }
 
-  if (!gst_element_sync_state_with_parent (shm->sink))
+  if (!gst_element_sync_state_with_parent (shared->sink))
   {
     g_set_error (error, FS_ERROR, FS_ERROR_CONSTRUCTION,
         "Could not sync the state of the new shmsink with its parent");
     goto error;
   }
 
-  if (!gst_element_sync_state_with_parent (shm->recvonly_filter))
+  if (!gst_element_sync_state_with_parent (shared->recvonly_filter))
   {
     g_set_error (error, FS_ERROR, FS_ERROR_CONSTRUCTION,
         "Could not sync the state of the new recvonly filter  with its parent");
     goto error;
   }
 
-  shm->teepad = gst_element_get_request_pad (self->priv->tees[component],
+  shared->teepad = gst_element_get_request_pad (self->priv->tees[component],
       "src_%u");
 
-  if (!shm->teepad)
+  if (!shared->teepad)
   {
     g_set_error (error, FS_ERROR, FS_ERROR_CONSTRUCTION,
         "Could not get teepad");
     goto error;
   }
 
-  pad = gst_element_get_static_pad (shm->recvonly_filter, "sink");
-  if (GST_PAD_LINK_FAILED (gst_pad_link (shm->teepad, pad)))
+  pad = gst_element_get_static_pad (shared->recvonly_filter, "sink");
+  if (GST_PAD_LINK_FAILED (gst_pad_link (shared->teepad, pad)))
   {
     g_set_error (error, FS_ERROR, FS_ERROR_CONSTRUCTION, "Could not link tee"
         " and valve");
@@ -870,68 +1014,165 @@ fs_shm_transmitter_get_shm_sink (FsShmTransmitter *self,
   }
   gst_object_unref (pad);
 
-  return shm;
+  return shared;
 
  error:
-  fs_shm_transmitter_check_shm_sink (self, shm, NULL);
+  shared_shm_sink_destroy (self, shared);
 
   return NULL;
 }
 
+static gchar *
+shared_shm_sink_key (guint component, const gchar *path)
+{
+  return g_strdup_printf ("%u:%s", component, path);
+}
+
+ShmSink *
+fs_shm_transmitter_get_shm_sink (FsShmTransmitter *self,
+    guint component,
+    const gchar *path,
+    ready ready_func,
+    connection connected_func,
+    gpointer cb_data,
+    GError **error)
+{
+  ShmSink *shm;
+  SharedShmSink *shared = NULL;
+  gchar *ready_path = NULL;
+
+  GST_DEBUG ("Trying to add shm sink for c:%u path %s", component, path);
+
+  /* Recursive because adding the shmsink may emit "ready" synchronously */
+  g_rec_mutex_lock (&self->priv->mutex);
+  if (self->priv->fan_out)
+  {
+    gchar *key = shared_shm_sink_key (component, path);
+
+    shared = g_hash_table_lookup (self->priv->shared_sinks, key);
+    g_free (key);
+  }
+
+  if (shared)
+  {
+    GST_DEBUG ("Re-using shm socket %s for c:%u", path, component);
+  }
+  else
+  {
+    shared = shared_shm_sink_new (self, component, path, error);
+    if (!shared)
+    {
+      g_rec_mutex_unlock (&self->priv->mutex);
+      return NULL;
+    }
+
+    if (self->priv->fan_out)
+      g_hash_table_insert (self->priv->shared_sinks,
+          shared_shm_sink_key (component, path), shared);
+  }
+
+  shm = g_slice_new0 (ShmSink);
+  shm->shared = shared;
+  shm->ready_func = ready_func;
+  shm->connected_func = connected_func;
+  shm->cb_data = cb_data;
+
+  shared->users = g_list_prepend (shared->users, shm);
+  /* Another stream may destroy the shared sink once the lock is released */
+  if (shared->ready)
+    ready_path = g_strdup (shared->path);
+  g_rec_mutex_unlock (&self->priv->mutex);
+
+  /* The socket of a shared sink may already be there */
+  if (ready_path && ready_func)
+    ready_func (component, ready_path, cb_data);
+  g_free (ready_path);
+
+  return shm;
+}
+
+/*
+ * Returns: %TRUE if the path is the same, other %FALSE and freeds the ShmSink
+ */
+
 gboolean
 fs_shm_transmitter_check_shm_sink (FsShmTransmitter *self, ShmSink *shm,
     const gchar *path)
 {
-  if (path && !strcmp (path, shm->path))
+  SharedShmSink *shared = shm->shared;
+  gboolean last_user;
+
+  if (path && !strcmp (path, shared->path))
     return TRUE;
 
   if (path)
-    GST_DEBUG ("Replacing shm socket %s with %s", shm->path, path);
-  else
-    GST_DEBUG ("Freeing shm socket %s", shm->path);
-
-  if (shm->teepad)
+    GST_DEBUG ("Replacing shm socket %s with %s", shared->path, path);
+
+  g_rec_mutex_lock (&self->priv->mutex);
+  shared->users = g_list_remove (shared->users, shm);
+  last_user = (shared->users == NULL);
+  /* "fan-out" may have been changed since the sink was shared, so look it up
+   * whatever its current value */
+  if (last_user)
   {
-    gst_element_release_request_pad (self->priv->tees[shm->component],
-        shm->teepad);
-    gst_object_unref (shm->teepad);
-  }
-  shm->teepad = NULL;
+    gchar *key = shared_shm_sink_key (shared->component, shared->path);
 
-  if (shm->sink)
-  {
-    gst_element_set_locked_state (shm->sink, TRUE);
-    gst_element_set_state (shm->sink, GST_STATE_NULL);
-    gst_bin_remove (GST_BIN (self->priv->gst_sink), shm->sink);
+    if (g_hash_table_lookup (self->priv->shared_sinks, key) == shared)
+      g_hash_table_remove (self->priv->shared_sinks, key);
+    g_free (key);
   }
-  shm->sink = NULL;
-
-  if (shm->recvonly_filter)
+  else
   {
-    gst_element_set_locked_state (shm->recvonly_filter, TRUE);
-    gst_element_set_state (shm->recvonly_filter, GST_STATE_NULL);
-    gst_bin_remove (GST_BIN (self->priv->gst_sink), shm->recvonly_filter);
+    /* The other users may go away as soon as the lock is released */
+    shared_shm_sink_update_drop (self, shared);
   }
-  shm->recvonly_filter = NULL;
+  g_rec_mutex_unlock (&self->priv->mutex);
+
+  if (last_user)
+    shared_shm_sink_destroy (self, shared);
 
-  g_free (shm->path);
   g_slice_free (ShmSink, shm);
 
   return FALSE;
 }
 
 
+/*
+ * A shared sink is sending as long as one of its users is
+ */
+
+static void
+shared_shm_sink_update_drop (FsShmTransmitter *self, SharedShmSink *shared)
+{
+  GObjectClass *klass = G_OBJECT_GET_CLASS (shared->recvonly_filter);
+  gboolean sending = FALSE;
+  GList *item;
+
+  g_rec_mutex_lock (&self->priv->mutex);
+  for (item = shared->users; item; item = g_list_next (item))
+  {
+    ShmSink *shm = item->data;
+
+    sending |= shm->sending;
+  }
+  g_rec_mutex_unlock (&self->priv->mutex);
+
+  if (g_object_class_find_property (klass, "drop"))
+    g_object_set (shared->recvonly_filter, "drop", !sending, NULL);
+}
+
 void
 fs_shm_transmitter_sink_set_sending (FsShmTransmitter *self, ShmSink *shm,
     gboolean sending)
 {
-  GObjectClass *klass = G_OBJECT_GET_CLASS (shm->recvonly_filter);
+  g_rec_mutex_lock (&self->priv->mutex);
+  shm->sending = sending;
+  g_rec_mutex_unlock (&self->priv->mutex);
 
-  if (g_object_class_find_property (klass, "drop"))
-    g_object_set (shm->recvonly_filter, "drop", !sending, NULL);
+  shared_shm_sink_update_drop (self, shm->shared);
 
   if (sending)
-    gst_element_send_event (shm->sink,
+    gst_element_send_event (shm->shared->sink,
         gst_event_new_custom (GST_EVENT_CUSTOM_UPSTREAM,
             gst_structure_new ("GstForceKeyUnit",
               "all-headers", G_TYPE_BOOLEAN, TRUE,